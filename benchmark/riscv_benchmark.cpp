@@ -0,0 +1,491 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include "../libelf/elf.h"
+#include "../riscv_cpu.h"
+#include "../riscv_loader.h"
+#include "../riscv_plugin.h"
+#include "riscv_encoder.h"
+
+//------------------------------------------------------------------------------
+// Throughput benchmark
+//------------------------------------------------------------------------------
+// Every workload is run through every dispatch mode
+//   run      riscv_cpu::run()
+//   runOnce  riscv_cpu::runOnce() once per instruction
+//   issue    riscv_cpu::issue() without the SIGSEGV handler
+//   plugin   riscv_cpu::run() with a RETIRE plugin attached
+// The best of the repeated runs is reported. The instruction count of the run
+// mode is taken from an untimed plugin run of the same workload. A workload
+// which does not exit with status 0 in every mode is not reported.
+//------------------------------------------------------------------------------
+struct benchmark_cpu : public riscv_cpu
+{
+    uint64_t ecalls;
+    bool exited;
+    intptr_t status;
+};
+//------------------------------------------------------------------------------
+struct counter : public riscv_plugin
+{
+    counter() : riscv_plugin(RETIRE), count(0) {}
+    void retire(const riscv_cpu& cpu, uintptr_t address) { count++; }
+    uint64_t count;
+};
+//------------------------------------------------------------------------------
+struct workload
+{
+    const char* name;
+    void (*prepare)(workload& workload, benchmark_cpu& cpu, int thread);
+    void* context;
+    int threads;
+};
+//------------------------------------------------------------------------------
+struct mode
+{
+    const char* name;
+    uint64_t (*execute)(benchmark_cpu& cpu);
+    bool concurrent;
+};
+//------------------------------------------------------------------------------
+static uint64_t now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+//------------------------------------------------------------------------------
+static void environmentCall(riscv_cpu& cpu)
+{
+    benchmark_cpu& benchmark = static_cast<benchmark_cpu&>(cpu);
+    benchmark.ecalls++;
+
+    // exit
+    if (cpu.x[17].u == 93)
+    {
+        benchmark.exited = true;
+        benchmark.status = cpu.x[10].s;
+        cpu.pc = 0;
+    }
+}
+//------------------------------------------------------------------------------
+// Dispatch modes
+//------------------------------------------------------------------------------
+static uint64_t runMode(benchmark_cpu& cpu)
+{
+    cpu.run();
+    return 0;
+}
+//------------------------------------------------------------------------------
+static uint64_t runOnceMode(benchmark_cpu& cpu)
+{
+    uint64_t count = 0;
+    while (cpu.pc >= cpu.begin && cpu.pc < cpu.end)
+    {
+        if (cpu.runOnce() == false)
+            break;
+        count++;
+    }
+    return count;
+}
+//------------------------------------------------------------------------------
+static uint64_t issueMode(benchmark_cpu& cpu)
+{
+    uint64_t count = 0;
+    while (cpu.pc >= cpu.begin && cpu.pc < cpu.end)
+    {
+        if (cpu.issue() == false)
+            break;
+        count++;
+    }
+    return count;
+}
+//------------------------------------------------------------------------------
+static uint64_t pluginMode(benchmark_cpu& cpu)
+{
+    counter counter;
+    cpu.attach(&counter);
+    cpu.run();
+    cpu.detach(&counter);
+    return counter.count;
+}
+//------------------------------------------------------------------------------
+// run() and runOnce() share one process-wide SIGSEGV handler and jmp_buf, so
+// only issue() is driven from several host threads at once
+static const mode modes[] =
+{
+    { "run",        runMode,        false   },
+    { "runOnce",    runOnceMode,    false   },
+    { "issue",      issueMode,      true    },
+    { "plugin",     pluginMode,     false   },
+};
+//------------------------------------------------------------------------------
+// Synthetic kernels
+//------------------------------------------------------------------------------
+struct kernel : public encoder
+{
+    size_t count;
+    void* a0;
+    void* a1;
+    uint8_t* data;
+    uint64_t shared;
+};
+//------------------------------------------------------------------------------
+static void prepareKernel(workload& workload, benchmark_cpu& cpu, int thread)
+{
+    kernel& kernel = *(struct kernel*)workload.context;
+    if (thread == 0)
+        kernel.shared = 0;
+    cpu.program(kernel.code, kernel.size * sizeof(uint32_t));
+    cpu.x[A0] = (uintptr_t)kernel.a0;
+    cpu.x[A1] = (uintptr_t)kernel.a1;
+    cpu.x[A2] = kernel.count;
+}
+//------------------------------------------------------------------------------
+static kernel* integerKernel(size_t count)
+{
+    kernel* kernel = new struct kernel();
+    kernel->count = count;
+    kernel->emit(I(1, A0, 0b000, A0, 0b0010011));          // addi a0, a0, 1
+    kernel->emit(R(0, A0, A1, 0b100, A1, 0b0110011));       // xor  a1, a1, a0
+    kernel->emit(I(3, A1, 0b001, T0, 0b0010011));          // slli t0, a1, 3
+    kernel->emit(R(0, T0, A1, 0b000, A1, 0b0110011));       // add  a1, a1, t0
+    kernel->loop(0);
+    return kernel;
+}
+//------------------------------------------------------------------------------
+static kernel* memcpyKernel(size_t count)
+{
+    kernel* kernel = new struct kernel();
+    kernel->count = count;
+    kernel->data = new uint8_t[count * sizeof(uint64_t) * 2];
+    uint64_t* source = (uint64_t*)kernel->data;
+    for (size_t i = 0; i < count; ++i)
+    {
+        source[i] = i;
+    }
+    kernel->a0 = source;
+    kernel->a1 = source + count;
+    kernel->emit(I(0, A0, 0b011, T0, 0b0000011));          // ld   t0, 0(a0)
+    kernel->emit(S(0, T0, A1, 0b011, 0b0100011));           // sd   t0, 0(a1)
+    kernel->emit(I(8, A0, 0b000, A0, 0b0010011));          // addi a0, a0, 8
+    kernel->emit(I(8, A1, 0b000, A1, 0b0010011));          // addi a1, a1, 8
+    kernel->loop(0);
+    return kernel;
+}
+//------------------------------------------------------------------------------
+static kernel* dotKernel(size_t count)
+{
+    kernel* kernel = new struct kernel();
+    kernel->count = count;
+    kernel->data = new uint8_t[count * sizeof(float) * 2];
+    float* x = (float*)kernel->data;
+    float* y = x + count;
+    for (size_t i = 0; i < count; ++i)
+    {
+        x[i] = 1.0f / (i + 1);
+        y[i] = float(i & 15);
+    }
+    kernel->a0 = x;
+    kernel->a1 = y;
+    kernel->emit(R(0b1111000, 0, ZERO, 0b000, 10, 0b1010011));      // fmv.w.x  fa0, zero
+    kernel->emit(I(0, A0, 0b010, 0, 0b0000111));                    // flw      ft0, 0(a0)
+    kernel->emit(I(0, A1, 0b010, 1, 0b0000111));                    // flw      ft1, 0(a1)
+    kernel->emit(R4(10, 0b00, 1, 0, 0b000, 10, 0b1000011));         // fmadd.s  fa0, ft0, ft1, fa0
+    kernel->emit(I(4, A0, 0b000, A0, 0b0010011));                  // addi     a0, a0, 4
+    kernel->emit(I(4, A1, 0b000, A1, 0b0010011));                  // addi     a1, a1, 4
+    kernel->loop(1);
+    return kernel;
+}
+//------------------------------------------------------------------------------
+static kernel* amoKernel(size_t count)
+{
+    kernel* kernel = new struct kernel();
+    kernel->count = count;
+    kernel->a0 = &kernel->shared;
+    kernel->emit(I(1, ZERO, 0b000, T1, 0b0010011));        // addi     t1, zero, 1
+    kernel->emit(R(0b0000000, T1, A0, 0b011, ZERO, 0b0101111)); // amoadd.d zero, t1, (a0)
+    kernel->loop(1);
+    return kernel;
+}
+//------------------------------------------------------------------------------
+// riscv-tests
+//------------------------------------------------------------------------------
+struct image
+{
+    elf_t elf;
+    char* data;
+    void* memory;
+    uintptr_t low;
+    uintptr_t high;
+};
+//------------------------------------------------------------------------------
+static void prepareImage(workload& workload, benchmark_cpu& cpu, int thread)
+{
+    image& image = *(struct image*)workload.context;
+    elf_loadFile(&image.elf, VIRTUAL);
+    uintptr_t entry = elf_getEntryPoint(&image.elf);
+    cpu.program((void*)entry, image.high - entry);
+}
+//------------------------------------------------------------------------------
+static image* loadImage(const char* path)
+{
+    size_t size = 0;
+    char* data = riscv_loader::read(path, size);
+    if (data == nullptr)
+        return nullptr;
+    image* image = new struct image();
+    image->data = data;
+
+    if (elf_newFile(image->data, size, &image->elf) < 0)
+    {
+        delete[] image->data;
+        delete image;
+        return nullptr;
+    }
+
+    // Guest addresses are host addresses
+    elf_getMemoryBounds(&image->elf, VIRTUAL, &image->low, &image->high);
+    size_t length = image->high - image->low;
+    image->memory = mmap((void*)image->low, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (image->memory != (void*)image->low)
+    {
+        if (image->memory != MAP_FAILED)
+            munmap(image->memory, length);
+        delete[] image->data;
+        delete image;
+        return nullptr;
+    }
+    return image;
+}
+//------------------------------------------------------------------------------
+static void freeImage(image* image)
+{
+    munmap(image->memory, image->high - image->low);
+    delete[] image->data;
+    delete image;
+}
+//------------------------------------------------------------------------------
+// Measurement
+//------------------------------------------------------------------------------
+struct thread
+{
+    const struct mode* mode;
+    benchmark_cpu* cpu;
+    uint64_t count;
+};
+//------------------------------------------------------------------------------
+static void* threadMain(void* context)
+{
+    thread& thread = *(struct thread*)context;
+    thread.count = thread.mode->execute(*thread.cpu);
+    return nullptr;
+}
+//------------------------------------------------------------------------------
+struct result
+{
+    uint64_t instructions;
+    uint64_t ecalls;
+    uint64_t nanoseconds;
+    int threads;
+    bool failed;
+    intptr_t status;
+};
+//------------------------------------------------------------------------------
+static result measure(workload& workload, const mode& mode, int repeat)
+{
+    int threads = mode.concurrent ? workload.threads : 1;
+    benchmark_cpu* cpus = new benchmark_cpu[threads];
+    thread* contexts = new thread[threads];
+    pthread_t* handles = new pthread_t[threads];
+    for (int i = 0; i < threads; ++i)
+    {
+        cpus[i].environmentCall = environmentCall;
+    }
+
+    result best = { 0, 0, UINT64_MAX, threads, false, 0 };
+    for (int r = 0; r < repeat; ++r)
+    {
+        for (int i = 0; i < threads; ++i)
+        {
+            workload.prepare(workload, cpus[i], i);
+            cpus[i].ecalls = 0;
+            cpus[i].exited = false;
+            cpus[i].status = 0;
+            contexts[i].mode = &mode;
+            contexts[i].cpu = &cpus[i];
+            contexts[i].count = 0;
+        }
+
+        uint64_t begin = now();
+        if (threads == 1)
+        {
+            threadMain(&contexts[0]);
+        }
+        else
+        {
+            for (int i = 0; i < threads; ++i)
+                pthread_create(&handles[i], nullptr, threadMain, &contexts[i]);
+            for (int i = 0; i < threads; ++i)
+                pthread_join(handles[i], nullptr);
+        }
+        uint64_t elapsed = now() - begin;
+
+        for (int i = 0; i < threads; ++i)
+        {
+            if (cpus[i].exited && cpus[i].status == 0)
+                continue;
+            best.failed = true;
+            best.status = cpus[i].exited ? cpus[i].status : -1;
+        }
+
+        if (elapsed < best.nanoseconds)
+        {
+            best.nanoseconds = elapsed;
+            best.instructions = 0;
+            best.ecalls = 0;
+            for (int i = 0; i < threads; ++i)
+            {
+                best.instructions += contexts[i].count;
+                best.ecalls += cpus[i].ecalls;
+            }
+        }
+    }
+
+    delete[] handles;
+    delete[] contexts;
+    delete[] cpus;
+    return best;
+}
+//------------------------------------------------------------------------------
+static result totals[sizeof(modes) / sizeof(modes[0])];
+//------------------------------------------------------------------------------
+static void benchmark(workload& workload, int repeat)
+{
+    // Reference instruction count for modes which cannot count by themselves
+    result reference = measure(workload, modes[3], 1);
+    if (reference.failed)
+    {
+        fprintf(stderr, "%s: exit status %lld, not reported\n", workload.name, (long long)reference.status);
+        return;
+    }
+
+    result results[sizeof(modes) / sizeof(modes[0])];
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i)
+    {
+        results[i] = measure(workload, modes[i], repeat);
+        if (results[i].failed)
+        {
+            fprintf(stderr, "%s: exit status %lld in %s mode, not reported\n", workload.name, (long long)results[i].status, modes[i].name);
+            return;
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i)
+    {
+        result& result = results[i];
+        if (result.instructions == 0)
+            result.instructions = reference.instructions * result.threads;
+
+        double nanoseconds = result.instructions ? double(result.nanoseconds) / result.instructions : 0.0;
+        double mips = result.nanoseconds ? 1000.0 * result.instructions / result.nanoseconds : 0.0;
+        double perEcall = result.ecalls ? double(result.instructions) / result.ecalls : 0.0;
+        printf("%-32s %-8s %7d %14llu %8llu %10.3f %10.2f %12.1f\n", workload.name, modes[i].name, result.threads,
+               (unsigned long long)result.instructions,
+               (unsigned long long)result.ecalls, nanoseconds, mips, perEcall);
+
+        totals[i].instructions += result.instructions;
+        totals[i].ecalls += result.ecalls;
+        totals[i].nanoseconds += result.nanoseconds;
+    }
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    int repeat = 5;
+    size_t count = 1000000;
+    int threads = 4;
+    bool kernels = true;
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; ++arg)
+    {
+        if (strcmp(argv[arg], "-r") == 0 && arg + 1 < argc)
+            repeat = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "-n") == 0 && arg + 1 < argc)
+            count = strtoul(argv[++arg], nullptr, 10);
+        else if (strcmp(argv[arg], "-t") == 0 && arg + 1 < argc)
+            threads = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "-K") == 0)
+            kernels = false;
+        else
+        {
+            fprintf(stderr, "usage: %s [-r repeat] [-n iterations] [-t threads] [-K] [elf ...]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (repeat < 1)
+        repeat = 1;
+    if (threads < 1)
+        threads = 1;
+
+    printf("%-32s %-8s %7s %14s %8s %10s %10s %12s\n", "workload", "mode", "threads", "instructions", "ecalls", "ns/inst", "MIPS", "inst/ecall");
+
+    if (kernels)
+    {
+        workload workloads[] =
+        {
+            { "kernel:integer", prepareKernel, integerKernel(count),    1       },
+            { "kernel:memcpy",  prepareKernel, memcpyKernel(count),     1       },
+            { "kernel:dot",     prepareKernel, dotKernel(count),        1       },
+            { "kernel:amo",     prepareKernel, amoKernel(count),        threads },
+        };
+        for (workload& workload : workloads)
+        {
+            benchmark(workload, repeat);
+
+            kernel* kernel = (struct kernel*)workload.context;
+            delete[] kernel->data;
+            delete kernel;
+        }
+    }
+
+    for (; arg < argc; ++arg)
+    {
+        image* image = loadImage(argv[arg]);
+        if (image == nullptr)
+        {
+            fprintf(stderr, "%s: cannot be loaded\n", argv[arg]);
+            continue;
+        }
+        const char* name = strrchr(argv[arg], '/');
+        workload workload = { name ? name + 1 : argv[arg], prepareImage, image, 1 };
+        benchmark(workload, repeat);
+        freeImage(image);
+    }
+
+    printf("\n");
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i)
+    {
+        const result& total = totals[i];
+        double nanoseconds = total.instructions ? double(total.nanoseconds) / total.instructions : 0.0;
+        double mips = total.nanoseconds ? 1000.0 * total.instructions / total.nanoseconds : 0.0;
+        double perEcall = total.ecalls ? double(total.instructions) / total.ecalls : 0.0;
+        printf("%-32s %-8s %7s %14llu %8llu %10.3f %10.2f %12.1f\n", "total", modes[i].name, "",
+               (unsigned long long)total.instructions,
+               (unsigned long long)total.ecalls, nanoseconds, mips, perEcall);
+    }
+
+    return 0;
+}
+//------------------------------------------------------------------------------
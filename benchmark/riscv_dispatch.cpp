@@ -0,0 +1,387 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../riscv_cpu.h"
+#include "../riscv_predecode.h"
+#include "riscv_encoder.h"
+
+//------------------------------------------------------------------------------
+// Dispatch microbenchmarks
+//------------------------------------------------------------------------------
+// The dispatch suite runs the same instruction mixes through
+//   run        riscv_cpu::run()
+//   map32      the map32 pointer-to-member table
+//   switch     a switch over the major opcode calling the handlers directly
+//   threaded   computed goto with one indirect jump per handler
+//   predecoded riscv_cpu::run(riscv_predecode)
+// MAP32 names the map32 handlers for the switch and computed goto loops, the
+// suite refuses to run when it no longer matches riscv_cpu::map32.
+// The fixed suite runs a straight-line ALU block through the map32 loop with
+// the x[0] = 0 write, the pc == address check and the [begin, end) range test
+// removed one at a time.
+// The mixes only contain 32-bit instructions, so the alternative loops skip
+// the instruction length decode. Output is CSV with the best of -r runs.
+//------------------------------------------------------------------------------
+#define MAP32(_) \
+    _(0, LOAD)      _(1, LOAD_FP)   _(2, HINT)      _(3, MISC_MEM)  _(4, OP_IMM)    _(5, AUIPC)     _(6, OP_IMM_32) _(7, HINT)  \
+    _(8, STORE)     _(9, STORE_FP)  _(10, HINT)     _(11, AMO)      _(12, OP)       _(13, LUI)      _(14, OP_32)    _(15, HINT) \
+    _(16, MADD)     _(17, MSUB)     _(18, NMSUB)    _(19, NMADD)    _(20, OP_FP)    _(21, OP_V)     _(22, HINT)     _(23, HINT) \
+    _(24, BRANCH)   _(25, JALR)     _(26, HINT)     _(27, JAL)      _(28, SYSTEM)   _(29, HINT)     _(30, HINT)     _(31, HINT)
+//------------------------------------------------------------------------------
+struct dispatch_cpu : public riscv_cpu
+{
+    static bool current();
+
+    void viaRun();
+    void viaMap32();
+    void viaSwitch();
+    void viaThreaded();
+    void viaPredecoded();
+    void predecode();
+
+    template <bool zero, bool check, bool range>
+    void straight(size_t passes);
+
+    riscv_predecode table;
+};
+//------------------------------------------------------------------------------
+bool dispatch_cpu::current()
+{
+    bool current = true;
+#define CHECK(index, name) current &= (map32[index] == &dispatch_cpu::name);
+    MAP32(CHECK)
+#undef CHECK
+    return current;
+}
+//------------------------------------------------------------------------------
+void dispatch_cpu::viaRun()
+{
+    run();
+}
+//------------------------------------------------------------------------------
+void dispatch_cpu::viaMap32()
+{
+    while (pc >= begin && pc < end)
+    {
+        uintptr_t address = pc;
+        format = *(uint32_t*)address;
+        instruction_pointer inst = map32[opcode >> 2];
+        (this->*inst)();
+        if (pc == address)
+            pc += 4;
+        x[0] = 0;
+    }
+}
+//------------------------------------------------------------------------------
+void dispatch_cpu::viaSwitch()
+{
+    while (pc >= begin && pc < end)
+    {
+        uintptr_t address = pc;
+        format = *(uint32_t*)address;
+        switch (opcode >> 2)
+        {
+#define CASE(index, name) case index: name(); break;
+        MAP32(CASE)
+#undef CASE
+        }
+        if (pc == address)
+            pc += 4;
+        x[0] = 0;
+    }
+}
+//------------------------------------------------------------------------------
+void dispatch_cpu::viaThreaded()
+{
+#define LABEL(index, name) &&label##index,
+    static void* const labels[32] = { MAP32(LABEL) };
+#undef LABEL
+
+    uintptr_t address;
+#define DISPATCH() \
+    if (pc < begin || pc >= end) \
+        return; \
+    address = pc; \
+    format = *(uint32_t*)address; \
+    goto *labels[opcode >> 2];
+#define HANDLER(index, name) \
+    label##index: \
+    name(); \
+    if (pc == address) \
+        pc += 4; \
+    x[0] = 0; \
+    DISPATCH()
+
+    DISPATCH()
+    MAP32(HANDLER)
+
+#undef HANDLER
+#undef DISPATCH
+}
+//------------------------------------------------------------------------------
+void dispatch_cpu::predecode()
+{
+    table.decode((void*)begin, end - begin);
+}
+//------------------------------------------------------------------------------
+void dispatch_cpu::viaPredecoded()
+{
+    run(table);
+}
+//------------------------------------------------------------------------------
+template <bool zero, bool check, bool range>
+void dispatch_cpu::straight(size_t passes)
+{
+    size_t count = (end - begin) / sizeof(uint32_t);
+    for (size_t pass = 0; pass < passes; ++pass)
+    {
+        pc = begin;
+        for (size_t i = 0; range ? (pc >= begin && pc < end) : (i < count); ++i)
+        {
+            uintptr_t address = pc;
+            format = *(uint32_t*)address;
+            instruction_pointer inst = map32[opcode >> 2];
+            (this->*inst)();
+            if (check == false)
+                pc += 4;
+            else if (pc == address)
+                pc += 4;
+            if (zero)
+                x[0] = 0;
+        }
+    }
+}
+//------------------------------------------------------------------------------
+// Instruction mixes
+//------------------------------------------------------------------------------
+static void aluMix(encoder& code)
+{
+    code.emit(I(1, A0, 0b000, A0, 0b0010011));             // addi a0, a0, 1
+    code.emit(R(0, A0, A1, 0b100, A1, 0b0110011));          // xor  a1, a1, a0
+    code.emit(I(3, A1, 0b001, T0, 0b0010011));             // slli t0, a1, 3
+    code.emit(R(0, T0, A1, 0b000, A1, 0b0110011));          // add  a1, a1, t0
+    code.emit(R(0b0100000, A0, A3, 0b000, A3, 0b0110011));  // sub  a3, a3, a0
+    code.emit(R(0, A1, A3, 0b111, A4, 0b0110011));          // and  a4, a3, a1
+    code.emit(R(0, A4, A0, 0b110, A5, 0b0110011));          // or   a5, a0, a4
+    code.emit(I(5, A5, 0b101, T1, 0b0010011));             // srli t1, a5, 5
+    code.emit(R(0, T1, A3, 0b010, T2, 0b0110011));          // slt  t2, a3, t1
+    code.emit(R(0, T2, A4, 0b000, A4, 0b0111011));          // addw a4, a4, t2
+    code.loop(0);
+}
+//------------------------------------------------------------------------------
+static void branchMix(encoder& code)
+{
+    code.emit(I(1, A2, 0b111, T0, 0b0010011));             // andi t0, a2, 1
+    code.emit(B(8, ZERO, T0, 0b000));                       // beq  t0, zero, +8
+    code.emit(I(1, A0, 0b000, A0, 0b0010011));             // addi a0, a0, 1
+    code.emit(I(2, A2, 0b111, T1, 0b0010011));             // andi t1, a2, 2
+    code.emit(B(8, ZERO, T1, 0b001));                       // bne  t1, zero, +8
+    code.emit(I(1, A1, 0b000, A1, 0b0010011));             // addi a1, a1, 1
+    code.emit(B(8, A1, A0, 0b100));                         // blt  a0, a1, +8
+    code.emit(I(1, A3, 0b000, A3, 0b0010011));             // addi a3, a3, 1
+    code.emit(J(8, ZERO));                                  // jal  zero, +8
+    code.emit(I(1, A4, 0b000, A4, 0b0010011));             // addi a4, a4, 1
+    code.emit(B(8, A0, A1, 0b101));                         // bge  a1, a0, +8
+    code.emit(I(1, A5, 0b000, A5, 0b0010011));             // addi a5, a5, 1
+    code.loop(0);
+}
+//------------------------------------------------------------------------------
+static void memoryMix(encoder& code)
+{
+    code.emit(I(0, A0, 0b011, T0, 0b0000011));             // ld   t0, 0(a0)
+    code.emit(I(8, A0, 0b011, T1, 0b0000011));             // ld   t1, 8(a0)
+    code.emit(R(0, T1, T0, 0b000, T0, 0b0110011));          // add  t0, t0, t1
+    code.emit(S(16, T0, A0, 0b011, 0b0100011));             // sd   t0, 16(a0)
+    code.emit(I(24, A0, 0b010, T2, 0b0000011));            // lw   t2, 24(a0)
+    code.emit(S(28, T2, A0, 0b010, 0b0100011));             // sw   t2, 28(a0)
+    code.emit(I(3, A0, 0b100, T0, 0b0000011));             // lbu  t0, 3(a0)
+    code.emit(S(32, T0, A0, 0b000, 0b0100011));             // sb   t0, 32(a0)
+    code.emit(I(40, A0, 0b011, T1, 0b0000011));            // ld   t1, 40(a0)
+    code.emit(S(48, T1, A0, 0b011, 0b0100011));             // sd   t1, 48(a0)
+    code.loop(0);
+}
+//------------------------------------------------------------------------------
+static void floatMix(encoder& code)
+{
+    code.emit(I(0, A0, 0b010, 0, 0b0000111));              // flw     f0, 0(a0)
+    code.emit(I(4, A0, 0b010, 1, 0b0000111));              // flw     f1, 4(a0)
+    code.emit(R(0b0000000, 1, 0, 0b000, 2, 0b1010011));     // fadd.s  f2, f0, f1
+    code.emit(R(0b0001000, 1, 2, 0b000, 3, 0b1010011));     // fmul.s  f3, f2, f1
+    code.emit(R4(4, 0b00, 1, 0, 0b000, 4, 0b1000011));      // fmadd.s f4, f0, f1, f4
+    code.emit(R(0b0000100, 2, 3, 0b000, 5, 0b1010011));     // fsub.s  f5, f3, f2
+    code.emit(S(8, 5, A0, 0b010, 0b0100111));               // fsw     f5, 8(a0)
+    code.emit(S(12, 4, A0, 0b010, 0b0100111));              // fsw     f4, 12(a0)
+    code.loop(0);
+}
+//------------------------------------------------------------------------------
+static void straightBlock(encoder& code)
+{
+    static const uint32_t pattern[] =
+    {
+        I(1, A0, 0b000, A0, 0b0010011),                     // addi a0, a0, 1
+        R(0, A0, A1, 0b100, A1, 0b0110011),                 // xor  a1, a1, a0
+        R(0, A1, A3, 0b000, A3, 0b0110011),                 // add  a3, a3, a1
+        I(7, A3, 0b111, A4, 0b0010011),                     // andi a4, a3, 7
+    };
+    for (size_t i = 0; i < 256; ++i)
+    {
+        code.emit(pattern[i % 4]);
+    }
+}
+//------------------------------------------------------------------------------
+// Measurement
+//------------------------------------------------------------------------------
+static uint64_t now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+//------------------------------------------------------------------------------
+static void environmentCall(riscv_cpu& cpu)
+{
+    // exit
+    if (cpu.x[17].u == 93)
+        cpu.pc = 0;
+}
+//------------------------------------------------------------------------------
+static uint8_t buffer[4096];
+//------------------------------------------------------------------------------
+static void prepare(dispatch_cpu& cpu, const encoder& code, size_t count)
+{
+    cpu.program(code.code, code.size * sizeof(uint32_t));
+    cpu.x[A0] = (uintptr_t)buffer;
+    cpu.x[A2] = count;
+}
+//------------------------------------------------------------------------------
+static void print(const char* suite, const char* workload, const char* strategy, uint64_t instructions, uint64_t nanoseconds)
+{
+    printf("%s,%s,%s,%llu,%llu,%.4f\n", suite, workload, strategy,
+           (unsigned long long)instructions,
+           (unsigned long long)nanoseconds,
+           instructions ? double(nanoseconds) / instructions : 0.0);
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    int repeat = 5;
+    size_t count = 1000000;
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (strcmp(argv[arg], "-r") == 0 && arg + 1 < argc)
+            repeat = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "-n") == 0 && arg + 1 < argc)
+            count = strtoul(argv[++arg], nullptr, 10);
+        else
+        {
+            fprintf(stderr, "usage: %s [-r repeat] [-n iterations]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (repeat < 1)
+        repeat = 1;
+    if (dispatch_cpu::current() == false)
+    {
+        fprintf(stderr, "MAP32 does not match riscv_cpu::map32\n");
+        return 1;
+    }
+
+    dispatch_cpu cpu;
+    cpu.environmentCall = environmentCall;
+
+    printf("suite,workload,strategy,instructions,nanoseconds,ns_per_instruction\n");
+
+    static const struct
+    {
+        const char* name;
+        void (*build)(encoder& code);
+    } mixes[] =
+    {
+        { "alu",    aluMix      },
+        { "branch", branchMix   },
+        { "memory", memoryMix   },
+        { "float",  floatMix    },
+    };
+    static const struct
+    {
+        const char* name;
+        void (dispatch_cpu::*execute)();
+    } strategies[] =
+    {
+        { "run",        &dispatch_cpu::viaRun           },
+        { "map32",      &dispatch_cpu::viaMap32         },
+        { "switch",     &dispatch_cpu::viaSwitch        },
+        { "threaded",   &dispatch_cpu::viaThreaded      },
+        { "predecoded", &dispatch_cpu::viaPredecoded    },
+    };
+
+    for (const auto& mix : mixes)
+    {
+        encoder code = {};
+        mix.build(code);
+
+        // Reference instruction count
+        uint64_t instructions = 0;
+        prepare(cpu, code, count);
+        while (cpu.pc >= cpu.begin && cpu.pc < cpu.end && cpu.issue())
+            instructions++;
+
+        for (const auto& strategy : strategies)
+        {
+            uint64_t best = UINT64_MAX;
+            for (int r = 0; r < repeat; ++r)
+            {
+                prepare(cpu, code, count);
+                cpu.predecode();
+                uint64_t begin = now();
+                (cpu.*strategy.execute)();
+                uint64_t elapsed = now() - begin;
+                if (best > elapsed)
+                    best = elapsed;
+            }
+            print("dispatch", mix.name, strategy.name, instructions, best);
+        }
+    }
+
+    static const struct
+    {
+        const char* name;
+        void (dispatch_cpu::*execute)(size_t passes);
+    } costs[] =
+    {
+        { "baseline",   &dispatch_cpu::straight<true, true, true>       },
+        { "no-x0",      &dispatch_cpu::straight<false, true, true>      },
+        { "no-check",   &dispatch_cpu::straight<true, false, true>      },
+        { "no-range",   &dispatch_cpu::straight<true, true, false>      },
+        { "none",       &dispatch_cpu::straight<false, false, false>    },
+    };
+
+    encoder code = {};
+    straightBlock(code);
+    size_t passes = count / 32 + 1;
+    for (const auto& cost : costs)
+    {
+        uint64_t best = UINT64_MAX;
+        for (int r = 0; r < repeat; ++r)
+        {
+            prepare(cpu, code, 0);
+            uint64_t begin = now();
+            (cpu.*cost.execute)(passes);
+            uint64_t elapsed = now() - begin;
+            if (best > elapsed)
+                best = elapsed;
+        }
+        print("fixed", "straight", cost.name, passes * code.size, best);
+    }
+
+    return 0;
+}
+//------------------------------------------------------------------------------
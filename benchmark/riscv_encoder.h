@@ -0,0 +1,73 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//------------------------------------------------------------------------------
+// Instruction encoders for hand-written benchmark kernels
+//------------------------------------------------------------------------------
+enum
+{
+    ZERO = 0, RA = 1, SP = 2, T0 = 5, T1 = 6, T2 = 7,
+    A0 = 10, A1 = 11, A2 = 12, A3 = 13, A4 = 14, A5 = 15, A6 = 16, A7 = 17,
+};
+//------------------------------------------------------------------------------
+inline uint32_t R(uint32_t funct7, int rs2, int rs1, uint32_t funct3, int rd, uint32_t opcode)
+{
+    return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+}
+//------------------------------------------------------------------------------
+inline uint32_t R4(int rs3, uint32_t fmt, int rs2, int rs1, uint32_t rm, int rd, uint32_t opcode)
+{
+    return (rs3 << 27) | (fmt << 25) | (rs2 << 20) | (rs1 << 15) | (rm << 12) | (rd << 7) | opcode;
+}
+//------------------------------------------------------------------------------
+inline uint32_t I(int32_t imm, int rs1, uint32_t funct3, int rd, uint32_t opcode)
+{
+    return (uint32_t(imm) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+}
+//------------------------------------------------------------------------------
+inline uint32_t S(int32_t imm, int rs2, int rs1, uint32_t funct3, uint32_t opcode)
+{
+    return ((uint32_t(imm) >> 5 & 0x7F) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | ((imm & 0x1F) << 7) | opcode;
+}
+//------------------------------------------------------------------------------
+inline uint32_t B(int32_t imm, int rs2, int rs1, uint32_t funct3)
+{
+    uint32_t u = uint32_t(imm);
+    return ((u >> 12 & 1) << 31) | ((u >> 5 & 0x3F) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | ((u >> 1 & 0xF) << 8) | ((u >> 11 & 1) << 7) | 0b1100011;
+}
+//------------------------------------------------------------------------------
+inline uint32_t J(int32_t imm, int rd)
+{
+    uint32_t u = uint32_t(imm);
+    return ((u >> 20 & 1) << 31) | ((u >> 1 & 0x3FF) << 21) | ((u >> 11 & 1) << 20) | ((u >> 12 & 0xFF) << 12) | (rd << 7) | 0b1101111;
+}
+//------------------------------------------------------------------------------
+struct encoder
+{
+    uint32_t code[512];
+    size_t size;
+
+    void emit(uint32_t format)
+    {
+        code[size++] = format;
+    }
+    void loop(size_t begin)
+    {
+        // addi a2, a2, -1 / bne a2, zero, begin / addi a0, zero, 0 / addi a7, zero, 93 / ecall
+        emit(I(-1, A2, 0b000, A2, 0b0010011));
+        emit(B(int32_t(begin - size) * 4, ZERO, A2, 0b001));
+        emit(I(0, ZERO, 0b000, A0, 0b0010011));
+        emit(I(93, ZERO, 0b000, A7, 0b0010011));
+        emit(0b1110011);
+    }
+};
+//------------------------------------------------------------------------------
@@ -0,0 +1,131 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+#include "../riscv_cpu.h"
+#include "riscv_encoder.h"
+
+//------------------------------------------------------------------------------
+// Per-instance memory footprint
+//------------------------------------------------------------------------------
+// Creates N idle instances and reports the process RSS growth per instance
+// next to what riscv_cpu::footprint() accounts for. A second pass runs a tiny
+// guest in every instance which stores to its stack, so the cost of a touched
+// stack page shows up separately. All instances share one code page, which
+// footprint() counts as guest memory for every one of them.
+//------------------------------------------------------------------------------
+static size_t rss()
+{
+#if defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS)
+        return 0;
+    return info.resident_size;
+#else
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (file == nullptr)
+        return 0;
+    if (fscanf(file, "%lu %lu", &size, &resident) != 2)
+        resident = 0;
+    fclose(file);
+    return resident * sysconf(_SC_PAGESIZE);
+#endif
+}
+//------------------------------------------------------------------------------
+static void environmentCall(riscv_cpu& cpu)
+{
+    // exit
+    if (cpu.x[17].u == 93)
+        cpu.pc = 0;
+}
+//------------------------------------------------------------------------------
+static void report(const char* phase, riscv_cpu** cpus, size_t count, size_t before, size_t after)
+{
+    riscv_cpu::footprint_t sum = {};
+    for (size_t i = 0; i < count; ++i)
+    {
+        riscv_cpu::footprint_t footprint = cpus[i]->footprint();
+        sum.registers += footprint.registers;
+        sum.stack += footprint.stack;
+        sum.guest += footprint.guest;
+        sum.plugin += footprint.plugin;
+        sum.cache += footprint.cache;
+    }
+
+    double growth = after > before ? double(after - before) / count : 0.0;
+    printf("%-8s %8zu %14.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", phase, count, growth,
+           double(sum.total()) / count,
+           double(sum.registers) / count,
+           double(sum.stack) / count,
+           double(sum.guest) / count,
+           double(sum.plugin) / count);
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    size_t count = 1000;
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (strcmp(argv[arg], "-n") == 0 && arg + 1 < argc)
+            count = strtoul(argv[++arg], nullptr, 10);
+        else
+        {
+            fprintf(stderr, "usage: %s [-n instances]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (count < 1)
+        count = 1;
+
+    // sd a0, -8(sp) / addi a7, zero, 93 / ecall
+    static const uint32_t code[] =
+    {
+        S(-8, A0, SP, 0b011, 0b0100011),
+        I(93, ZERO, 0b000, A7, 0b0010011),
+        0b1110011,
+    };
+
+    riscv_cpu** cpus = new riscv_cpu*[count];
+
+    printf("%-8s %8s %14s %10s %10s %10s %10s %10s\n", "phase", "count", "rss/instance", "footprint", "registers", "stack", "guest", "plugin");
+
+    size_t before = rss();
+    for (size_t i = 0; i < count; ++i)
+    {
+        cpus[i] = new riscv_cpu;
+        cpus[i]->environmentCall = environmentCall;
+        cpus[i]->program(nullptr, 0);
+    }
+    size_t idle = rss();
+    report("idle", cpus, count, before, idle);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        cpus[i]->program(code, sizeof(code));
+        cpus[i]->run();
+    }
+    size_t touched = rss();
+    report("touched", cpus, count, idle, touched);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        delete cpus[i];
+    }
+    delete[] cpus;
+
+    return 0;
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,260 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include "../libelf/elf.h"
+#include "../riscv_cpu.h"
+#include "riscv_encoder.h"
+
+//------------------------------------------------------------------------------
+// Startup latency benchmark
+//------------------------------------------------------------------------------
+// Every iteration starts from the ELF bytes and times each phase up to the
+// first retired instruction
+//   newFile    elf_newFile() validation
+//   bounds     elf_getMemoryBounds()
+//   load       elf_loadFile() into freshly mapped guest memory
+//   construct  riscv_cpu construction, including the stack allocation
+//   program    riscv_cpu::program()
+//   issue      the first riscv_cpu::issue()
+// The guest memory is mapped before and unmapped after each iteration, so the
+// page faults of the first touch are part of the load phase.
+//------------------------------------------------------------------------------
+enum
+{
+    NEWFILE,
+    BOUNDS,
+    LOAD,
+    CONSTRUCT,
+    PROGRAM,
+    ISSUE,
+    PHASE_COUNT,
+};
+static const char* const phaseName[PHASE_COUNT] = { "newFile", "bounds", "load", "construct", "program", "issue" };
+//------------------------------------------------------------------------------
+static uint64_t now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+//------------------------------------------------------------------------------
+static int compare(const void* a, const void* b)
+{
+    uint64_t left = *(uint64_t*)a;
+    uint64_t right = *(uint64_t*)b;
+    return (left > right) - (left < right);
+}
+//------------------------------------------------------------------------------
+// Synthetic image
+//------------------------------------------------------------------------------
+// One PT_LOAD segment of the requested size, a null section and .shstrtab.
+// The first instruction is an addi, the rest of the segment is zero.
+//------------------------------------------------------------------------------
+struct image
+{
+    char* data;
+    size_t size;
+    size_t segment;
+};
+//------------------------------------------------------------------------------
+static image synthesize(size_t segment)
+{
+    static const char names[] = "\0.shstrtab";
+    size_t headers = sizeof(Elf64_Ehdr) + sizeof(Elf64_Phdr) + sizeof(Elf64_Shdr) * 2 + sizeof(names);
+    size_t offset = (headers + 4095) & ~size_t(4095);
+
+    image image;
+    image.size = offset + segment;
+    image.segment = segment;
+    image.data = new char[image.size];
+    memset(image.data, 0, offset);
+
+    Elf64_Ehdr* header = (Elf64_Ehdr*)image.data;
+    Elf64_Phdr* program = (Elf64_Phdr*)(header + 1);
+    Elf64_Shdr* sections = (Elf64_Shdr*)(program + 1);
+    char* strings = (char*)(sections + 2);
+    memcpy(header->e_ident, ELFMAG, SELFMAG);
+    header->e_ident[EI_CLASS] = ELFCLASS64;
+    header->e_ident[EI_DATA] = 1;                   // ELFDATA2LSB
+    header->e_ident[EI_VERSION] = 1;                // EV_CURRENT
+    header->e_type = 2;                             // ET_EXEC
+    header->e_machine = 243;                        // EM_RISCV
+    header->e_version = 1;
+    header->e_phoff = (char*)program - image.data;
+    header->e_shoff = (char*)sections - image.data;
+    header->e_ehsize = sizeof(Elf64_Ehdr);
+    header->e_phentsize = sizeof(Elf64_Phdr);
+    header->e_phnum = 1;
+    header->e_shentsize = sizeof(Elf64_Shdr);
+    header->e_shnum = 2;
+    header->e_shstrndx = 1;
+
+    program->p_type = 1;                            // PT_LOAD
+    program->p_flags = 5;                           // PF_R | PF_X
+    program->p_offset = offset;
+    program->p_filesz = segment;
+    program->p_memsz = segment;
+    program->p_align = 4096;
+
+    sections[1].sh_name = 1;
+    sections[1].sh_type = SHT_STRTAB;
+    sections[1].sh_offset = strings - image.data;
+    sections[1].sh_size = sizeof(names);
+    memcpy(strings, names, sizeof(names));
+
+    memset(image.data + offset, 0, segment);
+    *(uint32_t*)(image.data + offset) = I(1, A0, 0b000, A0, 0b0010011);    // addi a0, a0, 1
+
+    return image;
+}
+//------------------------------------------------------------------------------
+static void relocate(image& image, uintptr_t address)
+{
+    Elf64_Ehdr* header = (Elf64_Ehdr*)image.data;
+    Elf64_Phdr* program = (Elf64_Phdr*)(image.data + header->e_phoff);
+    header->e_entry = address;
+    program->p_vaddr = address;
+    program->p_paddr = address;
+}
+//------------------------------------------------------------------------------
+// Measurement
+//------------------------------------------------------------------------------
+static void measure(image& image, size_t iterations)
+{
+    uint64_t* samples[PHASE_COUNT];
+    for (int i = 0; i < PHASE_COUNT; ++i)
+    {
+        samples[i] = new uint64_t[iterations];
+    }
+
+    for (size_t iteration = 0; iteration < iterations; ++iteration)
+    {
+        void* memory = mmap(nullptr, image.segment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+        {
+            fprintf(stderr, "mmap %zu bytes failed\n", image.segment);
+            exit(1);
+        }
+        relocate(image, (uintptr_t)memory);
+
+        uint64_t time[PHASE_COUNT + 1];
+        elf_t elf;
+        uintptr_t low;
+        uintptr_t high;
+
+        time[NEWFILE] = now();
+        int result = elf_newFile(image.data, image.size, &elf);
+        time[BOUNDS] = now();
+        elf_getMemoryBounds(&elf, VIRTUAL, &low, &high);
+        time[LOAD] = now();
+        elf_loadFile(&elf, VIRTUAL);
+        time[CONSTRUCT] = now();
+        riscv_cpu* cpu = new riscv_cpu;
+        time[PROGRAM] = now();
+        uintptr_t entry = elf_getEntryPoint(&elf);
+        cpu->program((void*)entry, high - entry);
+        time[ISSUE] = now();
+        cpu->issue();
+        time[PHASE_COUNT] = now();
+
+        if (result < 0 || cpu->x[A0].u != 1)
+        {
+            fprintf(stderr, "synthetic image of %zu bytes did not start\n", image.segment);
+            exit(1);
+        }
+
+        for (int i = 0; i < PHASE_COUNT; ++i)
+        {
+            samples[i][iteration] = time[i + 1] - time[i];
+        }
+
+        delete cpu;
+        munmap(memory, image.segment);
+    }
+
+    for (int i = 0; i < PHASE_COUNT; ++i)
+    {
+        uint64_t* sample = samples[i];
+        qsort(sample, iterations, sizeof(uint64_t), compare);
+        printf("%12zu %10s %8zu %12llu %12llu %12llu %12llu %12llu\n", image.segment, phaseName[i], iterations,
+               (unsigned long long)sample[iterations * 50 / 100],
+               (unsigned long long)sample[iterations * 90 / 100],
+               (unsigned long long)sample[iterations * 99 / 100],
+               (unsigned long long)sample[iterations * 999 / 1000],
+               (unsigned long long)sample[iterations - 1]);
+        delete[] sample;
+    }
+}
+//------------------------------------------------------------------------------
+static size_t parseSize(const char* text)
+{
+    char* suffix = nullptr;
+    size_t size = strtoul(text, &suffix, 10);
+    switch (suffix ? *suffix : 0)
+    {
+    case 'k': case 'K': size <<= 10; break;
+    case 'm': case 'M': size <<= 20; break;
+    case 'g': case 'G': size <<= 30; break;
+    }
+    return size;
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    size_t iterations = 5000;
+    size_t sizes[32] = { 4 << 10, 64 << 10, 1 << 20, 16 << 20, 256 << 20 };
+    size_t sizeCount = 5;
+    bool custom = false;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (strcmp(argv[arg], "-n") == 0 && arg + 1 < argc)
+        {
+            iterations = strtoul(argv[++arg], nullptr, 10);
+        }
+        else if (strcmp(argv[arg], "-s") == 0 && arg + 1 < argc)
+        {
+            if (custom == false)
+                sizeCount = 0;
+            custom = true;
+            if (sizeCount < sizeof(sizes) / sizeof(sizes[0]))
+                sizes[sizeCount++] = parseSize(argv[++arg]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-n iterations] [-s size[K|M|G]]...\n", argv[0]);
+            return 1;
+        }
+    }
+    if (iterations < 1)
+        iterations = 1;
+
+    printf("%12s %10s %8s %12s %12s %12s %12s %12s\n", "image", "phase", "samples", "p50 ns", "p90 ns", "p99 ns", "p99.9 ns", "max ns");
+    for (size_t i = 0; i < sizeCount; ++i)
+    {
+        size_t size = sizes[i] < sizeof(uint32_t) ? sizeof(uint32_t) : sizes[i];
+
+        // Beyond 1 MiB the load phase dominates, so fewer samples are taken
+        size_t count = iterations;
+        if (size > (1 << 20))
+            count = iterations / (size >> 20);
+        if (count < 16)
+            count = 16;
+
+        image image = synthesize(size);
+        measure(image, count);
+        delete[] image.data;
+    }
+
+    return 0;
+}
+//------------------------------------------------------------------------------
@@ -7,6 +7,7 @@
 #include "elf.h"
 #include "elf32.h"
 #include "elf64.h"
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -179,8 +180,15 @@ const void *elf_getSection(const elf_t *elf, size_t i)
     return elf->elfFile + section_offset;
 }
 
+static uint32_t elf_hashName(const char *name);
+static const void *elf_getSectionIndexed(const elf_t *elfFile, const char *str, size_t *id);
+
 const void *elf_getSectionNamed(const elf_t *elfFile, const char *str, size_t *id)
 {
+    if (elfFile->index != NULL) {
+        return elf_getSectionIndexed(elfFile, str, id);
+    }
+
     size_t numSections = elf_getNumSections(elfFile);
     for (size_t i = 0; i < numSections; i++) {
         if (strcmp(str, elf_getSectionName(elfFile, i)) == 0) {
@@ -388,36 +396,11 @@ size_t elf_getProgramHeaderAlign(const elf_t *elfFile, size_t ph)
 /* Utility functions */
 int elf_getMemoryBounds(const elf_t *elfFile, elf_addr_type_t addr_type, uintptr_t *min, uintptr_t *max)
 {
-    uintptr_t mem_min = UINTPTR_MAX;
-    uintptr_t mem_max = 0;
-    size_t i;
-
-    for (i = 0; i < elf_getNumProgramHeaders(elfFile); i++) {
-        uintptr_t sect_min, sect_max;
-
-        if (elf_getProgramHeaderMemorySize(elfFile, i) == 0) {
-            continue;
-        }
-
-        if (addr_type == PHYSICAL) {
-            sect_min = elf_getProgramHeaderPaddr(elfFile, i);
-        } else {
-            sect_min = elf_getProgramHeaderVaddr(elfFile, i);
-        }
-
-        sect_max = sect_min + elf_getProgramHeaderMemorySize(elfFile, i);
-
-        if (sect_max > mem_max) {
-            mem_max = sect_max;
-        }
-        if (sect_min < mem_min) {
-            mem_min = sect_min;
-        }
+    if (elf_isElf32(elfFile)) {
+        return elf32_getMemoryBounds(elfFile, addr_type, min, max);
+    } else {
+        return elf64_getMemoryBounds(elfFile, addr_type, min, max);
     }
-    *min = mem_min;
-    *max = mem_max;
-
-    return 1;
 }
 
 int elf_vaddrInProgramHeader(const elf_t *elfFile, size_t ph, uintptr_t vaddr)
@@ -444,23 +427,379 @@ uintptr_t elf_vtopProgramHeader(const elf_t *elfFile, size_t ph, uintptr_t vaddr
 
 int elf_loadFile(const elf_t *elf, elf_addr_type_t addr_type)
 {
-    size_t i;
+    if (elf_isElf32(elf)) {
+        return elf32_loadFile(elf, addr_type);
+    } else {
+        return elf64_loadFile(elf, addr_type);
+    }
+}
 
-    for (i = 0; i < elf_getNumProgramHeaders(elf); i++) {
-        /* Load that section */
-        uintptr_t dest, src;
-        size_t len;
-        if (addr_type == PHYSICAL) {
-            dest = elf_getProgramHeaderPaddr(elf, i);
+
+/* Symbol table functions */
+size_t elf_getSymbolTableIndex(const elf_t *elf)
+{
+    size_t dynamic = 0;
+    size_t numSections = elf_getNumSections(elf);
+    for (size_t i = 1; i < numSections; i++) {
+        uint32_t type = elf_getSectionType(elf, i);
+        if (type == SHT_SYMTAB) {
+            return i;
+        }
+        if (type == SHT_DYNSYM && dynamic == 0) {
+            dynamic = i;
+        }
+    }
+    return dynamic;
+}
+
+size_t elf_getNumSymbols(const elf_t *elf, size_t s)
+{
+    if (elf_getSection(elf, s) == NULL) {
+        return 0; /* no such section */
+    }
+
+    if (elf_isElf32(elf)) {
+        return elf32_getNumSymbols(elf, s);
+    } else {
+        return elf64_getNumSymbols(elf, s);
+    }
+}
+
+static size_t elf_getSymbolNameOffset(const elf_t *elf, size_t s, size_t i)
+{
+    if (elf_isElf32(elf)) {
+        return elf32_getSymbolNameOffset(elf, s, i);
+    } else {
+        return elf64_getSymbolNameOffset(elf, s, i);
+    }
+}
+
+const char *elf_getSymbolName(const elf_t *elf, size_t s, size_t i)
+{
+    size_t str_table_idx = elf_getSectionLink(elf, s);
+    const char *str_table = elf_getStringTable(elf, str_table_idx);
+    size_t offset = elf_getSymbolNameOffset(elf, s, i);
+    size_t size = elf_getSectionSize(elf, str_table_idx);
+
+    if (str_table == NULL || offset >= size) {
+        return "<corrupted>";
+    }
+
+    return str_table + offset;
+}
+
+uintptr_t elf_getSymbolValue(const elf_t *elf, size_t s, size_t i)
+{
+    if (elf_isElf32(elf)) {
+        return elf32_getSymbolValue(elf, s, i);
+    } else {
+        return elf64_getSymbolValue(elf, s, i);
+    }
+}
+
+size_t elf_getSymbolSize(const elf_t *elf, size_t s, size_t i)
+{
+    if (elf_isElf32(elf)) {
+        return elf32_getSymbolSize(elf, s, i);
+    } else {
+        return elf64_getSymbolSize(elf, s, i);
+    }
+}
+
+unsigned char elf_getSymbolInfo(const elf_t *elf, size_t s, size_t i)
+{
+    if (elf_isElf32(elf)) {
+        return elf32_getSymbolInfo(elf, s, i);
+    } else {
+        return elf64_getSymbolInfo(elf, s, i);
+    }
+}
+
+size_t elf_getSymbolSectionIndex(const elf_t *elf, size_t s, size_t i)
+{
+    if (elf_isElf32(elf)) {
+        return elf32_getSymbolSectionIndex(elf, s, i);
+    } else {
+        return elf64_getSymbolSectionIndex(elf, s, i);
+    }
+}
+
+/* Defined symbols which can be found by name */
+static bool elf_isNamedSymbol(const elf_t *elf, size_t s, size_t i)
+{
+    size_t shndx = elf_getSymbolSectionIndex(elf, s, i);
+    return shndx != SHN_UNDEF && elf_getSymbolName(elf, s, i)[0] != 0;
+}
+
+/* Functions, objects and labels inside a regular section */
+static bool elf_isAddressSymbol(const elf_t *elf, size_t s, size_t i)
+{
+    unsigned char type = ELF_ST_TYPE(elf_getSymbolInfo(elf, s, i));
+    size_t shndx = elf_getSymbolSectionIndex(elf, s, i);
+    if (type != STT_FUNC && type != STT_OBJECT && type != STT_NOTYPE) {
+        return false;
+    }
+    return shndx != SHN_UNDEF && shndx < 0xff00 && elf_getSymbolName(elf, s, i)[0] != 0;
+}
+
+static int elf_findSymbolNamed(const elf_t *elf, const char *name, uintptr_t *value, size_t *size)
+{
+    size_t s = elf_getSymbolTableIndex(elf);
+    size_t numSymbols = elf_getNumSymbols(elf, s);
+    size_t found = numSymbols;
+    for (size_t i = 1; i < numSymbols; i++) {
+        if (elf_isNamedSymbol(elf, s, i) == false || strcmp(name, elf_getSymbolName(elf, s, i)) != 0) {
+            continue;
+        }
+        if (ELF_ST_BIND(elf_getSymbolInfo(elf, s, i)) != STB_LOCAL) {
+            found = i;
+            break; /* global or weak symbols take precedence over local ones */
+        }
+        if (found == numSymbols) {
+            found = i; /* otherwise the first local one, as in the index */
+        }
+    }
+    if (found == numSymbols) {
+        return -1;
+    }
+
+    *value = elf_getSymbolValue(elf, s, found);
+    if (size != NULL) {
+        *size = elf_getSymbolSize(elf, s, found);
+    }
+    return 0;
+}
+
+static const char *elf_findSymbolAt(const elf_t *elf, uintptr_t address, uintptr_t *base, size_t *size)
+{
+    size_t s = elf_getSymbolTableIndex(elf);
+    size_t numSymbols = elf_getNumSymbols(elf, s);
+    size_t found = numSymbols;
+    uintptr_t best = 0;
+    for (size_t i = 1; i < numSymbols; i++) {
+        uintptr_t value = elf_getSymbolValue(elf, s, i);
+        if (value > address || elf_isAddressSymbol(elf, s, i) == false) {
+            continue;
+        }
+        if (found == numSymbols || value >= best) {
+            found = i;
+            best = value;
+        }
+    }
+    if (found == numSymbols) {
+        return NULL;
+    }
+
+    size_t found_size = elf_getSymbolSize(elf, s, found);
+    if (found_size != 0 && address - best >= found_size) {
+        return NULL;
+    }
+    if (base != NULL) {
+        *base = best;
+    }
+    if (size != NULL) {
+        *size = found_size;
+    }
+    return elf_getSymbolName(elf, s, found);
+}
+
+
+/* Index functions */
+struct elf_index_symbol {
+    uintptr_t value;
+    size_t size;
+    size_t symbol;
+};
+
+struct elf_index {
+    uint32_t *sections;         /* section name hash, section index + 1 */
+    size_t sectionMask;
+    size_t symbolTable;
+    uint32_t *symbols;          /* symbol name hash, symbol index + 1 */
+    size_t symbolMask;
+    struct elf_index_symbol *addresses; /* sorted by value */
+    size_t addressCount;
+};
+
+static uint32_t elf_hashName(const char *name)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+    while (*name) {
+        hash = (hash ^ (unsigned char) *name++) * 16777619u;
+    }
+    return hash;
+}
+
+static size_t elf_hashSize(size_t count)
+{
+    size_t size = 16;
+    while (size < count * 2) {
+        size *= 2;
+    }
+    return size;
+}
+
+static void elf_hashInsert(uint32_t *table, size_t mask, const char *name, size_t i)
+{
+    size_t h = elf_hashName(name) & mask;
+    while (table[h] != 0) {
+        h = (h + 1) & mask;
+    }
+    table[h] = (uint32_t)(i + 1);
+}
+
+static int elf_compareAddress(const void *a, const void *b)
+{
+    const struct elf_index_symbol *left = a;
+    const struct elf_index_symbol *right = b;
+    if (left->value != right->value) {
+        return left->value < right->value ? -1 : 1;
+    }
+    return (left->symbol > right->symbol) - (left->symbol < right->symbol);
+}
+
+int elf_buildIndex(elf_t *elf)
+{
+    elf_freeIndex(elf);
+
+    struct elf_index *index = calloc(1, sizeof(struct elf_index));
+    if (index == NULL) {
+        return -1;
+    }
+
+    size_t numSections = elf_getNumSections(elf);
+    index->sectionMask = elf_hashSize(numSections) - 1;
+    index->sections = calloc(index->sectionMask + 1, sizeof(uint32_t));
+
+    size_t s = elf_getSymbolTableIndex(elf);
+    size_t numSymbols = elf_getNumSymbols(elf, s);
+    index->symbolTable = s;
+    index->symbolMask = elf_hashSize(numSymbols) - 1;
+    index->symbols = calloc(index->symbolMask + 1, sizeof(uint32_t));
+    index->addresses = malloc(sizeof(struct elf_index_symbol) * (numSymbols + 1));
+
+    if (index->sections == NULL || index->symbols == NULL || index->addresses == NULL) {
+        elf->index = index;
+        elf_freeIndex(elf);
+        return -1;
+    }
+
+    for (size_t i = 0; i < numSections; i++) {
+        elf_hashInsert(index->sections, index->sectionMask, elf_getSectionName(elf, i), i);
+    }
+
+    /* global and weak symbols are inserted first so they are found first */
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 1; i < numSymbols; i++) {
+            bool local = ELF_ST_BIND(elf_getSymbolInfo(elf, s, i)) == STB_LOCAL;
+            if (local != (pass == 1) || elf_isNamedSymbol(elf, s, i) == false) {
+                continue;
+            }
+            elf_hashInsert(index->symbols, index->symbolMask, elf_getSymbolName(elf, s, i), i);
+        }
+    }
+
+    for (size_t i = 1; i < numSymbols; i++) {
+        if (elf_isAddressSymbol(elf, s, i) == false) {
+            continue;
+        }
+        struct elf_index_symbol *symbol = &index->addresses[index->addressCount++];
+        symbol->value = elf_getSymbolValue(elf, s, i);
+        symbol->size = elf_getSymbolSize(elf, s, i);
+        symbol->symbol = i;
+    }
+    qsort(index->addresses, index->addressCount, sizeof(struct elf_index_symbol), elf_compareAddress);
+
+    elf->index = index;
+    return 0;
+}
+
+void elf_freeIndex(elf_t *elf)
+{
+    struct elf_index *index = elf->index;
+    if (index == NULL) {
+        return;
+    }
+
+    free(index->sections);
+    free(index->symbols);
+    free(index->addresses);
+    free(index);
+    elf->index = NULL;
+}
+
+static const void *elf_getSectionIndexed(const elf_t *elf, const char *str, size_t *id)
+{
+    const struct elf_index *index = elf->index;
+    size_t h = elf_hashName(str) & index->sectionMask;
+    while (index->sections[h] != 0) {
+        size_t i = index->sections[h] - 1;
+        if (strcmp(str, elf_getSectionName(elf, i)) == 0) {
+            if (id != NULL) {
+                *id = i;
+            }
+            return elf_getSection(elf, i);
+        }
+        h = (h + 1) & index->sectionMask;
+    }
+    return NULL;
+}
+
+int elf_getSymbolNamed(const elf_t *elf, const char *name, uintptr_t *value, size_t *size)
+{
+    const struct elf_index *index = elf->index;
+    if (index == NULL) {
+        return elf_findSymbolNamed(elf, name, value, size);
+    }
+
+    size_t s = index->symbolTable;
+    size_t h = elf_hashName(name) & index->symbolMask;
+    while (index->symbols[h] != 0) {
+        size_t i = index->symbols[h] - 1;
+        if (strcmp(name, elf_getSymbolName(elf, s, i)) == 0) {
+            *value = elf_getSymbolValue(elf, s, i);
+            if (size != NULL) {
+                *size = elf_getSymbolSize(elf, s, i);
+            }
+            return 0;
+        }
+        h = (h + 1) & index->symbolMask;
+    }
+    return -1;
+}
+
+const char *elf_getSymbolAt(const elf_t *elf, uintptr_t address, uintptr_t *base, size_t *size)
+{
+    const struct elf_index *index = elf->index;
+    if (index == NULL) {
+        return elf_findSymbolAt(elf, address, base, size);
+    }
+
+    /* last symbol with a value not above the address */
+    size_t low = 0;
+    size_t high = index->addressCount;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (index->addresses[middle].value <= address) {
+            low = middle + 1;
         } else {
-            dest = elf_getProgramHeaderVaddr(elf, i);
+            high = middle;
         }
-        len = elf_getProgramHeaderFileSize(elf, i);
-        src = (uintptr_t) elf->elfFile + elf_getProgramHeaderOffset(elf, i);
-        memcpy((void *) dest, (void *) src, len);
-        dest += len;
-        memset((void *) dest, 0, elf_getProgramHeaderMemorySize(elf, i) - len);
+    }
+    if (low == 0) {
+        return NULL;
     }
 
-    return 1;
+    const struct elf_index_symbol *symbol = &index->addresses[low - 1];
+    if (symbol->size != 0 && address - symbol->value >= symbol->size) {
+        return NULL;
+    }
+    if (base != NULL) {
+        *base = symbol->value;
+    }
+    if (size != NULL) {
+        *size = symbol->size;
+    }
+    return elf_getSymbolName(elf, index->symbolTable, symbol->symbol);
 }
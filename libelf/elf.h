@@ -163,6 +163,104 @@ typedef struct elf64_shdr {
     Elf64_Xword     sh_entsize;         /* Entry size if section holds table */
 } Elf64_Shdr;
 
+typedef struct elf32_sym {
+    Elf32_Word      st_name;
+    Elf32_Addr      st_value;
+    Elf32_Word      st_size;
+    unsigned char   st_info;
+    unsigned char   st_other;
+    Elf32_Half      st_shndx;
+} Elf32_Sym;
+
+typedef struct elf64_sym {
+    Elf64_Word      st_name;            /* Symbol name, index in string tbl */
+    unsigned char   st_info;            /* Type and binding attributes */
+    unsigned char   st_other;           /* No defined meaning, 0 */
+    Elf64_Half      st_shndx;           /* Associated section index */
+    Elf64_Addr      st_value;           /* Value of the symbol */
+    Elf64_Xword     st_size;            /* Associated symbol size */
+} Elf64_Sym;
+
+#define SHN_UNDEF       0
+
+#define STB_LOCAL       0
+#define STB_GLOBAL      1
+#define STB_WEAK        2
+
+#define STT_NOTYPE      0
+#define STT_OBJECT      1
+#define STT_FUNC        2
+#define STT_SECTION     3
+#define STT_FILE        4
+
+#define ELF_ST_BIND(x)  ((x) >> 4)
+#define ELF_ST_TYPE(x)  ((x) & 0xf)
+
+#define ET_NONE         0               /* e_type */
+#define ET_REL          1
+#define ET_EXEC         2
+#define ET_DYN          3
+
+#define EM_RISCV        243             /* e_machine */
+
+#define PT_NULL         0               /* p_type */
+#define PT_LOAD         1
+#define PT_DYNAMIC      2
+#define PT_INTERP       3
+#define PT_NOTE         4
+#define PT_PHDR         6
+#define PT_TLS          7
+
+#define PF_X            0x1             /* p_flags */
+#define PF_W            0x2
+#define PF_R            0x4
+
+typedef struct elf32_dyn {
+    Elf32_Sword     d_tag;
+    union {
+        Elf32_Word  d_val;
+        Elf32_Addr  d_ptr;
+    } d_un;
+} Elf32_Dyn;
+
+typedef struct elf64_dyn {
+    Elf64_Sxword    d_tag;              /* entry tag value */
+    union {
+        Elf64_Xword d_val;
+        Elf64_Addr  d_ptr;
+    } d_un;
+} Elf64_Dyn;
+
+#define DT_NULL         0               /* d_tag */
+#define DT_NEEDED       1
+#define DT_PLTRELSZ     2
+#define DT_PLTGOT       3
+#define DT_HASH         4
+#define DT_STRTAB       5
+#define DT_SYMTAB       6
+#define DT_RELA         7
+#define DT_RELASZ       8
+#define DT_RELAENT      9
+#define DT_STRSZ        10
+#define DT_SYMENT       11
+#define DT_PLTREL       20
+#define DT_JMPREL       23
+
+typedef struct elf32_rela {
+    Elf32_Addr      r_offset;
+    Elf32_Word      r_info;
+    Elf32_Sword     r_addend;
+} Elf32_Rela;
+
+typedef struct elf64_rela {
+    Elf64_Addr      r_offset;           /* Location at which to apply the action */
+    Elf64_Xword     r_info;             /* index and type of relocation */
+    Elf64_Sxword    r_addend;           /* Constant addend used to compute value */
+} Elf64_Rela;
+
+#define ELF64_R_SYM(i)  ((i) >> 32)
+#define ELF64_R_TYPE(i) ((i) & 0xffffffff)
+
 #define EI_MAG0         0               /* e_ident[] indexes */
 #define EI_MAG1         1
 #define EI_MAG2         2
@@ -185,10 +283,13 @@ typedef struct elf64_shdr {
 #define ELFCLASS64      2
 #define ELFCLASSNUM     3
 
+struct elf_index;
+
 struct elf {
     void const *elfFile;
     size_t elfSize;
     unsigned char elfClass; /* 32-bit or 64-bit */
+    struct elf_index *index; /* built on request by elf_buildIndex */
 };
 typedef struct elf elf_t;
 
@@ -601,6 +702,97 @@ uintptr_t elf_vtopProgramHeader(const elf_t *elfFile, size_t ph, uintptr_t vaddr
  */
 int elf_loadFile(const elf_t *elfFile, elf_addr_type_t addr_type);
 
+
+/* Symbol table functions */
+/**
+ * Find the symbol table of an ELF file, .symtab if present, otherwise .dynsym.
+ *
+ * @param elfFile Pointer to a valid ELF structure
+ *
+ * \return The section index of the symbol table, or 0 if there is none.
+ */
+size_t elf_getSymbolTableIndex(const elf_t *elfFile);
+
+/**
+ * Determine number of symbols in a symbol table section.
+ *
+ * @param elfFile Pointer to a valid ELF structure
+ * @param s Section index of the symbol table
+ *
+ * \return Number of symbols in the section.
+ */
+size_t elf_getNumSymbols(const elf_t *elfFile, size_t s);
+
+/**
+ * Return the name of a given symbol.
+ *
+ * @param elfFile Pointer to a valid ELF structure
+ * @param s Section index of the symbol table
+ * @param i Index of the symbol
+ *
+ * \return The name of the symbol.
+ */
+const char *elf_getSymbolName(const elf_t *elfFile, size_t s, size_t i);
+
+/**
+ * Return the value, size, info byte or section index of a given symbol.
+ *
+ * @param elfFile Pointer to a valid ELF structure
+ * @param s Section index of the symbol table
+ * @param i Index of the symbol
+ */
+uintptr_t elf_getSymbolValue(const elf_t *elfFile, size_t s, size_t i);
+size_t elf_getSymbolSize(const elf_t *elfFile, size_t s, size_t i);
+unsigned char elf_getSymbolInfo(const elf_t *elfFile, size_t s, size_t i);
+size_t elf_getSymbolSectionIndex(const elf_t *elfFile, size_t s, size_t i);
+
+/**
+ * Find a symbol by name.
+ * Uses the index when one has been built, otherwise scans the symbol table.
+ *
+ * @param elfFile Pointer to a valid ELF structure
+ * @param name Name of the symbol
+ * @param value Pointer to store the value of the symbol
+ * @param size Pointer to store the size of the symbol, may be NULL
+ *
+ * \return 0 on success, otherwise < 0
+ */
+int elf_getSymbolNamed(const elf_t *elfFile, const char *name, uintptr_t *value, size_t *size);
+
+/**
+ * Find the function or object symbol which contains an address.
+ * Symbols without a size match every address up to the next symbol.
+ * Uses the index when one has been built, otherwise scans the symbol table.
+ *
+ * @param elfFile Pointer to a valid ELF structure
+ * @param address Address to look up
+ * @param base Pointer to store the value of the symbol, may be NULL
+ * @param size Pointer to store the size of the symbol, may be NULL
+ *
+ * \return The name of the symbol, or NULL if no symbol contains the address.
+ */
+const char *elf_getSymbolAt(const elf_t *elfFile, uintptr_t address, uintptr_t *base, size_t *size);
+
+
+/* Index functions */
+/**
+ * Build hash tables for section and symbol names and an address-sorted table
+ * of symbols, and cache them in elfFile->index. elf_getSectionNamed,
+ * elf_getSymbolNamed and elf_getSymbolAt use the index once it exists.
+ *
+ * @param elfFile Pointer to a valid ELF structure
+ *
+ * \return 0 on success, otherwise < 0
+ */
+int elf_buildIndex(elf_t *elfFile);
+
+/**
+ * Release the index built by elf_buildIndex.
+ *
+ * @param elfFile Pointer to a valid ELF structure
+ */
+void elf_freeIndex(elf_t *elfFile);
+
 #ifdef __cplusplus
 }
 #endif
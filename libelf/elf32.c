@@ -62,3 +62,49 @@ int elf32_checkSectionTable(const elf_t *elf)
 
     return 0;
 }
+
+/* Utility functions */
+int elf32_getMemoryBounds(const elf_t *elf, elf_addr_type_t addr_type, uintptr_t *min, uintptr_t *max)
+{
+    const Elf32_Phdr *phdr = elf32_getProgramHeaderTable(elf);
+    size_t num = elf32_getNumProgramHeaders(elf);
+    uintptr_t mem_min = UINTPTR_MAX;
+    uintptr_t mem_max = 0;
+
+    for (size_t i = 0; i < num; i++) {
+        if (phdr[i].p_memsz == 0) {
+            continue;
+        }
+
+        uintptr_t sect_min = (addr_type == PHYSICAL) ? phdr[i].p_paddr : phdr[i].p_vaddr;
+        uintptr_t sect_max = sect_min + phdr[i].p_memsz;
+
+        if (sect_max > mem_max) {
+            mem_max = sect_max;
+        }
+        if (sect_min < mem_min) {
+            mem_min = sect_min;
+        }
+    }
+    *min = mem_min;
+    *max = mem_max;
+
+    return 1;
+}
+
+int elf32_loadFile(const elf_t *elf, elf_addr_type_t addr_type)
+{
+    const Elf32_Phdr *phdr = elf32_getProgramHeaderTable(elf);
+    size_t num = elf32_getNumProgramHeaders(elf);
+
+    for (size_t i = 0; i < num; i++) {
+        /* Load that section */
+        uintptr_t dest = (addr_type == PHYSICAL) ? phdr[i].p_paddr : phdr[i].p_vaddr;
+        size_t len = phdr[i].p_filesz;
+        const void *src = elf->elfFile + phdr[i].p_offset;
+        memcpy((void *) dest, src, len);
+        memset((void *)(dest + len), 0, phdr[i].p_memsz - len);
+    }
+
+    return 1;
+}
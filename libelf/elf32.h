@@ -20,6 +20,10 @@ int elf32_checkProgramHeaderTable(const elf_t *elf);
 
 int elf32_checkSectionTable(const elf_t *elf);
 
+int elf32_getMemoryBounds(const elf_t *elf, elf_addr_type_t addr_type, uintptr_t *min, uintptr_t *max);
+
+int elf32_loadFile(const elf_t *elf, elf_addr_type_t addr_type);
+
 static inline bool elf_isElf32(const elf_t *elf)
 {
     return elf->elfClass == ELFCLASS32;
@@ -154,6 +158,43 @@ static inline size_t elf32_getProgramHeaderAlign(const elf_t *file, size_t ph)
     return elf32_getProgramHeaderTable(file)[ph].p_align;
 }
 
+
+/* Symbol table functions */
+static inline const Elf32_Sym *elf32_getSymbol(const elf_t *elf, size_t s, size_t i)
+{
+    return (const Elf32_Sym *)(elf->elfFile + elf32_getSectionOffset(elf, s)) + i;
+}
+
+static inline size_t elf32_getNumSymbols(const elf_t *elf, size_t s)
+{
+    return elf32_getSectionSize(elf, s) / sizeof(Elf32_Sym);
+}
+
+static inline size_t elf32_getSymbolNameOffset(const elf_t *elf, size_t s, size_t i)
+{
+    return elf32_getSymbol(elf, s, i)->st_name;
+}
+
+static inline uintptr_t elf32_getSymbolValue(const elf_t *elf, size_t s, size_t i)
+{
+    return elf32_getSymbol(elf, s, i)->st_value;
+}
+
+static inline size_t elf32_getSymbolSize(const elf_t *elf, size_t s, size_t i)
+{
+    return elf32_getSymbol(elf, s, i)->st_size;
+}
+
+static inline unsigned char elf32_getSymbolInfo(const elf_t *elf, size_t s, size_t i)
+{
+    return elf32_getSymbol(elf, s, i)->st_info;
+}
+
+static inline size_t elf32_getSymbolSectionIndex(const elf_t *elf, size_t s, size_t i)
+{
+    return elf32_getSymbol(elf, s, i)->st_shndx;
+}
+
 #ifdef __cplusplus
 }
 #endif
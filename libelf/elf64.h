@@ -20,6 +20,10 @@ int elf64_checkProgramHeaderTable(const elf_t *elf);
 
 int elf64_checkSectionTable(const elf_t *elf);
 
+int elf64_getMemoryBounds(const elf_t *elf, elf_addr_type_t addr_type, uintptr_t *min, uintptr_t *max);
+
+int elf64_loadFile(const elf_t *elf, elf_addr_type_t addr_type);
+
 static inline bool elf_isElf64(const elf_t *elf)
 {
     return elf->elfClass == ELFCLASS64;
@@ -154,6 +158,43 @@ static inline size_t elf64_getProgramHeaderAlign(const elf_t *file, size_t ph)
     return elf64_getProgramHeaderTable(file)[ph].p_align;
 }
 
+
+/* Symbol table functions */
+static inline const Elf64_Sym *elf64_getSymbol(const elf_t *elf, size_t s, size_t i)
+{
+    return (const Elf64_Sym *)(elf->elfFile + elf64_getSectionOffset(elf, s)) + i;
+}
+
+static inline size_t elf64_getNumSymbols(const elf_t *elf, size_t s)
+{
+    return elf64_getSectionSize(elf, s) / sizeof(Elf64_Sym);
+}
+
+static inline size_t elf64_getSymbolNameOffset(const elf_t *elf, size_t s, size_t i)
+{
+    return elf64_getSymbol(elf, s, i)->st_name;
+}
+
+static inline uintptr_t elf64_getSymbolValue(const elf_t *elf, size_t s, size_t i)
+{
+    return elf64_getSymbol(elf, s, i)->st_value;
+}
+
+static inline size_t elf64_getSymbolSize(const elf_t *elf, size_t s, size_t i)
+{
+    return elf64_getSymbol(elf, s, i)->st_size;
+}
+
+static inline unsigned char elf64_getSymbolInfo(const elf_t *elf, size_t s, size_t i)
+{
+    return elf64_getSymbol(elf, s, i)->st_info;
+}
+
+static inline size_t elf64_getSymbolSectionIndex(const elf_t *elf, size_t s, size_t i)
+{
+    return elf64_getSymbol(elf, s, i)->st_shndx;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 1999-2004 University of New South Wales
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include "elf.h"
+
+#ifdef __cplusplus
+
+/*
+ * Class-specialized view of a validated ELF file.
+ *
+ * The C accessors branch on elfClass for every field they read. A view is
+ * bound to one class when it is constructed, so iterating program headers
+ * and sections is plain pointer arithmetic over typed arrays which
+ * the compiler inlines completely. elf_visit() resolves the class once and
+ * hands the matching view to a generic callable.
+ */
+template <class T>
+struct elf_range {
+    const T *first;
+    const T *last;
+
+    const T *begin() const
+    {
+        return first;
+    }
+    const T *end() const
+    {
+        return last;
+    }
+    size_t size() const
+    {
+        return last - first;
+    }
+    const T &operator[](size_t i) const
+    {
+        return first[i];
+    }
+};
+
+template <class Ehdr, class Phdr, class Shdr, class Sym>
+struct elf_view {
+    typedef Ehdr ehdr_t;
+    typedef Phdr phdr_t;
+    typedef Shdr shdr_t;
+    typedef Sym sym_t;
+
+    const char *file;
+    size_t size;
+
+    elf_view(const elf_t *elf) : file((const char *) elf->elfFile), size(elf->elfSize) {}
+
+    /* ELF header functions */
+    const Ehdr &header() const
+    {
+        return *(const Ehdr *) file;
+    }
+
+    elf_range<Phdr> programHeaders() const
+    {
+        const Phdr *first = (const Phdr *)(file + header().e_phoff);
+        return elf_range<Phdr> { first, first + header().e_phnum };
+    }
+
+    elf_range<Shdr> sections() const
+    {
+        const Shdr *first = (const Shdr *)(file + header().e_shoff);
+        return elf_range<Shdr> { first, first + header().e_shnum };
+    }
+
+    /* Section header functions */
+    const char *contents(const Shdr &section) const
+    {
+        size_t end = section.sh_offset + section.sh_size;
+        if (section.sh_size == 0 || end > size || end < section.sh_offset) {
+            return NULL;
+        }
+        return file + section.sh_offset;
+    }
+};
+
+typedef elf_view<Elf32_Ehdr, Elf32_Phdr, Elf32_Shdr, Elf32_Sym> elf32_view;
+typedef elf_view<Elf64_Ehdr, Elf64_Phdr, Elf64_Shdr, Elf64_Sym> elf64_view;
+
+/*
+ * Call function with the view matching the class of a validated ELF file.
+ * Both instantiations must return the same type.
+ */
+template <class F>
+auto elf_visit(const elf_t *elf, F &&function) -> decltype(function(elf64_view(elf)))
+{
+    if (elf->elfClass == ELFCLASS32) {
+        return function(elf32_view(elf));
+    } else {
+        return function(elf64_view(elf));
+    }
+}
+
+#endif
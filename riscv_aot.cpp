@@ -0,0 +1,156 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <dlfcn.h>
+#include "libelf/elf_view.h"
+#include "riscv_aot.h"
+#include "riscv_cpu.h"
+
+//------------------------------------------------------------------------------
+riscv_aot::riscv_aot()
+{
+    bias = 0;
+    translated = 0;
+    interpreted = 0;
+    error = nullptr;
+
+    handle = nullptr;
+    image = 0;
+    buckets = nullptr;
+    mask = 0;
+}
+//------------------------------------------------------------------------------
+riscv_aot::~riscv_aot()
+{
+    close();
+}
+//------------------------------------------------------------------------------
+bool riscv_aot::open(const char* path, const elf_t* elf, uintptr_t bias)
+{
+    close();
+
+    handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (handle == nullptr)
+    {
+        error = "shared object cannot be opened";
+        return false;
+    }
+
+    const uint32_t* version = (uint32_t*)dlsym(handle, "riscv_aot_version");
+    const uint64_t* hash = (uint64_t*)dlsym(handle, "riscv_aot_hash");
+    const entry_t* table = (entry_t*)dlsym(handle, "riscv_aot_table");
+    const size_t* count = (size_t*)dlsym(handle, "riscv_aot_count");
+    if (version == nullptr || hash == nullptr || table == nullptr || count == nullptr)
+    {
+        close();
+        error = "not a translated image";
+        return false;
+    }
+    if (*version != VERSION || *hash != riscv_aot::hash(elf))
+    {
+        close();
+        error = "translated for another image or version";
+        return false;
+    }
+
+    size_t size = 16;
+    while (size < *count * 2)
+        size *= 2;
+    buckets = new entry_t[size]();
+    mask = size - 1;
+    for (size_t i = 0; i < *count; ++i)
+    {
+        size_t j = (table[i].pc >> 1) & mask;
+        while (buckets[j].function)
+            j = (j + 1) & mask;
+        buckets[j] = table[i];
+    }
+
+    // Loaded size of the shared object, which holds the translated blocks
+#if defined(__linux__)
+    Dl_info info;
+    if (*count && dladdr((void*)table[0].function, &info) && info.dli_fbase)
+    {
+        const Elf64_Ehdr* ehdr = (Elf64_Ehdr*)info.dli_fbase;
+        const Elf64_Phdr* phdr = (Elf64_Phdr*)((char*)ehdr + ehdr->e_phoff);
+        for (size_t i = 0; i < ehdr->e_phnum; ++i)
+        {
+            if (phdr[i].p_type == PT_LOAD)
+                image += phdr[i].p_memsz;
+        }
+    }
+#endif
+
+    this->bias = bias;
+    error = nullptr;
+    return true;
+}
+//------------------------------------------------------------------------------
+void riscv_aot::close()
+{
+    delete[] buckets;
+    buckets = nullptr;
+    mask = 0;
+    if (handle)
+        dlclose(handle);
+    handle = nullptr;
+    image = 0;
+}
+//------------------------------------------------------------------------------
+size_t riscv_aot::footprint() const
+{
+    return sizeof(riscv_aot) + image + (buckets ? (mask + 1) * sizeof(entry_t) : 0);
+}
+//------------------------------------------------------------------------------
+bool riscv_aot::run(riscv_cpu& cpu)
+{
+    bool success = true;
+    cpu.fclearexcept();
+    while (cpu.pc >= cpu.begin && cpu.pc < cpu.end)
+    {
+        block* function = lookup(cpu.pc);
+        if (function)
+        {
+            function(cpu, bias);
+            translated++;
+            continue;
+        }
+        if (cpu.issue() == false)
+        {
+            success = false;
+            break;
+        }
+        interpreted++;
+    }
+    cpu.ftestexcept();
+    cpu.fsetround(0b000);
+    return success;
+}
+//------------------------------------------------------------------------------
+uint64_t riscv_aot::hash(const elf_t* elf)
+{
+    // FNV-1a over the address and bytes of every executable segment
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void* data, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+            hash = (hash ^ ((uint8_t*)data)[i]) * 1099511628211ull;
+    };
+    elf_visit(elf, [&mix](const auto& view)
+    {
+        for (const auto& phdr : view.programHeaders())
+        {
+            if (phdr.p_type != PT_LOAD || (phdr.p_flags & PF_X) == 0)
+                continue;
+            uint64_t vaddr = phdr.p_vaddr;
+            mix(&vaddr, sizeof(vaddr));
+            mix(view.file + phdr.p_offset, phdr.p_filesz);
+        }
+    });
+    return hash;
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,76 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "libelf/elf.h"
+
+struct riscv_cpu;
+
+//------------------------------------------------------------------------------
+// Ahead-of-time translated code
+//------------------------------------------------------------------------------
+// tools/riscv_aot.cpp turns the executable segments of an ELF into C++, one
+// function per basic block, which is compiled into a shared object:
+//   riscv_aot_version  VERSION of the generator
+//   riscv_aot_hash     hash() of the ELF it was generated from
+//   riscv_aot_table    block link address and function, riscv_aot_count rows
+// open() refuses a shared object generated for another image or version.
+// run() enters a block whenever pc is the start of one and lets riscv_cpu
+// issue everything else. Blocks do not call instrumentation plugins.
+//------------------------------------------------------------------------------
+struct riscv_aot
+{
+    enum { VERSION = 1 };
+
+    typedef void block(riscv_cpu& cpu, uintptr_t bias);
+    struct entry_t
+    {
+        uintptr_t pc;
+        block* function;
+    };
+
+    riscv_aot();
+    ~riscv_aot();
+
+    bool open(const char* path, const elf_t* elf, uintptr_t bias = 0);
+    void close();
+    block* lookup(uintptr_t pc) const;
+    bool run(riscv_cpu& cpu);
+    size_t footprint() const;
+
+    static uint64_t hash(const elf_t* elf);
+
+public:
+    uintptr_t bias;
+    size_t translated;
+    size_t interpreted;
+    const char* error;
+
+protected:
+    void* handle;
+    size_t image;
+    entry_t* buckets;
+    size_t mask;
+};
+//------------------------------------------------------------------------------
+inline riscv_aot::block* riscv_aot::lookup(uintptr_t pc) const
+{
+    if (buckets == nullptr)
+        return nullptr;
+    pc -= bias;
+    for (size_t i = (pc >> 1) & mask;; i = (i + 1) & mask)
+    {
+        if (buckets[i].function == nullptr)
+            return nullptr;
+        if (buckets[i].pc == pc)
+            return buckets[i].function;
+    }
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,439 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <stdlib.h>
+#include <string.h>
+#include "riscv_branch.h"
+
+//------------------------------------------------------------------------------
+static bool update(uint8_t& counter, bool taken)
+{
+    bool prediction = counter >= 2;
+    if (taken && counter < 3)
+        counter++;
+    if (!taken && counter > 0)
+        counter--;
+    return prediction == taken;
+}
+//------------------------------------------------------------------------------
+riscv_branch::riscv_branch() : riscv_plugin(BLOCK), statistics(1024)
+{
+    predictorCount = 0;
+}
+//------------------------------------------------------------------------------
+riscv_branch::~riscv_branch()
+{
+    for (size_t i = 0; i < predictorCount; ++i)
+    {
+        delete predictors[i];
+    }
+}
+//------------------------------------------------------------------------------
+void riscv_branch::reset()
+{
+    statistics.reset();
+}
+//------------------------------------------------------------------------------
+void riscv_branch::add(predictor* predictor)
+{
+    if (predictorCount >= MAX_PREDICTOR)
+    {
+        delete predictor;
+        return;
+    }
+    predictors[predictorCount++] = predictor;
+}
+//------------------------------------------------------------------------------
+void riscv_branch::record(const event& event)
+{
+    statistic& statistic = statistics.find(event.pc);
+    statistic.type = event.type;
+    if (event.taken)
+        statistic.taken++;
+    else
+        statistic.notTaken++;
+
+    for (size_t i = 0; i < predictorCount; ++i)
+    {
+        switch (predictors[i]->predict(event))
+        {
+        case 0:
+            statistic.mispredicted[i]++;
+            break;
+        case 1:
+            statistic.predicted[i]++;
+            break;
+        }
+    }
+}
+//------------------------------------------------------------------------------
+size_t riscv_branch::footprint() const
+{
+    size_t size = sizeof(riscv_branch) + statistics.footprint();
+    for (size_t i = 0; i < predictorCount; ++i)
+    {
+        size += predictors[i]->footprint();
+    }
+    return size;
+}
+//------------------------------------------------------------------------------
+static const char* const kindName[] = { "branch", "jump", "call", "return", "indirect" };
+//------------------------------------------------------------------------------
+static uint64_t mispredictions(const riscv_branch::statistic& statistic)
+{
+    uint64_t count = 0;
+    for (int i = 0; i < riscv_branch::MAX_PREDICTOR; ++i)
+    {
+        count += statistic.mispredicted[i];
+    }
+    return count;
+}
+//------------------------------------------------------------------------------
+static int compare(const void* a, const void* b)
+{
+    const riscv_branch::statistic& left = ((riscv_profile<riscv_branch::statistic>::row*)a)->statistic;
+    const riscv_branch::statistic& right = ((riscv_profile<riscv_branch::statistic>::row*)b)->statistic;
+    uint64_t leftCount = mispredictions(left);
+    uint64_t rightCount = mispredictions(right);
+    if (leftCount == rightCount)
+    {
+        leftCount = left.taken + left.notTaken;
+        rightCount = right.taken + right.notTaken;
+    }
+    return (leftCount < rightCount) - (leftCount > rightCount);
+}
+//------------------------------------------------------------------------------
+riscv_branch::statistic& riscv_branch::statistic::operator += (const statistic& other)
+{
+    taken += other.taken;
+    notTaken += other.notTaken;
+    for (int i = 0; i < MAX_PREDICTOR; ++i)
+    {
+        predicted[i] += other.predicted[i];
+        mispredicted[i] += other.mispredicted[i];
+    }
+    return *this;
+}
+//------------------------------------------------------------------------------
+static void print(FILE* file, const char* name, const char* kind, const riscv_branch::statistic& statistic, size_t count)
+{
+    fprintf(file, "%-32s %-8s %12llu %12llu", name, kind,
+            (unsigned long long)statistic.taken,
+            (unsigned long long)statistic.notTaken);
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint64_t total = statistic.predicted[i] + statistic.mispredicted[i];
+        if (total)
+            fprintf(file, " %15.2f%%", 100.0 * statistic.predicted[i] / total);
+        else
+            fprintf(file, " %16s", "-");
+    }
+    fprintf(file, "\n");
+}
+//------------------------------------------------------------------------------
+void riscv_branch::report(FILE* file, symbol* symbol, void* context, size_t top) const
+{
+    typedef riscv_profile<statistic>::row row;
+    size_t count = 0;
+    row* pcs = statistics.pcs(symbol, context, count);
+    statistic total = statistic();
+    for (size_t i = 0; i < count; ++i)
+    {
+        total += pcs[i].statistic;
+    }
+    size_t functionCount = 0;
+    row* functions = statistics.functions(symbol, context, functionCount);
+
+    fprintf(file, "%-32s %-8s %12s %12s", "", "", "taken", "not taken");
+    for (size_t i = 0; i < predictorCount; ++i)
+    {
+        fprintf(file, " %16s", predictors[i]->name());
+    }
+    fprintf(file, "\n");
+    print(file, "total", "", total, predictorCount);
+
+    if (functionCount)
+        fprintf(file, "\n");
+    qsort(functions, functionCount, sizeof(row), compare);
+    for (size_t i = 0; i < functionCount && i < top; ++i)
+    {
+        print(file, functions[i].name, "", functions[i].statistic, predictorCount);
+    }
+
+    fprintf(file, "\n");
+    qsort(pcs, count, sizeof(row), compare);
+    for (size_t i = 0; i < count && i < top; ++i)
+    {
+        print(file, pcs[i].name, kindName[pcs[i].statistic.type], pcs[i].statistic, predictorCount);
+    }
+
+    delete[] functions;
+    delete[] pcs;
+}
+//------------------------------------------------------------------------------
+// Bimodal
+//------------------------------------------------------------------------------
+riscv_branch::bimodal::bimodal(unsigned int bits)
+{
+    mask = (uintptr_t(1) << bits) - 1;
+    counters = new uint8_t[mask + 1];
+    memset(counters, 1, mask + 1);
+    snprintf(label, sizeof(label), "bimodal-%u", bits);
+}
+//------------------------------------------------------------------------------
+riscv_branch::bimodal::~bimodal()
+{
+    delete[] counters;
+}
+//------------------------------------------------------------------------------
+const char* riscv_branch::bimodal::name() const
+{
+    return label;
+}
+//------------------------------------------------------------------------------
+size_t riscv_branch::bimodal::footprint() const
+{
+    return sizeof(bimodal) + mask + 1;
+}
+//------------------------------------------------------------------------------
+int riscv_branch::bimodal::predict(const event& event)
+{
+    if (event.type != CONDITIONAL)
+        return -1;
+    return update(counters[(event.pc >> 1) & mask], event.taken);
+}
+//------------------------------------------------------------------------------
+// Gshare
+//------------------------------------------------------------------------------
+riscv_branch::gshare::gshare(unsigned int bits, unsigned int history)
+{
+    mask = (uintptr_t(1) << bits) - 1;
+    counters = new uint8_t[mask + 1];
+    memset(counters, 1, mask + 1);
+    gshare::history = 0;
+    historyMask = (history < 64) ? (uint64_t(1) << history) - 1 : UINT64_MAX;
+    snprintf(label, sizeof(label), "gshare-%u-%u", bits, history);
+}
+//------------------------------------------------------------------------------
+riscv_branch::gshare::~gshare()
+{
+    delete[] counters;
+}
+//------------------------------------------------------------------------------
+const char* riscv_branch::gshare::name() const
+{
+    return label;
+}
+//------------------------------------------------------------------------------
+size_t riscv_branch::gshare::footprint() const
+{
+    return sizeof(gshare) + mask + 1;
+}
+//------------------------------------------------------------------------------
+int riscv_branch::gshare::predict(const event& event)
+{
+    if (event.type != CONDITIONAL)
+        return -1;
+    bool correct = update(counters[((event.pc >> 1) ^ history) & mask], event.taken);
+    history = ((history << 1) | event.taken) & historyMask;
+    return correct;
+}
+//------------------------------------------------------------------------------
+// TAGE-lite
+//------------------------------------------------------------------------------
+static const unsigned int tageHistory[riscv_branch::tage::TABLES] = { 8, 16, 32, 64 };
+//------------------------------------------------------------------------------
+riscv_branch::tage::tage(unsigned int bits)
+{
+    tage::bits = bits;
+    base = new uint8_t[size_t(1) << (bits + 2)];
+    memset(base, 1, size_t(1) << (bits + 2));
+    // Tags are 8 bits wide, so an entry which was never allocated cannot hit
+    for (int i = 0; i < TABLES; ++i)
+    {
+        tables[i] = new entry[size_t(1) << bits];
+        for (size_t j = 0; j < (size_t(1) << bits); ++j)
+        {
+            tables[i][j].tag = UINT16_MAX;
+            tables[i][j].counter = 0;
+            tables[i][j].useful = 0;
+        }
+    }
+    history = 0;
+    tick = 0;
+    snprintf(label, sizeof(label), "tage-%u", bits);
+}
+//------------------------------------------------------------------------------
+riscv_branch::tage::~tage()
+{
+    for (int i = 0; i < TABLES; ++i)
+    {
+        delete[] tables[i];
+    }
+    delete[] base;
+}
+//------------------------------------------------------------------------------
+const char* riscv_branch::tage::name() const
+{
+    return label;
+}
+//------------------------------------------------------------------------------
+uint32_t riscv_branch::tage::fold(unsigned int length, unsigned int bits) const
+{
+    uint64_t value = (length < 64) ? history & ((uint64_t(1) << length) - 1) : history;
+    uint32_t folded = 0;
+    for (unsigned int i = 0; i < length; i += bits)
+    {
+        folded ^= uint32_t(value >> i);
+    }
+    return folded & ((uint32_t(1) << bits) - 1);
+}
+//------------------------------------------------------------------------------
+uint32_t riscv_branch::tage::index(int table, uintptr_t pc) const
+{
+    uint32_t mask = (uint32_t(1) << bits) - 1;
+    return (uint32_t(pc >> 1) ^ uint32_t(pc >> (bits + 1)) ^ fold(tageHistory[table], bits)) & mask;
+}
+//------------------------------------------------------------------------------
+uint16_t riscv_branch::tage::tag(int table, uintptr_t pc) const
+{
+    return uint16_t((uint32_t(pc >> 1) ^ fold(tageHistory[table], 8) ^ (fold(tageHistory[table], 7) << 1)) & 0xFF);
+}
+//------------------------------------------------------------------------------
+size_t riscv_branch::tage::footprint() const
+{
+    return sizeof(tage) + (size_t(1) << (bits + 2)) + (sizeof(entry) << bits) * TABLES;
+}
+//------------------------------------------------------------------------------
+int riscv_branch::tage::predict(const event& event)
+{
+    if (event.type != CONDITIONAL)
+        return -1;
+
+    uint32_t indices[TABLES];
+    uint16_t tags[TABLES];
+    int provider = -1;
+    int alternate = -1;
+    for (int i = TABLES - 1; i >= 0; --i)
+    {
+        indices[i] = index(i, event.pc);
+        tags[i] = tag(i, event.pc);
+        if (tables[i][indices[i]].tag != tags[i])
+            continue;
+        if (provider < 0)
+            provider = i;
+        else if (alternate < 0)
+            alternate = i;
+    }
+
+    uint8_t& counter = base[(event.pc >> 1) & ((size_t(1) << (bits + 2)) - 1)];
+    bool basePrediction = counter >= 2;
+    bool alternatePrediction = alternate >= 0 ? tables[alternate][indices[alternate]].counter >= 0 : basePrediction;
+    bool prediction = provider >= 0 ? tables[provider][indices[provider]].counter >= 0 : basePrediction;
+    bool taken = event.taken;
+
+    if (provider >= 0)
+    {
+        entry& entry = tables[provider][indices[provider]];
+        if (prediction != alternatePrediction)
+        {
+            if (prediction == taken && entry.useful < 3)
+                entry.useful++;
+            if (prediction != taken && entry.useful > 0)
+                entry.useful--;
+        }
+        if (taken && entry.counter < 3)
+            entry.counter++;
+        if (!taken && entry.counter > -4)
+            entry.counter--;
+    }
+    else
+    {
+        update(counter, taken);
+    }
+
+    // Allocate a longer history entry on misprediction
+    if (prediction != taken && provider < TABLES - 1)
+    {
+        bool allocated = false;
+        for (int i = provider + 1; i < TABLES; ++i)
+        {
+            entry& entry = tables[i][indices[i]];
+            if (entry.useful == 0)
+            {
+                entry.tag = tags[i];
+                entry.counter = taken ? 0 : -1;
+                allocated = true;
+                break;
+            }
+        }
+        if (allocated == false)
+        {
+            for (int i = provider + 1; i < TABLES; ++i)
+            {
+                tables[i][indices[i]].useful--;
+            }
+        }
+    }
+
+    // Graceful aging of the useful bits
+    if (++tick % (256 * 1024) == 0)
+    {
+        for (int i = 0; i < TABLES; ++i)
+        {
+            for (size_t j = 0; j < (size_t(1) << bits); ++j)
+            {
+                tables[i][j].useful >>= 1;
+            }
+        }
+    }
+
+    history = (history << 1) | taken;
+    return prediction == taken;
+}
+//------------------------------------------------------------------------------
+// Return address stack
+//------------------------------------------------------------------------------
+riscv_branch::ras::ras(unsigned int depth)
+{
+    ras::depth = depth ? depth : 1;
+    stack = new uintptr_t[ras::depth];
+    top = 0;
+    snprintf(label, sizeof(label), "ras-%u", ras::depth);
+}
+//------------------------------------------------------------------------------
+riscv_branch::ras::~ras()
+{
+    delete[] stack;
+}
+//------------------------------------------------------------------------------
+const char* riscv_branch::ras::name() const
+{
+    return label;
+}
+//------------------------------------------------------------------------------
+size_t riscv_branch::ras::footprint() const
+{
+    return sizeof(ras) + sizeof(uintptr_t) * depth;
+}
+//------------------------------------------------------------------------------
+int riscv_branch::ras::predict(const event& event)
+{
+    switch (event.type)
+    {
+    case CALL:
+        stack[top++ % depth] = event.next;
+        return -1;
+    case RETURN:
+        if (top == 0)
+            return 0;
+        return stack[--top % depth] == event.target;
+    default:
+        return -1;
+    }
+}
+//------------------------------------------------------------------------------
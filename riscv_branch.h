@@ -0,0 +1,199 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdio.h>
+#include "riscv_cpu.h"
+#include "riscv_plugin.h"
+#include "riscv_profile.h"
+
+//------------------------------------------------------------------------------
+// Branch statistics and predictor models
+//------------------------------------------------------------------------------
+struct riscv_branch : public riscv_plugin
+{
+    enum kind
+    {
+        CONDITIONAL,
+        JUMP,
+        CALL,
+        RETURN,
+        INDIRECT,
+    };
+
+    struct event
+    {
+        uintptr_t pc;
+        uintptr_t target;
+        uintptr_t next;
+        kind type;
+        bool taken;
+    };
+
+    struct predictor
+    {
+        virtual ~predictor() {}
+        virtual const char* name() const = 0;
+        // 1 = correct, 0 = mispredicted, -1 = not predicted by this model
+        virtual int predict(const event& event) = 0;
+        virtual size_t footprint() const = 0;
+    };
+
+    struct bimodal;
+    struct gshare;
+    struct tage;
+    struct ras;
+
+    riscv_branch();
+    ~riscv_branch();
+
+    void reset();
+    void add(predictor* predictor);
+    void block(const riscv_cpu& cpu, uintptr_t address);
+    void record(const event& event);
+    size_t footprint() const;
+
+    typedef const char* symbol(void* context, uintptr_t pc, uintptr_t* base);
+    void report(FILE* file, symbol* symbol, void* context, size_t top = 20) const;
+
+public:
+    enum { MAX_PREDICTOR = 8 };
+
+    struct statistic
+    {
+        kind type;
+        uint64_t taken;
+        uint64_t notTaken;
+        uint64_t predicted[MAX_PREDICTOR];
+        uint64_t mispredicted[MAX_PREDICTOR];
+
+        statistic& operator += (const statistic& other);
+    };
+
+protected:
+    predictor* predictors[MAX_PREDICTOR];
+    size_t predictorCount;
+
+    riscv_profile<statistic> statistics;
+};
+//------------------------------------------------------------------------------
+// 2-bit saturating counters indexed by pc
+//------------------------------------------------------------------------------
+struct riscv_branch::bimodal : public riscv_branch::predictor
+{
+    bimodal(unsigned int bits = 12);
+    ~bimodal();
+    const char* name() const;
+    int predict(const event& event);
+    size_t footprint() const;
+
+protected:
+    uint8_t* counters;
+    uintptr_t mask;
+    char label[32];
+};
+//------------------------------------------------------------------------------
+// 2-bit saturating counters indexed by pc xor global history
+//------------------------------------------------------------------------------
+struct riscv_branch::gshare : public riscv_branch::predictor
+{
+    gshare(unsigned int bits = 12, unsigned int history = 12);
+    ~gshare();
+    const char* name() const;
+    int predict(const event& event);
+    size_t footprint() const;
+
+protected:
+    uint8_t* counters;
+    uintptr_t mask;
+    uint64_t history;
+    uint64_t historyMask;
+    char label[32];
+};
+//------------------------------------------------------------------------------
+// Bimodal base predictor with tagged tables of geometric history lengths
+//------------------------------------------------------------------------------
+struct riscv_branch::tage : public riscv_branch::predictor
+{
+    enum { TABLES = 4 };
+
+    tage(unsigned int bits = 10);
+    ~tage();
+    const char* name() const;
+    int predict(const event& event);
+    size_t footprint() const;
+
+protected:
+    struct entry
+    {
+        uint16_t tag;
+        int8_t counter;
+        uint8_t useful;
+    };
+
+    uint32_t fold(unsigned int length, unsigned int bits) const;
+    uint32_t index(int table, uintptr_t pc) const;
+    uint16_t tag(int table, uintptr_t pc) const;
+
+    uint8_t* base;
+    entry* tables[TABLES];
+    unsigned int bits;
+    uint64_t history;
+    uint32_t tick;
+    char label[32];
+};
+//------------------------------------------------------------------------------
+// Return address stack for JALR returns
+//------------------------------------------------------------------------------
+struct riscv_branch::ras : public riscv_branch::predictor
+{
+    ras(unsigned int depth = 16);
+    ~ras();
+    const char* name() const;
+    int predict(const event& event);
+    size_t footprint() const;
+
+protected:
+    uintptr_t* stack;
+    unsigned int depth;
+    unsigned int top;
+    char label[32];
+};
+//------------------------------------------------------------------------------
+inline void riscv_branch::block(const riscv_cpu& cpu, uintptr_t address)
+{
+    event event;
+    event.pc = address;
+    event.target = cpu.pc;
+    event.next = address + cpu.length;
+    event.taken = true;
+    switch (cpu.opcode)
+    {
+    case 0b1100011:
+        event.type = CONDITIONAL;
+        event.target = address + cpu.simmB();
+        event.taken = (cpu.pc != event.next);
+        break;
+    case 0b1101111:
+        event.type = (cpu.rd == 1 || cpu.rd == 5) ? CALL : JUMP;
+        break;
+    case 0b1100111:
+        if (cpu.rd == 1 || cpu.rd == 5)
+            event.type = CALL;
+        else if (cpu.rs1 == 1 || cpu.rs1 == 5)
+            event.type = RETURN;
+        else
+            event.type = INDIRECT;
+        break;
+    default:
+        return;
+    }
+    record(event);
+}
+//------------------------------------------------------------------------------
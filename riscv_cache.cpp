@@ -0,0 +1,234 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <stdlib.h>
+#include <string.h>
+#include "riscv_cache.h"
+
+//------------------------------------------------------------------------------
+riscv_cache::riscv_cache(const config& l1i, const config& l1d, const config& l2) : riscv_plugin(FETCH | MEMORY), statistics(4096)
+{
+    setup(riscv_cache::l1i, l1i);
+    setup(riscv_cache::l1d, l1d);
+    setup(riscv_cache::l2, l2);
+
+    reset();
+}
+//------------------------------------------------------------------------------
+riscv_cache::~riscv_cache()
+{
+    level* levels[] = { &l1i, &l1d, &l2 };
+    for (level* current : levels)
+    {
+        delete[] current->tags;
+        delete[] current->stamps;
+    }
+}
+//------------------------------------------------------------------------------
+void riscv_cache::setup(level& level, const config& config)
+{
+    size_t line = config.line < sizeof(uintptr_t) ? sizeof(uintptr_t) : config.line;
+    size_t ways = config.ways ? config.ways : 1;
+
+    level.lineShift = 0;
+    while ((size_t(2) << level.lineShift) <= line)
+        level.lineShift++;
+
+    size_t sets = config.size >> level.lineShift;
+    sets = sets / ways;
+    size_t power = 1;
+    while (power * 2 <= sets)
+        power *= 2;
+
+    level.ways = ways;
+    level.setMask = power - 1;
+    level.replacement = config.replacement;
+    level.tags = new uintptr_t[power * ways];
+    level.stamps = new uint64_t[power * ways];
+}
+//------------------------------------------------------------------------------
+void riscv_cache::reset()
+{
+    level* levels[] = { &l1i, &l1d, &l2 };
+    for (level* current : levels)
+    {
+        size_t count = (current->setMask + 1) * current->ways;
+        for (size_t i = 0; i < count; ++i)
+        {
+            current->tags[i] = UINTPTR_MAX;
+            current->stamps[i] = 0;
+        }
+        current->clock = 0;
+        current->total = counter();
+    }
+
+    statistics.reset();
+
+    random = 0x12345678;
+}
+//------------------------------------------------------------------------------
+riscv_cache::statistic& riscv_cache::statistic::operator += (const statistic& other)
+{
+    l1i.hit += other.l1i.hit;
+    l1i.miss += other.l1i.miss;
+    l1d.hit += other.l1d.hit;
+    l1d.miss += other.l1d.miss;
+    l2.hit += other.l2.hit;
+    l2.miss += other.l2.miss;
+    return *this;
+}
+//------------------------------------------------------------------------------
+bool riscv_cache::level::lookup(uintptr_t line, uint32_t& random)
+{
+    uintptr_t* tag = tags + (line & setMask) * ways;
+    uint64_t* stamp = stamps + (line & setMask) * ways;
+
+    clock++;
+    for (size_t i = 0; i < ways; ++i)
+    {
+        if (tag[i] == line)
+        {
+            if (replacement == LRU)
+                stamp[i] = clock;
+            total.hit++;
+            return true;
+        }
+    }
+
+    size_t victim = 0;
+    if (replacement == RANDOM)
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        victim = random % ways;
+    }
+    else
+    {
+        for (size_t i = 1; i < ways; ++i)
+        {
+            if (stamp[i] < stamp[victim])
+                victim = i;
+        }
+    }
+    tag[victim] = line;
+    stamp[victim] = clock;
+    total.miss++;
+    return false;
+}
+//------------------------------------------------------------------------------
+bool riscv_cache::line(level& level, counter statistic::*counter, uintptr_t pc, uintptr_t address)
+{
+    statistic& statistic = statistics.find(pc);
+    if (level.lookup(address >> level.lineShift, random))
+    {
+        (statistic.*counter).hit++;
+        return true;
+    }
+    (statistic.*counter).miss++;
+
+    if (l2.lookup(address >> l2.lineShift, random))
+    {
+        statistic.l2.hit++;
+        return false;
+    }
+    statistic.l2.miss++;
+    return false;
+}
+//------------------------------------------------------------------------------
+void riscv_cache::fetch(uintptr_t pc, size_t size)
+{
+    uintptr_t first = pc >> l1i.lineShift;
+    uintptr_t last = (pc + size - 1) >> l1i.lineShift;
+    line(l1i, &statistic::l1i, pc, pc);
+    if (first != last)
+        line(l1i, &statistic::l1i, pc, last << l1i.lineShift);
+}
+//------------------------------------------------------------------------------
+void riscv_cache::access(uintptr_t pc, uintptr_t address, size_t size, bool store)
+{
+    uintptr_t first = address >> l1d.lineShift;
+    uintptr_t last = (address + size - 1) >> l1d.lineShift;
+    line(l1d, &statistic::l1d, pc, address);
+    if (first != last)
+        line(l1d, &statistic::l1d, pc, last << l1d.lineShift);
+}
+//------------------------------------------------------------------------------
+size_t riscv_cache::footprint() const
+{
+    size_t size = sizeof(riscv_cache) + statistics.footprint();
+    const level* levels[] = { &l1i, &l1d, &l2 };
+    for (const level* current : levels)
+    {
+        size += (current->setMask + 1) * current->ways * (sizeof(uintptr_t) + sizeof(uint64_t));
+    }
+    return size;
+}
+//------------------------------------------------------------------------------
+static uint64_t misses(const riscv_cache::statistic& statistic)
+{
+    return statistic.l1i.miss + statistic.l1d.miss + statistic.l2.miss;
+}
+//------------------------------------------------------------------------------
+static int compare(const void* a, const void* b)
+{
+    uint64_t left = misses(((riscv_profile<riscv_cache::statistic>::row*)a)->statistic);
+    uint64_t right = misses(((riscv_profile<riscv_cache::statistic>::row*)b)->statistic);
+    return (left < right) - (left > right);
+}
+//------------------------------------------------------------------------------
+static double rate(const riscv_cache::counter& counter)
+{
+    uint64_t total = counter.hit + counter.miss;
+    return total ? 100.0 * counter.miss / total : 0.0;
+}
+//------------------------------------------------------------------------------
+static void print(FILE* file, const char* name, const riscv_cache::statistic& statistic)
+{
+    fprintf(file, "%-32s %12llu %6.2f%% %12llu %6.2f%% %12llu %6.2f%%\n", name,
+            (unsigned long long)(statistic.l1i.hit + statistic.l1i.miss), rate(statistic.l1i),
+            (unsigned long long)(statistic.l1d.hit + statistic.l1d.miss), rate(statistic.l1d),
+            (unsigned long long)(statistic.l2.hit + statistic.l2.miss), rate(statistic.l2));
+}
+//------------------------------------------------------------------------------
+void riscv_cache::report(FILE* file, symbol* symbol, void* context, size_t top) const
+{
+    const level* levels[] = { &l1i, &l1d, &l2 };
+    const char* names[] = { "L1I", "L1D", "L2" };
+    fprintf(file, "%-8s %12s %12s %12s %8s\n", "level", "accesses", "hits", "misses", "miss");
+    for (int i = 0; i < 3; ++i)
+    {
+        const counter& total = levels[i]->total;
+        fprintf(file, "%-8s %12llu %12llu %12llu %7.2f%%\n", names[i],
+                (unsigned long long)(total.hit + total.miss),
+                (unsigned long long)total.hit,
+                (unsigned long long)total.miss, rate(total));
+    }
+
+    typedef riscv_profile<statistic>::row row;
+    size_t functionCount = 0;
+    row* functions = statistics.functions(symbol, context, functionCount);
+    fprintf(file, "\n%-32s %12s %7s %12s %7s %12s %7s\n", "function", "L1I", "miss", "L1D", "miss", "L2", "miss");
+    qsort(functions, functionCount, sizeof(row), compare);
+    for (size_t i = 0; i < functionCount && i < top; ++i)
+    {
+        print(file, functions[i].name, functions[i].statistic);
+    }
+
+    size_t count = 0;
+    row* pcs = statistics.pcs(symbol, context, count);
+    fprintf(file, "\n%-32s %12s %7s %12s %7s %12s %7s\n", "pc", "L1I", "miss", "L1D", "miss", "L2", "miss");
+    qsort(pcs, count, sizeof(row), compare);
+    for (size_t i = 0; i < count && i < top; ++i)
+    {
+        print(file, pcs[i].name, pcs[i].statistic);
+    }
+
+    delete[] functions;
+    delete[] pcs;
+}
+//------------------------------------------------------------------------------
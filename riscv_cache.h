@@ -0,0 +1,104 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdio.h>
+#include "riscv_cpu.h"
+#include "riscv_plugin.h"
+#include "riscv_profile.h"
+
+//------------------------------------------------------------------------------
+// Cache hierarchy model
+//------------------------------------------------------------------------------
+// Split L1I / L1D backed by a unified L2. Every level is set-associative with
+// its own size, associativity, line size and replacement policy. Only tags are
+// modelled; stores are write-allocate and count as accesses.
+//------------------------------------------------------------------------------
+struct riscv_cache : public riscv_plugin
+{
+    enum policy
+    {
+        LRU,
+        FIFO,
+        RANDOM,
+    };
+
+    struct config
+    {
+        size_t size;
+        size_t ways;
+        size_t line;
+        policy replacement;
+    };
+
+    riscv_cache(const config& l1i, const config& l1d, const config& l2);
+    ~riscv_cache();
+
+    void reset();
+    void fetch(const riscv_cpu& cpu);
+    void memory(const riscv_cpu& cpu, uintptr_t address, size_t size, bool store);
+    void fetch(uintptr_t pc, size_t size);
+    void access(uintptr_t pc, uintptr_t address, size_t size, bool store);
+    size_t footprint() const;
+
+    typedef const char* symbol(void* context, uintptr_t pc, uintptr_t* base);
+    void report(FILE* file, symbol* symbol, void* context, size_t top = 20) const;
+
+public:
+    struct counter
+    {
+        uint64_t hit;
+        uint64_t miss;
+    };
+
+    struct statistic
+    {
+        counter l1i;
+        counter l1d;
+        counter l2;
+
+        statistic& operator += (const statistic& other);
+    };
+
+    struct level
+    {
+        size_t ways;
+        unsigned int lineShift;
+        uintptr_t setMask;
+        policy replacement;
+        uintptr_t* tags;
+        uint64_t* stamps;
+        uint64_t clock;
+        counter total;
+
+        bool lookup(uintptr_t line, uint32_t& random);
+    };
+
+    level l1i;
+    level l1d;
+    level l2;
+
+protected:
+    void setup(level& level, const config& config);
+    bool line(level& level, counter statistic::*counter, uintptr_t pc, uintptr_t address);
+
+    riscv_profile<statistic> statistics;
+    uint32_t random;
+};
+//------------------------------------------------------------------------------
+inline void riscv_cache::fetch(const riscv_cpu& cpu)
+{
+    fetch(cpu.pc, cpu.length);
+}
+//------------------------------------------------------------------------------
+inline void riscv_cache::memory(const riscv_cpu& cpu, uintptr_t address, size_t size, bool store)
+{
+    access(cpu.pc, address, size, store);
+}
+//------------------------------------------------------------------------------
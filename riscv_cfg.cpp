@@ -0,0 +1,360 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <string.h>
+#include <sys/mman.h>
+#include "libelf/elf_view.h"
+#include "riscv_cfg.h"
+#include "riscv_instruction.h"
+
+enum
+{
+    INSTRUCTION = 1,
+    LEADER = 2,
+    FUNCTION = 4,
+};
+
+//------------------------------------------------------------------------------
+riscv_cfg::riscv_cfg()
+{
+    blocks = nullptr;
+    blockCount = 0;
+    functions = nullptr;
+    functionCount = 0;
+    instructions = 0;
+    error = nullptr;
+    rangeCount = 0;
+}
+//------------------------------------------------------------------------------
+riscv_cfg::~riscv_cfg()
+{
+    clear();
+}
+//------------------------------------------------------------------------------
+void riscv_cfg::clear()
+{
+    delete[] blocks;
+    blocks = nullptr;
+    blockCount = 0;
+    delete[] functions;
+    functions = nullptr;
+    functionCount = 0;
+    instructions = 0;
+    for (size_t i = 0; i < rangeCount; ++i)
+    {
+        delete[] ranges[i].flags;
+    }
+    rangeCount = 0;
+}
+//------------------------------------------------------------------------------
+void riscv_cfg::mark(uintptr_t address, uint8_t flag)
+{
+    for (size_t i = 0; i < rangeCount; ++i)
+    {
+        range_t& range = ranges[i];
+        if (address >= range.vaddr && address < range.vaddr + range.size && (address & 1) == 0)
+            range.flags[(address - range.vaddr) / 2] |= flag;
+    }
+}
+//------------------------------------------------------------------------------
+size_t riscv_cfg::index(uintptr_t address) const
+{
+    // Last block which begins at or before address
+    size_t low = 0;
+    size_t high = blockCount;
+    while (low < high)
+    {
+        size_t middle = (low + high) / 2;
+        if (blocks[middle].begin <= address)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low ? low - 1 : blockCount;
+}
+//------------------------------------------------------------------------------
+bool riscv_cfg::build(const elf_t* elf)
+{
+    clear();
+
+    // Code ranges sorted by address
+    elf_visit(elf, [this](const auto& view)
+    {
+        auto add = [this](uintptr_t vaddr, const char* data, size_t size)
+        {
+            if (data == nullptr || size < 2 || rangeCount >= MAX_RANGE)
+                return;
+            size_t i = rangeCount++;
+            for (; i > 0 && ranges[i - 1].vaddr > vaddr; --i)
+                ranges[i] = ranges[i - 1];
+            ranges[i].vaddr = vaddr;
+            ranges[i].data = (uint8_t*)data;
+            ranges[i].size = size & ~size_t(1);
+            ranges[i].flags = new uint8_t[size / 2]();
+        };
+        for (const auto& shdr : view.sections())
+        {
+            if (shdr.sh_type == SHT_PROGBITS && (shdr.sh_flags & SHF_EXECINSTR))
+                add(shdr.sh_addr, view.contents(shdr), shdr.sh_size);
+        }
+        if (rangeCount)
+            return;
+        for (const auto& phdr : view.programHeaders())
+        {
+            if (phdr.p_type == PT_LOAD && (phdr.p_flags & PF_X) && phdr.p_offset + phdr.p_filesz <= view.size)
+                add(phdr.p_vaddr, view.file + phdr.p_offset, phdr.p_filesz);
+        }
+    });
+    if (rangeCount == 0)
+    {
+        error = "no executable code";
+        return false;
+    }
+
+    // Roots
+    mark(elf_getEntryPoint(elf), LEADER | FUNCTION);
+    size_t symbolTable = elf_getSymbolTableIndex(elf);
+    size_t symbolCount = elf_getNumSymbols(elf, symbolTable);
+    for (size_t i = 1; i < symbolCount; ++i)
+    {
+        if (ELF_ST_TYPE(elf_getSymbolInfo(elf, symbolTable, i)) == STT_FUNC)
+            mark(elf_getSymbolValue(elf, symbolTable, i), LEADER | FUNCTION);
+    }
+
+    // Linear sweep
+    for (size_t r = 0; r < rangeCount; ++r)
+    {
+        range_t& range = ranges[r];
+        range.flags[0] |= LEADER;
+        for (size_t offset = 0; offset + 2 <= range.size;)
+        {
+            riscv_instruction i;
+            i.format = 0;
+            memcpy(&i.format, range.data + offset, range.size - offset < 4 ? 2 : 4);
+            uintptr_t pc = range.vaddr + offset;
+            size_t length = (i.format & 0b11) == 0b11 ? 4 : 2;
+            if (offset + length > range.size)
+                break;
+            range.flags[offset / 2] |= INSTRUCTION;
+            instructions++;
+            offset += length;
+
+            if (length == 2)
+                i.format = riscv_instruction::expand(i.format);
+            switch (i.opcode)
+            {
+            case 0b1100011:
+                mark(pc + i.simmB(), LEADER);
+                break;
+            case 0b1101111:
+                mark(pc + i.simmJ(), i.rd ? LEADER | FUNCTION : LEADER);
+                break;
+            case 0b1100111:
+                break;
+            case 0b1110011:
+                if (i.funct3 == 0)
+                    break;
+                continue;
+            default:
+                continue;
+            }
+            mark(pc + length, LEADER);
+        }
+    }
+
+    // Blocks start at leaders which are also instruction boundaries
+    for (size_t r = 0; r < rangeCount; ++r)
+    {
+        const range_t& range = ranges[r];
+        for (size_t i = 0; i < range.size / 2; ++i)
+        {
+            if ((range.flags[i] & (INSTRUCTION | LEADER)) == (INSTRUCTION | LEADER))
+                blockCount++;
+            if ((range.flags[i] & (INSTRUCTION | FUNCTION)) == (INSTRUCTION | FUNCTION))
+                functionCount++;
+        }
+    }
+    blocks = new block_t[blockCount];
+    functions = new function_t[functionCount];
+
+    size_t b = 0;
+    size_t f = 0;
+    for (size_t r = 0; r < rangeCount; ++r)
+    {
+        const range_t& range = ranges[r];
+        for (size_t offset = 0; offset < range.size;)
+        {
+            uint8_t flags = range.flags[offset / 2];
+            if ((flags & INSTRUCTION) == 0)
+            {
+                offset += 2;
+                continue;
+            }
+            if (flags & FUNCTION)
+            {
+                function_t& function = functions[f++];
+                function.begin = range.vaddr + offset;
+                function.end = function.begin;
+                function.name = nullptr;
+                function.block = b;
+                function.blockCount = 0;
+            }
+
+            block_t& block = blocks[b++];
+            block.begin = range.vaddr + offset;
+            block.target = 0;
+            block.next = 0;
+            block.function = f ? uint32_t(f - 1) : UINT32_MAX;
+            block.kind = FALLTHROUGH;
+            block.reachable = false;
+
+            riscv_instruction i;
+            do
+            {
+                i.format = 0;
+                memcpy(&i.format, range.data + offset, range.size - offset < 4 ? 2 : 4);
+                offset += (i.format & 0b11) == 0b11 ? 4 : 2;
+            } while (offset < range.size && (range.flags[offset / 2] & (INSTRUCTION | LEADER)) == INSTRUCTION);
+
+            size_t length = (i.format & 0b11) == 0b11 ? 4 : 2;
+            block.end = range.vaddr + offset;
+            uintptr_t pc = block.end - length;
+            if (offset < range.size)
+                block.next = block.end;
+            if (length == 2)
+                i.format = riscv_instruction::expand(i.format);
+            switch (i.opcode)
+            {
+            case 0b1100011:
+                block.kind = BRANCH;
+                block.target = pc + i.simmB();
+                break;
+            case 0b1101111:
+                block.kind = i.rd ? CALL : JUMP;
+                block.target = pc + i.simmJ();
+                if (i.rd == 0)
+                    block.next = 0;
+                break;
+            case 0b1100111:
+                block.kind = (i.rd == 0 && i.rs1 == 1 && i.immI() == 0) ? RETURN : INDIRECT;
+                if (i.rd == 0)
+                    block.next = 0;
+                break;
+            case 0b1110011:
+                if (i.funct3 == 0)
+                    block.kind = SYSTEM;
+                break;
+            }
+            if (f)
+            {
+                functions[f - 1].end = block.end;
+                functions[f - 1].blockCount++;
+            }
+        }
+    }
+    blockCount = b;
+    functionCount = f;
+
+    // Names of symbols which start a function, labels such as _start included
+    for (size_t i = 1; i < symbolCount; ++i)
+    {
+        unsigned char type = ELF_ST_TYPE(elf_getSymbolInfo(elf, symbolTable, i));
+        if (type != STT_FUNC && type != STT_NOTYPE)
+            continue;
+        function_t* function = (function_t*)this->function(elf_getSymbolValue(elf, symbolTable, i));
+        const char* name = elf_getSymbolName(elf, symbolTable, i);
+        if (function && function->begin == elf_getSymbolValue(elf, symbolTable, i) && name && name[0])
+        {
+            if (function->name == nullptr || type == STT_FUNC)
+                function->name = name;
+        }
+    }
+
+    // Reachability over direct edges from every function, each block is
+    // expanded once and pushes at most two edges
+    size_t* stack = new size_t[functionCount + blockCount * 2 + 1];
+    size_t top = 0;
+    for (size_t i = 0; i < functionCount; ++i)
+    {
+        if (functions[i].blockCount)
+            stack[top++] = functions[i].block;
+    }
+    while (top)
+    {
+        block_t& block = blocks[stack[--top]];
+        if (block.reachable)
+            continue;
+        block.reachable = true;
+        uintptr_t edges[2] = { block.target, block.next };
+        for (uintptr_t edge : edges)
+        {
+            size_t j = edge ? index(edge) : blockCount;
+            if (j < blockCount && blocks[j].begin == edge && blocks[j].reachable == false)
+                stack[top++] = j;
+        }
+    }
+    delete[] stack;
+
+    for (size_t i = 0; i < rangeCount; ++i)
+    {
+        delete[] ranges[i].flags;
+    }
+    rangeCount = 0;
+
+    error = nullptr;
+    return true;
+}
+//------------------------------------------------------------------------------
+const riscv_cfg::block_t* riscv_cfg::block(uintptr_t address) const
+{
+    size_t i = index(address);
+    if (i >= blockCount || address >= blocks[i].end)
+        return nullptr;
+    return &blocks[i];
+}
+//------------------------------------------------------------------------------
+const riscv_cfg::function_t* riscv_cfg::function(uintptr_t address) const
+{
+    size_t low = 0;
+    size_t high = functionCount;
+    while (low < high)
+    {
+        size_t middle = (low + high) / 2;
+        if (functions[middle].begin <= address)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low == 0 || address >= functions[low - 1].end)
+        return nullptr;
+    return &functions[low - 1];
+}
+//------------------------------------------------------------------------------
+bool riscv_cfg::code(uintptr_t address, size_t page) const
+{
+    uintptr_t first = address & ~(page - 1);
+    uintptr_t last = first + page;
+    size_t i = index(last - 1);
+    return i < blockCount && blocks[i].end > first;
+}
+//------------------------------------------------------------------------------
+void riscv_cfg::prefetch(uintptr_t bias) const
+{
+    // Adjacent blocks are merged into one advice per contiguous range
+    uintptr_t page = 4096;
+    for (size_t i = 0; i < blockCount;)
+    {
+        uintptr_t begin = blocks[i].begin;
+        uintptr_t end = blocks[i].end;
+        for (++i; i < blockCount && blocks[i].begin <= end; ++i)
+            end = blocks[i].end;
+        begin = (bias + begin) & ~(page - 1);
+        end = (bias + end + page - 1) & ~(page - 1);
+        madvise((void*)begin, end - begin, MADV_WILLNEED);
+    }
+}
+//------------------------------------------------------------------------------
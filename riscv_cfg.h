@@ -0,0 +1,98 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "libelf/elf.h"
+
+//------------------------------------------------------------------------------
+// Static control-flow graph
+//------------------------------------------------------------------------------
+// build() decodes the SHF_EXECINSTR sections of an ELF linearly, or the PF_X
+// segments when there are no section headers. Blocks start at the entry point,
+// function symbols, JAL and BRANCH targets and after every control transfer,
+// ECALL and EBREAK. Functions start at the entry point, STT_FUNC symbols and
+// the targets of JAL with a link register, and end where the next one starts.
+// Blocks reachable through direct edges from a function are marked, the rest
+// was only found by the sweep (jump table targets, dead code or data).
+// Addresses are link addresses, a loaded ET_DYN image adds its bias. Function
+// names point into the ELF file.
+//   block()     block containing an address
+//   function()  function containing an address
+//   code()      whether the page of an address holds any block
+//   prefetch()  madvise() the code pages of a loaded image
+//------------------------------------------------------------------------------
+struct riscv_cfg
+{
+    enum kind
+    {
+        FALLTHROUGH,    // ends in front of another block
+        BRANCH,         // target or next
+        JUMP,           // target
+        CALL,           // target, returns to next
+        RETURN,         // JALR x0, 0(ra)
+        INDIRECT,       // any other JALR
+        SYSTEM,         // ECALL or EBREAK, next
+    };
+
+    struct block_t
+    {
+        uintptr_t begin;
+        uintptr_t end;
+        uintptr_t target;
+        uintptr_t next;
+        uint32_t function;
+        uint8_t kind;
+        bool reachable;
+    };
+
+    struct function_t
+    {
+        uintptr_t begin;
+        uintptr_t end;
+        const char* name;
+        size_t block;
+        size_t blockCount;
+    };
+
+    riscv_cfg();
+    ~riscv_cfg();
+
+    bool build(const elf_t* elf);
+    void clear();
+
+    const block_t* block(uintptr_t address) const;
+    const function_t* function(uintptr_t address) const;
+    bool code(uintptr_t address, size_t page = 4096) const;
+    void prefetch(uintptr_t bias = 0) const;
+
+public:
+    block_t* blocks;
+    size_t blockCount;
+    function_t* functions;
+    size_t functionCount;
+    size_t instructions;
+    const char* error;
+
+protected:
+    enum { MAX_RANGE = 16 };
+    struct range_t
+    {
+        uintptr_t vaddr;
+        const uint8_t* data;
+        size_t size;
+        uint8_t* flags;
+    };
+    range_t ranges[MAX_RANGE];
+    size_t rangeCount;
+
+    void mark(uintptr_t address, uint8_t flag);
+    size_t index(uintptr_t address) const;
+};
+//------------------------------------------------------------------------------
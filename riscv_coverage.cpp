@@ -0,0 +1,83 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/shm.h>
+#include "riscv_coverage.h"
+
+//------------------------------------------------------------------------------
+riscv_coverage::riscv_coverage() : riscv_plugin(BLOCK)
+{
+    size_t size = 1 << 16;
+    const char* mapSize = getenv("AFL_MAP_SIZE");
+    if (mapSize)
+        size = strtoul(mapSize, nullptr, 10);
+    setup(size);
+
+    bitmap = nullptr;
+    shared = nullptr;
+    owned = false;
+
+    const char* id = getenv("__AFL_SHM_ID");
+    if (id)
+    {
+        void* memory = shmat(atoi(id), nullptr, 0);
+        if (memory != (void*)-1)
+        {
+            bitmap = (uint8_t*)memory;
+            shared = memory;
+        }
+    }
+    if (bitmap == nullptr)
+    {
+        bitmap = new uint8_t[riscv_coverage::size];
+        owned = true;
+    }
+
+    reset();
+}
+//------------------------------------------------------------------------------
+riscv_coverage::riscv_coverage(void* bitmap, size_t size) : riscv_plugin(BLOCK)
+{
+    setup(size);
+
+    riscv_coverage::bitmap = (uint8_t*)bitmap;
+    shared = nullptr;
+    owned = false;
+
+    reset();
+}
+//------------------------------------------------------------------------------
+riscv_coverage::~riscv_coverage()
+{
+    if (shared)
+        shmdt(shared);
+    if (owned)
+        delete[] bitmap;
+}
+//------------------------------------------------------------------------------
+void riscv_coverage::setup(size_t size)
+{
+    // The index is a hash of the pc, so the map is rounded down to 2^n
+    shift = 63;
+    while (shift > 1 && (size_t(1) << (64 - shift + 1)) <= size)
+        shift--;
+    riscv_coverage::size = size_t(1) << (64 - shift);
+}
+//------------------------------------------------------------------------------
+size_t riscv_coverage::footprint() const
+{
+    return sizeof(riscv_coverage) + size;
+}
+//------------------------------------------------------------------------------
+void riscv_coverage::reset()
+{
+    memset(bitmap, 0, size);
+    previous = 0;
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,58 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "riscv_cpu.h"
+#include "riscv_plugin.h"
+
+//------------------------------------------------------------------------------
+// Edge coverage
+//------------------------------------------------------------------------------
+// AFL-style 8-bit hit counters indexed by (previous block ^ current block).
+// Blocks are identified by the target pc of every BRANCH, JAL and JALR, so the
+// map is only touched once per basic block. The same layout can be handed to
+// libFuzzer as an extra counters region.
+//------------------------------------------------------------------------------
+struct riscv_coverage : public riscv_plugin
+{
+    riscv_coverage();
+    riscv_coverage(void* bitmap, size_t size);
+    ~riscv_coverage();
+
+    void reset();
+    void edge(uintptr_t pc);
+    void block(const riscv_cpu& cpu, uintptr_t address);
+    size_t footprint() const;
+
+public:
+    uint8_t* bitmap;
+    size_t size;
+
+protected:
+    void setup(size_t size);
+
+    unsigned int shift;
+    uintptr_t previous;
+    void* shared;
+    bool owned;
+};
+//------------------------------------------------------------------------------
+inline void riscv_coverage::edge(uintptr_t pc)
+{
+    uintptr_t location = uintptr_t(uint64_t(pc) * 0x9E3779B97F4A7C15ull >> shift);
+    bitmap[location ^ previous]++;
+    previous = location >> 1;
+}
+//------------------------------------------------------------------------------
+inline void riscv_coverage::block(const riscv_cpu& cpu, uintptr_t address)
+{
+    edge(cpu.pc);
+}
+//------------------------------------------------------------------------------
@@ -9,7 +9,15 @@
 #include <setjmp.h>
 #include <signal.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "riscv_aot.h"
 #include "riscv_cpu.h"
+#include "riscv_float.h"
+#include "riscv_plugin.h"
+#include "riscv_predecode.h"
+#include "riscv_simd.h"
 
 #define HINT HINT
 
@@ -23,10 +31,38 @@ const riscv_cpu::instruction_pointer riscv_cpu::map32[8 * 4] =
 {
     o LOAD      x LOAD_FP   x HINT  x MISC_MEM  x OP_IMM    x AUIPC x OP_IMM_32 x HINT
     x STORE     x STORE_FP  x HINT  x AMO       x OP        x LUI   x OP_32     x HINT
-    x MADD      x MSUB      x NMSUB x NMADD     x OP_FP     x HINT  x HINT      x HINT
+    x MADD      x MSUB      x NMSUB x NMADD     x OP_FP     x OP_V  x HINT      x HINT
     x BRANCH    x JALR      x HINT  x JAL       x SYSTEM    x HINT  x HINT      x HINT
 };
 //------------------------------------------------------------------------------
+// Handlers selected by decode(), the position is what riscv_predecode stores
+//------------------------------------------------------------------------------
+const riscv_cpu::instruction_pointer riscv_cpu::handlers[] =
+{
+    o HINT      x LOAD_FP   x STORE_FP  x MADD      x MSUB      x NMSUB     x NMADD     x OP_FP
+    x LUI       x AUIPC     x JAL       x JALR      x BEQ       x BNE       x BLT       x BGE
+    x BLTU      x BGEU      x LB        x LH        x LW        x LBU       x LHU       x SB
+    x SH        x SW        x ADDI      x SLTI      x SLTIU     x XORI      x ORI       x ANDI
+    x SLLI      x SRLI      x SRAI      x ADD       x SUB       x SLL       x SLT       x SLTU
+    x XOR       x SRL       x SRA       x OR        x AND       x FENCE     x ECALL     x EBREAK
+    x LWU       x LD        x SD        x ADDIW     x SLLIW     x SRLIW     x SRAIW     x ADDW
+    x SUBW      x SLLW      x SRLW      x SRAW      x FENCE_I   x CSRRW     x CSRRS     x CSRRC
+    x CSRRWI    x CSRRSI    x CSRRCI    x MUL       x MULH      x MULHSU    x MULHU     x DIV
+    x DIVU      x REM       x REMU      x MULW      x DIVW      x DIVUW     x REMW      x REMUW
+    x LR_W      x SC_W      x AMOSWAP_W x AMOADD_W  x AMOXOR_W  x AMOAND_W  x AMOOR_W   x AMOMIN_W
+    x AMOMAX_W  x AMOMINU_W x AMOMAXU_W x LR_D      x SC_D      x AMOSWAP_D x AMOADD_D  x AMOXOR_D
+    x AMOAND_D  x AMOOR_D   x AMOMIN_D  x AMOMAX_D  x AMOMINU_D x AMOMAXU_D x SH1ADD    x SH2ADD
+    x SH3ADD    x ADD_UW    x SH1ADD_UW x SH2ADD_UW x SH3ADD_UW x SLLI_UW   x ANDN      x ORN
+    x XNOR      x CLZ       x CTZ       x CPOP      x MAX       x MAXU      x MIN       x MINU
+    x SEXT_B    x SEXT_H    x ZEXT_H    x ROL       x ROR       x RORI      x ORC_B     x REV8
+    x CLZW      x CTZW      x CPOPW     x ROLW      x RORW      x RORIW     x BCLR      x BCLRI
+    x BEXT      x BEXTI     x BINV      x BINVI     x BSET      x BSETI     x OP_V      x CLMUL
+    x CLMULH    x CLMULR    x AES64ES   x AES64ESM  x AES64DS   x AES64DSM  x AES64IM   x AES64KS1I
+    x AES64KS2  x SHA256SIG0 x SHA256SIG1 x SHA256SUM0 x SHA256SUM1 x SHA512SIG0 x SHA512SIG1 x SHA512SUM0
+    x SHA512SUM1
+};
+const size_t riscv_cpu::handlerCount = sizeof(handlers) / sizeof(handlers[0]);
+//------------------------------------------------------------------------------
 #undef o
 #undef x
 //------------------------------------------------------------------------------
@@ -50,17 +86,32 @@ static void unregister_handler()
 //------------------------------------------------------------------------------
 riscv_cpu::riscv_cpu()
 {
-    stack = new uintptr_t[8192];
+    // Pages are only committed once the guest touches them
+    void* mapping = mmap(nullptr, STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    stackMapped = (mapping != MAP_FAILED);
+    stack = stackMapped ? (uintptr_t*)mapping : new uintptr_t[STACK_SIZE / sizeof(uintptr_t)];
 
     environmentCall = [](riscv_cpu&cpu) {};
     environmentBreakpoint = [](riscv_cpu&cpu) {};
 
+    pluginCount = 0;
+    pluginHooks = 0;
+
+    frounding = 0b000;
+
+#if RISCV_HAVE_VECTOR
+    simd = &riscv_simd::host();
+#endif
+
     program(nullptr, 0);
 }
 //------------------------------------------------------------------------------
 riscv_cpu::~riscv_cpu()
 {
-    delete[] stack;
+    if (stackMapped)
+        munmap(stack, STACK_SIZE);
+    else
+        delete[] stack;
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::program(const void* code, size_t size)
@@ -73,6 +124,7 @@ void riscv_cpu::program(const void* code, size_t size)
         x[i] = 0;
     }
     pc = (uintptr_t)code;
+    length = 4;
 
     for (int i = 0; i < 32; ++i)
     {
@@ -80,26 +132,153 @@ void riscv_cpu::program(const void* code, size_t size)
     }
     fcsr = 0;
 
+#if RISCV_HAVE_VECTOR
+    // vill until the first vsetvl
+    memset(v, 0, sizeof(v));
+    vl = 0;
+    vtype = uintptr_t(1) << (sizeof(uintptr_t) * 8 - 1);
+    vxrm = 0;
+    vxsat = 0;
+#endif
+
     begin = pc;
     end = pc + size;
 
-    x[2] = (uintptr_t)&stack[8188];
+    x[2] = (uintptr_t)&stack[STACK_SIZE / sizeof(uintptr_t) - 4];
 }
 //------------------------------------------------------------------------------
-bool riscv_cpu::issue()
+bool riscv_cpu::attach(riscv_plugin* plugin)
+{
+    if (pluginCount >= MAX_PLUGIN)
+        return false;
+    plugins[pluginCount++] = plugin;
+    pluginHooks |= plugin->hooks;
+    return true;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::detach(riscv_plugin* plugin)
+{
+    size_t count = 0;
+    pluginHooks = 0;
+    for (size_t i = 0; i < pluginCount; ++i)
+    {
+        if (plugins[i] == plugin)
+            continue;
+        plugins[count++] = plugins[i];
+        pluginHooks |= plugins[i]->hooks;
+    }
+    pluginCount = count;
+}
+//------------------------------------------------------------------------------
+template <typename A, typename V>
+static int incore(int (*function)(A, size_t, V*), const void* address, size_t size, unsigned char* vector)
+{
+    return function((A)address, size, (V*)vector);
+}
+//------------------------------------------------------------------------------
+static size_t resident(const void* address, size_t size)
+{
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t begin = (uintptr_t)address & ~(page - 1);
+    uintptr_t end = ((uintptr_t)address + size + page - 1) & ~(page - 1);
+
+    size_t total = 0;
+    unsigned char vector[256];
+    while (begin < end)
+    {
+        size_t count = (end - begin) / page;
+        if (count > sizeof(vector))
+            count = sizeof(vector);
+        if (incore(mincore, (void*)begin, count * page, vector) == 0)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                total += (vector[i] & 1) * page;
+            }
+        }
+        begin += count * page;
+    }
+    return total;
+}
+//------------------------------------------------------------------------------
+riscv_cpu::footprint_t riscv_cpu::footprint() const
+{
+    footprint_t footprint;
+    footprint.registers = sizeof(riscv_cpu);
+    footprint.stack = stackMapped ? resident(stack, STACK_SIZE) : STACK_SIZE;
+    footprint.guest = begin < end ? resident((void*)begin, end - begin) : 0;
+    footprint.plugin = 0;
+    for (size_t i = 0; i < pluginCount; ++i)
+    {
+        footprint.plugin += plugins[i]->footprint();
+    }
+    footprint.cache = 0;
+    return footprint;
+}
+//------------------------------------------------------------------------------
+riscv_cpu::footprint_t riscv_cpu::footprint(const riscv_predecode* predecode, const riscv_aot* aot) const
+{
+    footprint_t footprint = this->footprint();
+    if (predecode)
+        footprint.cache += predecode->footprint();
+    if (aot)
+        footprint.cache += aot->footprint();
+    return footprint;
+}
+//------------------------------------------------------------------------------
+template <bool instrumented>
+bool riscv_cpu::step()
 {
     uintptr_t address = pc;
     format = *(uint32_t*)address;
-
-    switch (__builtin_ctz(~opcode))
+    length = 4;
+    if ((format & 0b11) != 0b11)
     {
-    case 0:
-    case 1:
+        format = expansion[format & 0xFFFF];
+        length = 2;
+    }
+
+    if (instrumented)
     {
-        if (pc == address)
-            pc += 2;
-        break;
+        // Only plugins which use host floating point leave the guest fflags and frm
+        if (pluginHooks & riscv_plugin::FLOAT)
+        {
+            ftestexcept();
+            fsetround(0b000);
+        }
+        if (pluginHooks & riscv_plugin::FETCH)
+        {
+            for (size_t i = 0; i < pluginCount; ++i)
+            {
+                if (plugins[i]->hooks & riscv_plugin::FETCH)
+                    plugins[i]->fetch(*this);
+            }
+        }
+        if (pluginHooks & riscv_plugin::MEMORY)
+        {
+            uintptr_t memory;
+            bool store;
+            size_t size = access(memory, store);
+            for (size_t i = 0; size && i < pluginCount; ++i)
+            {
+                if (plugins[i]->hooks & riscv_plugin::MEMORY)
+                    plugins[i]->memory(*this, memory, size, store);
+            }
+        }
+        if (pluginHooks & riscv_plugin::ECALL && format == 0b1110011)
+        {
+            for (size_t i = 0; i < pluginCount; ++i)
+            {
+                if (plugins[i]->hooks & riscv_plugin::ECALL)
+                    plugins[i]->ecall(*this);
+            }
+        }
+        if (pluginHooks & riscv_plugin::FLOAT)
+            fclearexcept();
     }
+
+    switch (__builtin_ctz(~opcode))
+    {
     case 2:
     case 3:
     case 4:
@@ -108,7 +287,7 @@ bool riscv_cpu::issue()
         (this->*inst)();
 
         if (pc == address)
-            pc += 4;
+            pc += length;
         break;
     }
     case 5:
@@ -128,46 +307,544 @@ bool riscv_cpu::issue()
     }
     x[0] = 0;
 
+    if (instrumented)
+    {
+        if (pluginHooks & riscv_plugin::FLOAT)
+        {
+            ftestexcept();
+            fsetround(0b000);
+        }
+        if (pluginHooks & riscv_plugin::RETIRE)
+        {
+            for (size_t i = 0; i < pluginCount; ++i)
+            {
+                if (plugins[i]->hooks & riscv_plugin::RETIRE)
+                    plugins[i]->retire(*this, address);
+            }
+        }
+        // BRANCH, JALR and JAL
+        if (pluginHooks & riscv_plugin::BLOCK && (opcode & 0b1110011) == 0b1100011)
+        {
+            for (size_t i = 0; i < pluginCount; ++i)
+            {
+                if (plugins[i]->hooks & riscv_plugin::BLOCK)
+                    plugins[i]->block(*this, address);
+            }
+        }
+        if (pluginHooks & riscv_plugin::FLOAT)
+            fclearexcept();
+    }
+
     return true;
 }
 //------------------------------------------------------------------------------
-bool riscv_cpu::run()
+template <bool instrumented, bool once>
+bool riscv_cpu::loop()
 {
     bool success = false;
     register_handler();
+    fclearexcept();
     if (check_handler() == 0)
     {
         while (pc >= begin && pc < end)
         {
-            if (issue() == false)
+            if (step<instrumented>() == false)
+                break;
+            if (once)
                 break;
         }
         success = true;
     }
+    else if (instrumented && pluginHooks & riscv_plugin::FAULT)
+    {
+        ftestexcept();
+        fsetround(0b000);
+        for (size_t i = 0; i < pluginCount; ++i)
+        {
+            if (plugins[i]->hooks & riscv_plugin::FAULT)
+                plugins[i]->fault(*this);
+        }
+        fclearexcept();
+    }
+    ftestexcept();
+    fsetround(0b000);
     unregister_handler();
 
     return success;
 }
 //------------------------------------------------------------------------------
-bool riscv_cpu::runOnce()
+bool riscv_cpu::run(const riscv_predecode& predecode)
 {
+    if (pluginCount || predecode.empty())
+        return run();
+
     bool success = false;
     register_handler();
+    fclearexcept();
     if (check_handler() == 0)
     {
         while (pc >= begin && pc < end)
         {
-            if (issue() == false)
-                break;
-            break;
+            // Entries are only trusted while the code still matches them
+            uintptr_t address = pc;
+            const riscv_predecode::entry_t* entry = predecode.lookup(address);
+            if (entry == nullptr || entry->code != *(uint32_t*)address || entry->handler >= handlerCount)
+            {
+                if (step<false>() == false)
+                    break;
+                continue;
+            }
+
+            format = entry->format;
+            length = entry->length;
+            instruction_pointer inst = handlers[entry->handler];
+            (this->*inst)();
+
+            if (pc == address)
+                pc += length;
+            x[0] = 0;
         }
         success = true;
     }
+    ftestexcept();
+    fsetround(0b000);
     unregister_handler();
 
     return success;
 }
 //------------------------------------------------------------------------------
+uint16_t riscv_cpu::decode(uint32_t format)
+{
+    // Opcodes which are not resolved here keep their opcode handler
+    instruction_pointer inst = select(format);
+    for (size_t i = 0; i < handlerCount; ++i)
+    {
+        if (handlers[i] == inst)
+            return uint16_t(i);
+    }
+    return UINT16_MAX;
+}
+//------------------------------------------------------------------------------
+// Decoding of the integer opcodes, shared by the interpreter and decode()
+//------------------------------------------------------------------------------
+template <>
+riscv_cpu::instruction_pointer riscv_cpu::select<0b00000>(const riscv_instruction& i)
+{
+    switch (i.funct3)
+    {
+    case 0b000: return &riscv_cpu::LB;
+    case 0b001: return &riscv_cpu::LH;
+    case 0b010: return &riscv_cpu::LW;
+    case 0b011: return &riscv_cpu::LD;
+    case 0b100: return &riscv_cpu::LBU;
+    case 0b101: return &riscv_cpu::LHU;
+    case 0b110: return &riscv_cpu::LWU;
+    default:    return &riscv_cpu::HINT;
+    }
+}
+//------------------------------------------------------------------------------
+template <>
+riscv_cpu::instruction_pointer riscv_cpu::select<0b00011>(const riscv_instruction& i)
+{
+    switch (i.funct3)
+    {
+    case 0b000: return &riscv_cpu::FENCE;
+    case 0b001: return &riscv_cpu::FENCE_I;
+    default:    return &riscv_cpu::HINT;
+    }
+}
+//------------------------------------------------------------------------------
+template <>
+riscv_cpu::instruction_pointer riscv_cpu::select<0b00100>(const riscv_instruction& i)
+{
+    switch (i.funct3)
+    {
+    case 0b000: return &riscv_cpu::ADDI;
+    case 0b001: switch (i.funct7 >> 1)
+                {
+                case 0b000000: return &riscv_cpu::SLLI;
+                case 0b001010: return &riscv_cpu::BSETI;
+                case 0b010010: return &riscv_cpu::BCLRI;
+                case 0b011010: return &riscv_cpu::BINVI;
+                case 0b000100: switch (i.immI())
+                               {
+                               case 0b000100000000: return &riscv_cpu::SHA256SUM0;
+                               case 0b000100000001: return &riscv_cpu::SHA256SUM1;
+                               case 0b000100000010: return &riscv_cpu::SHA256SIG0;
+                               case 0b000100000011: return &riscv_cpu::SHA256SIG1;
+                               case 0b000100000100: return &riscv_cpu::SHA512SUM0;
+                               case 0b000100000101: return &riscv_cpu::SHA512SUM1;
+                               case 0b000100000110: return &riscv_cpu::SHA512SIG0;
+                               case 0b000100000111: return &riscv_cpu::SHA512SIG1;
+                               default:             return &riscv_cpu::HINT;
+                               }
+                case 0b001100: switch (i.immI() >> 4)
+                               {
+                               case 0b00110000: return (i.immI() & 0xF) ? &riscv_cpu::HINT : &riscv_cpu::AES64IM;
+                               case 0b00110001: return (i.immI() & 0xF) <= 0xA ? &riscv_cpu::AES64KS1I : &riscv_cpu::HINT;
+                               default:         return &riscv_cpu::HINT;
+                               }
+                case 0b011000: switch (i.immI())
+                               {
+                               case 0b011000000000: return &riscv_cpu::CLZ;
+                               case 0b011000000001: return &riscv_cpu::CTZ;
+                               case 0b011000000010: return &riscv_cpu::CPOP;
+                               case 0b011000000100: return &riscv_cpu::SEXT_B;
+                               case 0b011000000101: return &riscv_cpu::SEXT_H;
+                               default:             return &riscv_cpu::HINT;
+                               }
+                default:       return &riscv_cpu::HINT;
+                }
+    case 0b010: return &riscv_cpu::SLTI;
+    case 0b011: return &riscv_cpu::SLTIU;
+    case 0b100: return &riscv_cpu::XORI;
+    case 0b101: switch (i.funct7 >> 1)
+                {
+                case 0b000000: return &riscv_cpu::SRLI;
+                case 0b010000: return &riscv_cpu::SRAI;
+                case 0b010010: return &riscv_cpu::BEXTI;
+                case 0b011000: return &riscv_cpu::RORI;
+                case 0b001010: switch (i.immI())
+                               {
+                               case 0b001010000111: return &riscv_cpu::ORC_B;
+                               default:             return &riscv_cpu::HINT;
+                               }
+                case 0b011010: switch (i.immI())
+                               {
+                               case 0b011010111000: return &riscv_cpu::REV8;
+                               default:             return &riscv_cpu::HINT;
+                               }
+                default:       return &riscv_cpu::HINT;
+                }
+    case 0b110: return &riscv_cpu::ORI;
+    default:    return &riscv_cpu::ANDI;
+    }
+}
+//------------------------------------------------------------------------------
+template <>
+riscv_cpu::instruction_pointer riscv_cpu::select<0b00110>(const riscv_instruction& i)
+{
+    switch (i.funct3)
+    {
+    case 0b000: return &riscv_cpu::ADDIW;
+    case 0b001: switch (i.funct7 >> 1)
+                {
+                case 0b000000: switch (i.funct7)
+                               {
+                               case 0b0000000: return &riscv_cpu::SLLIW;
+                               default:        return &riscv_cpu::HINT;
+                               }
+                case 0b000010: return &riscv_cpu::SLLI_UW;
+                case 0b011000: switch (i.immI())
+                               {
+                               case 0b011000000000: return &riscv_cpu::CLZW;
+                               case 0b011000000001: return &riscv_cpu::CTZW;
+                               case 0b011000000010: return &riscv_cpu::CPOPW;
+                               default:             return &riscv_cpu::HINT;
+                               }
+                default:       return &riscv_cpu::HINT;
+                }
+    case 0b101: switch (i.funct7)
+                {
+                case 0b0000000: return &riscv_cpu::SRLIW;
+                case 0b0100000: return &riscv_cpu::SRAIW;
+                case 0b0110000: return &riscv_cpu::RORIW;
+                default:        return &riscv_cpu::HINT;
+                }
+    default:    return &riscv_cpu::HINT;
+    }
+}
+//------------------------------------------------------------------------------
+template <>
+riscv_cpu::instruction_pointer riscv_cpu::select<0b01000>(const riscv_instruction& i)
+{
+    switch (i.funct3)
+    {
+    case 0b000: return &riscv_cpu::SB;
+    case 0b001: return &riscv_cpu::SH;
+    case 0b010: return &riscv_cpu::SW;
+    case 0b011: return &riscv_cpu::SD;
+    default:    return &riscv_cpu::HINT;
+    }
+}
+//------------------------------------------------------------------------------
+template <>
+riscv_cpu::instruction_pointer riscv_cpu::select<0b01011>(const riscv_instruction& i)
+{
+    switch (i.funct3)
+    {
+    case 0b010: switch (i.funct5)
+                {
+                case 0b00000: return &riscv_cpu::AMOADD_W;
+                case 0b00001: return &riscv_cpu::AMOSWAP_W;
+                case 0b00010: return &riscv_cpu::LR_W;
+                case 0b00011: return &riscv_cpu::SC_W;
+                case 0b00100: return &riscv_cpu::AMOXOR_W;
+                case 0b01000: return &riscv_cpu::AMOOR_W;
+                case 0b01100: return &riscv_cpu::AMOAND_W;
+                case 0b10000: return &riscv_cpu::AMOMIN_W;
+                case 0b10100: return &riscv_cpu::AMOMAX_W;
+                case 0b11000: return &riscv_cpu::AMOMINU_W;
+                case 0b11100: return &riscv_cpu::AMOMAXU_W;
+                default:      return &riscv_cpu::HINT;
+                }
+    case 0b011: switch (i.funct5)
+                {
+                case 0b00000: return &riscv_cpu::AMOADD_D;
+                case 0b00001: return &riscv_cpu::AMOSWAP_D;
+                case 0b00010: return &riscv_cpu::LR_D;
+                case 0b00011: return &riscv_cpu::SC_D;
+                case 0b00100: return &riscv_cpu::AMOXOR_D;
+                case 0b01000: return &riscv_cpu::AMOOR_D;
+                case 0b01100: return &riscv_cpu::AMOAND_D;
+                case 0b10000: return &riscv_cpu::AMOMIN_D;
+                case 0b10100: return &riscv_cpu::AMOMAX_D;
+                case 0b11000: return &riscv_cpu::AMOMINU_D;
+                case 0b11100: return &riscv_cpu::AMOMAXU_D;
+                default:      return &riscv_cpu::HINT;
+                }
+    default:    return &riscv_cpu::HINT;
+    }
+}
+//------------------------------------------------------------------------------
+template <>
+riscv_cpu::instruction_pointer riscv_cpu::select<0b01100>(const riscv_instruction& i)
+{
+    switch (i.funct7)
+    {
+    case 0b0000000: switch (i.funct3)
+                    {
+                    case 0b000: return &riscv_cpu::ADD;
+                    case 0b001: return &riscv_cpu::SLL;
+                    case 0b010: return &riscv_cpu::SLT;
+                    case 0b011: return &riscv_cpu::SLTU;
+                    case 0b100: return &riscv_cpu::XOR;
+                    case 0b101: return &riscv_cpu::SRL;
+                    case 0b110: return &riscv_cpu::OR;
+                    default:    return &riscv_cpu::AND;
+                    }
+    case 0b0000001: switch (i.funct3)
+                    {
+                    case 0b000: return &riscv_cpu::MUL;
+                    case 0b001: return &riscv_cpu::MULH;
+                    case 0b010: return &riscv_cpu::MULHSU;
+                    case 0b011: return &riscv_cpu::MULHU;
+                    case 0b100: return &riscv_cpu::DIV;
+                    case 0b101: return &riscv_cpu::DIVU;
+                    case 0b110: return &riscv_cpu::REM;
+                    default:    return &riscv_cpu::REMU;
+                    }
+    case 0b0000101: switch (i.funct3)
+                    {
+                    case 0b001: return &riscv_cpu::CLMUL;
+                    case 0b010: return &riscv_cpu::CLMULR;
+                    case 0b011: return &riscv_cpu::CLMULH;
+                    case 0b100: return &riscv_cpu::MIN;
+                    case 0b101: return &riscv_cpu::MINU;
+                    case 0b110: return &riscv_cpu::MAX;
+                    case 0b111: return &riscv_cpu::MAXU;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    case 0b0010000: switch (i.funct3)
+                    {
+                    case 0b010: return &riscv_cpu::SH1ADD;
+                    case 0b100: return &riscv_cpu::SH2ADD;
+                    case 0b110: return &riscv_cpu::SH3ADD;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    case 0b0010100: switch (i.funct3)
+                    {
+                    case 0b001: return &riscv_cpu::BSET;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    case 0b0011001: switch (i.funct3)
+                    {
+                    case 0b000: return &riscv_cpu::AES64ES;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    case 0b0011011: switch (i.funct3)
+                    {
+                    case 0b000: return &riscv_cpu::AES64ESM;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    case 0b0011101: switch (i.funct3)
+                    {
+                    case 0b000: return &riscv_cpu::AES64DS;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    case 0b0011111: switch (i.funct3)
+                    {
+                    case 0b000: return &riscv_cpu::AES64DSM;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    case 0b0100000: switch (i.funct3)
+                    {
+                    case 0b000: return &riscv_cpu::SUB;
+                    case 0b100: return &riscv_cpu::XNOR;
+                    case 0b101: return &riscv_cpu::SRA;
+                    case 0b110: return &riscv_cpu::ORN;
+                    case 0b111: return &riscv_cpu::ANDN;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    case 0b0100100: switch (i.funct3)
+                    {
+                    case 0b001: return &riscv_cpu::BCLR;
+                    case 0b101: return &riscv_cpu::BEXT;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    case 0b0110000: switch (i.funct3)
+                    {
+                    case 0b001: return &riscv_cpu::ROL;
+                    case 0b101: return &riscv_cpu::ROR;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    case 0b0110100: switch (i.funct3)
+                    {
+                    case 0b001: return &riscv_cpu::BINV;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    case 0b0111111: switch (i.funct3)
+                    {
+                    case 0b000: return &riscv_cpu::AES64KS2;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    default:        return &riscv_cpu::HINT;
+    }
+}
+//------------------------------------------------------------------------------
+template <>
+riscv_cpu::instruction_pointer riscv_cpu::select<0b01110>(const riscv_instruction& i)
+{
+    switch (i.funct7)
+    {
+    case 0b0000000: switch (i.funct3)
+                    {
+                    case 0b000: return &riscv_cpu::ADDW;
+                    case 0b001: return &riscv_cpu::SLLW;
+                    case 0b101: return &riscv_cpu::SRLW;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    case 0b0000001: switch (i.funct3)
+                    {
+                    case 0b000: return &riscv_cpu::MULW;
+                    case 0b100: return &riscv_cpu::DIVW;
+                    case 0b101: return &riscv_cpu::DIVUW;
+                    case 0b110: return &riscv_cpu::REMW;
+                    case 0b111: return &riscv_cpu::REMUW;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    case 0b0000100: switch (i.funct3)
+                    {
+                    case 0b000: return &riscv_cpu::ADD_UW;
+                    case 0b100: return i.rs2 ? &riscv_cpu::HINT : &riscv_cpu::ZEXT_H;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    case 0b0010000: switch (i.funct3)
+                    {
+                    case 0b010: return &riscv_cpu::SH1ADD_UW;
+                    case 0b100: return &riscv_cpu::SH2ADD_UW;
+                    case 0b110: return &riscv_cpu::SH3ADD_UW;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    case 0b0100000: switch (i.funct3)
+                    {
+                    case 0b000: return &riscv_cpu::SUBW;
+                    case 0b101: return &riscv_cpu::SRAW;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    case 0b0110000: switch (i.funct3)
+                    {
+                    case 0b001: return &riscv_cpu::ROLW;
+                    case 0b101: return &riscv_cpu::RORW;
+                    default:    return &riscv_cpu::HINT;
+                    }
+    default:        return &riscv_cpu::HINT;
+    }
+}
+//------------------------------------------------------------------------------
+template <>
+riscv_cpu::instruction_pointer riscv_cpu::select<0b11000>(const riscv_instruction& i)
+{
+    switch (i.funct3)
+    {
+    case 0b000: return &riscv_cpu::BEQ;
+    case 0b001: return &riscv_cpu::BNE;
+    case 0b100: return &riscv_cpu::BLT;
+    case 0b101: return &riscv_cpu::BGE;
+    case 0b110: return &riscv_cpu::BLTU;
+    case 0b111: return &riscv_cpu::BGEU;
+    default:    return &riscv_cpu::HINT;
+    }
+}
+//------------------------------------------------------------------------------
+template <>
+riscv_cpu::instruction_pointer riscv_cpu::select<0b11100>(const riscv_instruction& i)
+{
+    switch (i.funct3)
+    {
+    case 0b000: switch (i.immI())
+                {
+                case 0b000000000000: return &riscv_cpu::ECALL;
+                case 0b000000000001: return &riscv_cpu::EBREAK;
+                default:             return &riscv_cpu::HINT;
+                }
+    case 0b001: return &riscv_cpu::CSRRW;
+    case 0b010: return &riscv_cpu::CSRRS;
+    case 0b011: return &riscv_cpu::CSRRC;
+    case 0b101: return &riscv_cpu::CSRRWI;
+    case 0b110: return &riscv_cpu::CSRRSI;
+    case 0b111: return &riscv_cpu::CSRRCI;
+    default:    return &riscv_cpu::HINT;
+    }
+}
+//------------------------------------------------------------------------------
+riscv_cpu::instruction_pointer riscv_cpu::select(uint32_t format)
+{
+    riscv_instruction i;
+    i.format = format;
+    if ((i.opcode & 0b11) != 0b11)
+        return nullptr;
+
+    switch (i.opcode >> 2)
+    {
+    case 0b00000: return select<0b00000>(i);
+    case 0b00011: return select<0b00011>(i);
+    case 0b00100: return select<0b00100>(i);
+    case 0b00110: return select<0b00110>(i);
+    case 0b01000: return select<0b01000>(i);
+    case 0b01011: return select<0b01011>(i);
+    case 0b01100: return select<0b01100>(i);
+    case 0b01110: return select<0b01110>(i);
+    case 0b11000: return select<0b11000>(i);
+    case 0b11100: return select<0b11100>(i);
+    default:
+        // LUI, AUIPC, JAL and JALR are handlers themselves, floating-point
+        // and vector opcodes still select on fmt and funct5
+        return map32[i.opcode >> 2];
+    }
+}
+//------------------------------------------------------------------------------
+bool riscv_cpu::issue()
+{
+    if (pluginCount)
+        return step<true>();
+    return step<false>();
+}
+//------------------------------------------------------------------------------
+bool riscv_cpu::run()
+{
+    if (pluginCount)
+        return loop<true, false>();
+    return loop<false, false>();
+}
+//------------------------------------------------------------------------------
+bool riscv_cpu::runOnce()
+{
+    if (pluginCount)
+        return loop<true, true>();
+    return loop<false, true>();
+}
+//------------------------------------------------------------------------------
 void riscv_cpu::fclearexcept()
 {
     feclearexcept(FE_ALL_EXCEPT);
@@ -176,11 +853,62 @@ void riscv_cpu::fclearexcept()
 void riscv_cpu::ftestexcept()
 {
     int raised = fetestexcept(FE_ALL_EXCEPT);
-    fcsr.nv = (raised & FE_INVALID) != 0;
-    fcsr.dz = (raised & FE_DIVBYZERO) != 0;
-    fcsr.of = (raised & FE_OVERFLOW) != 0;
-    fcsr.uf = (raised & FE_UNDERFLOW) != 0;
-    fcsr.nx = (raised & FE_INEXACT) != 0;
+    if (raised == 0)
+        return;
+    fcsr.nv |= (raised & FE_INVALID) != 0;
+    fcsr.dz |= (raised & FE_DIVBYZERO) != 0;
+    fcsr.of |= (raised & FE_OVERFLOW) != 0;
+    fcsr.uf |= (raised & FE_UNDERFLOW) != 0;
+    fcsr.nx |= (raised & FE_INEXACT) != 0;
+    feclearexcept(FE_ALL_EXCEPT);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::fsetround(int rm)
+{
+    // The host has no ties-to-max-magnitude mode and rounds RMM to even
+    static const int modes[8] = { FE_TONEAREST, FE_TOWARDZERO, FE_DOWNWARD, FE_UPWARD, FE_TONEAREST, -1, -1, -1 };
+    if (rm == 0b100)
+        rm = 0b000;
+    if (rm == frounding || modes[rm & 7] < 0)
+        return;
+    frounding = rm;
+    fesetround(modes[rm]);
+}
+//------------------------------------------------------------------------------
+int64_t riscv_cpu::fcvt(double value, int width)
+{
+    double limit = double(uint64_t(1) << (width - 1));
+    double integer = fround(value, rounding());
+    if (integer != integer || integer >= limit)
+    {
+        fcsr.nv = true;
+        return int64_t(~(UINT64_MAX << (width - 1)));
+    }
+    if (integer < -limit)
+    {
+        fcsr.nv = true;
+        return int64_t(UINT64_MAX << (width - 1));
+    }
+    fcsr.nx |= (integer != value);
+    return int64_t(integer);
+}
+//------------------------------------------------------------------------------
+uint64_t riscv_cpu::fcvtu(double value, int width)
+{
+    double limit = double(uint64_t(1) << (width - 1)) * 2;
+    double integer = fround(value, rounding());
+    if (integer != integer || integer >= limit)
+    {
+        fcsr.nv = true;
+        return UINT64_MAX >> (64 - width);
+    }
+    if (integer < 0)
+    {
+        fcsr.nv = true;
+        return 0;
+    }
+    fcsr.nx |= (integer != value);
+    return uint64_t(integer);
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::HINT()
@@ -190,25 +918,23 @@ void riscv_cpu::HINT()
 //------------------------------------------------------------------------------
 void riscv_cpu::LOAD()
 {
-    switch (funct3)
-    {
-    case 0b000: return LB();
-    case 0b001: return LH();
-    case 0b010: return LW();
-    case 0b011: return LD();
-    case 0b100: return LBU();
-    case 0b101: return LHU();
-    case 0b110: return LWU();
-    case 0b111: return HINT();
-    }
+    (this->*select<0b00000>(*this))();
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::LOAD_FP()
 {
     switch (funct3)
     {
+#if RISCV_HAVE_VECTOR
+    case 0b000: return VLOAD();
+#else
     case 0b000: return HINT();
+#endif
+#if RISCV_HAVE_HALF
+    case 0b001: return FLH();
+#else
     case 0b001: return HINT();
+#endif
 #if RISCV_HAVE_SINGLE
     case 0b010: return FLW();
 #endif
@@ -216,88 +942,52 @@ void riscv_cpu::LOAD_FP()
     case 0b011: return FLD();
 #endif
     case 0b100: return HINT();
+#if RISCV_HAVE_VECTOR
+    case 0b101: return VLOAD();
+    case 0b110: return VLOAD();
+    case 0b111: return VLOAD();
+#else
     case 0b101: return HINT();
     case 0b110: return HINT();
     case 0b111: return HINT();
+#endif
     }
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::MISC_MEM()
 {
-    switch (funct3)
-    {
-    case 0b000: return FENCE();
-    case 0b001: return FENCE_I();
-    case 0b010: return HINT();
-    case 0b011: return HINT();
-    case 0b100: return HINT();
-    case 0b101: return HINT();
-    case 0b110: return HINT();
-    case 0b111: return HINT();
-    }
+    (this->*select<0b00011>(*this))();
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::OP_IMM()
 {
-    switch (funct3)
-    {
-    case 0b000: return ADDI();
-    case 0b001: return SLLI();
-    case 0b010: return SLTI();
-    case 0b011: return SLTIU();
-    case 0b100: return XORI();
-    case 0b101: switch (funct7)
-                {
-                case 0b0000000: return SRLI();
-                case 0b0100000: return SRAI();
-                default:        return HINT();
-                }
-    case 0b110: return ORI();
-    case 0b111: return ANDI();
-    }
+    (this->*select<0b00100>(*this))();
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::OP_IMM_32()
 {
-    switch (funct3)
-    {
-    case 0b000: return ADDIW();
-    case 0b001: return SLLIW();
-    case 0b010: return HINT();
-    case 0b011: return HINT();
-    case 0b100: return HINT();
-    case 0b101: switch (funct7)
-                {
-                case 0b0000000: return SRLIW();
-                case 0b0100000: return SRAIW();
-                default:        return HINT();
-                }
-    case 0b110: return HINT();
-    case 0b111: return HINT();
-    }
+    (this->*select<0b00110>(*this))();
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::STORE()
 {
-    switch (funct3)
-    {
-    case 0b000: return SB();
-    case 0b001: return SH();
-    case 0b010: return SW();
-    case 0b011: return SD();
-    case 0b100: return HINT();
-    case 0b101: return HINT();
-    case 0b110: return HINT();
-    case 0b111: return HINT();
-    }
+    (this->*select<0b01000>(*this))();
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::STORE_FP()
 {
     switch (funct3)
     {
+#if RISCV_HAVE_VECTOR
+    case 0b000: return VSTORE();
+#else
     case 0b000: return HINT();
+#endif
+#if RISCV_HAVE_HALF
+    case 0b001: return FSH();
+#else
     case 0b001: return HINT();
+#endif
 #if RISCV_HAVE_SINGLE
     case 0b010: return FSW();
 #endif
@@ -305,141 +995,31 @@ void riscv_cpu::STORE_FP()
     case 0b011: return FSD();
 #endif
     case 0b100: return HINT();
+#if RISCV_HAVE_VECTOR
+    case 0b101: return VSTORE();
+    case 0b110: return VSTORE();
+    case 0b111: return VSTORE();
+#else
     case 0b101: return HINT();
     case 0b110: return HINT();
     case 0b111: return HINT();
+#endif
     }
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::AMO()
 {
-    switch (funct3)
-    {
-    case 0b000: return HINT();
-    case 0b001: return HINT();
-    case 0b010: switch (funct5)
-                {
-                case 0b00000: return AMOADD_W();
-                case 0b00001: return AMOSWAP_W();
-                case 0b00010: return LR_W();
-                case 0b00011: return SC_W();
-                case 0b00100: return AMOXOR_W();
-                case 0b01000: return AMOOR_W();
-                case 0b01100: return AMOAND_W();
-                case 0b10000: return AMOMIN_W();
-                case 0b10100: return AMOMAX_W();
-                case 0b11000: return AMOMINU_W();
-                case 0b11100: return AMOMAXU_W();
-                default:      return HINT();
-                }
-    case 0b011: switch (funct5)
-                {
-                case 0b00000: return AMOADD_D();
-                case 0b00001: return AMOSWAP_D();
-                case 0b00010: return LR_D();
-                case 0b00011: return SC_D();
-                case 0b00100: return AMOXOR_D();
-                case 0b01000: return AMOOR_D();
-                case 0b01100: return AMOAND_D();
-                case 0b10000: return AMOMIN_D();
-                case 0b10100: return AMOMAX_D();
-                case 0b11000: return AMOMINU_D();
-                case 0b11100: return AMOMAXU_D();
-                default:      return HINT();
-                }
-    case 0b100: return HINT();
-    case 0b101: return HINT();
-    case 0b110: return HINT();
-    case 0b111: return HINT();
-    }
+    (this->*select<0b01011>(*this))();
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::OP()
 {
-    switch (funct7)
-    {
-    case 0b0000000: switch (funct3)
-                    {
-                    case 0b000: return ADD();
-                    case 0b001: return SLL();
-                    case 0b010: return SLT();
-                    case 0b011: return SLTU();
-                    case 0b100: return XOR();
-                    case 0b101: return SRL();
-                    case 0b110: return OR();
-                    case 0b111: return AND();
-                    }
-                    break;
-    case 0b0000001: switch (funct3)
-                    {
-                    case 0b000: return MUL();
-                    case 0b001: return MULH();
-                    case 0b010: return MULHSU();
-                    case 0b011: return MULHU();
-                    case 0b100: return DIV();
-                    case 0b101: return DIVU();
-                    case 0b110: return REM();
-                    case 0b111: return REMU();
-                    }
-                    break;
-    case 0b0100000: switch (funct3)
-                    {
-                    case 0b000: return SUB();
-                    case 0b001: return HINT();
-                    case 0b010: return HINT();
-                    case 0b011: return HINT();
-                    case 0b100: return HINT();
-                    case 0b101: return SRA();
-                    case 0b110: return HINT();
-                    case 0b111: return HINT();
-                    }
-                    break;
-    default:        return HINT();
-    }
+    (this->*select<0b01100>(*this))();
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::OP_32()
 {
-    switch (funct7)
-    {
-    case 0b0000000: switch (funct3)
-                    {
-                    case 0b000: return ADDW();
-                    case 0b001: return SLLW();
-                    case 0b010: return HINT();
-                    case 0b011: return HINT();
-                    case 0b100: return HINT();
-                    case 0b101: return SRLW();
-                    case 0b110: return HINT();
-                    case 0b111: return HINT();
-                    }
-                    break;
-    case 0b0000001: switch (funct3)
-                    {
-                    case 0b000: return MULW();
-                    case 0b001: return HINT();
-                    case 0b010: return HINT();
-                    case 0b011: return HINT();
-                    case 0b100: return DIVW();
-                    case 0b101: return DIVUW();
-                    case 0b110: return REMW();
-                    case 0b111: return REMUW();
-                    }
-                    break;
-    case 0b0100000: switch (funct3)
-                    {
-                    case 0b000: return SUBW();
-                    case 0b001: return HINT();
-                    case 0b010: return HINT();
-                    case 0b011: return HINT();
-                    case 0b100: return HINT();
-                    case 0b101: return SRAW();
-                    case 0b110: return HINT();
-                    case 0b111: return HINT();
-                    }
-                    break;
-    default:        return HINT();
-    }
+    (this->*select<0b01110>(*this))();
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::MADD()
@@ -452,7 +1032,11 @@ void riscv_cpu::MADD()
 #if RISCV_HAVE_DOUBLE
     case 0b01: return FMADD_D();
 #endif
+#if RISCV_HAVE_HALF
+    case 0b10: return FMADD_H();
+#else
     case 0b10: return HINT();
+#endif
     case 0b11: return HINT();
     }
 }
@@ -467,7 +1051,11 @@ void riscv_cpu::MSUB()
 #if RISCV_HAVE_DOUBLE
     case 0b01: return FMSUB_D();
 #endif
+#if RISCV_HAVE_HALF
+    case 0b10: return FMSUB_H();
+#else
     case 0b10: return HINT();
+#endif
     case 0b11: return HINT();
     }
 }
@@ -482,7 +1070,11 @@ void riscv_cpu::NMSUB()
 #if RISCV_HAVE_DOUBLE
     case 0b01: return FNMSUB_D();
 #endif
+#if RISCV_HAVE_HALF
+    case 0b10: return FNMSUB_H();
+#else
     case 0b10: return HINT();
+#endif
     case 0b11: return HINT();
     }
 }
@@ -497,7 +1089,11 @@ void riscv_cpu::NMADD()
 #if RISCV_HAVE_DOUBLE
     case 0b01: return FNMADD_D();
 #endif
+#if RISCV_HAVE_HALF
+    case 0b10: return FNMADD_H();
+#else
     case 0b10: return HINT();
+#endif
     case 0b11: return HINT();
     }
 }
@@ -528,9 +1124,17 @@ void riscv_cpu::OP_FP()
                              default:    return HINT();
                              }
                              break;
+               case 0b01000: switch (rs2)
+                             {
 #if RISCV_HAVE_DOUBLE
-               case 0b01000: return FCVT_S_D();
+                             case 0b00001: return FCVT_S_D();
 #endif
+#if RISCV_HAVE_HALF
+                             case 0b00010: return FCVT_S_H();
+#endif
+                             default:      return HINT();
+                             }
+                             break;
                case 0b01011: return FSQRT_S();
                case 0b10100: switch (funct3)
                              {
@@ -596,7 +1200,15 @@ void riscv_cpu::OP_FP()
                              default:    return HINT();
                              }
                              break;
-               case 0b01000: return FCVT_D_S();
+               case 0b01000: switch (rs2)
+                             {
+                             case 0b00000: return FCVT_D_S();
+#if RISCV_HAVE_HALF
+                             case 0b00010: return FCVT_D_H();
+#endif
+                             default:      return HINT();
+                             }
+                             break;
                case 0b01011: return FSQRT_D();
                case 0b10100: switch (funct3)
                              {
@@ -640,43 +1252,119 @@ void riscv_cpu::OP_FP()
                }
                break;
 #endif
+#if RISCV_HAVE_HALF
+    case 0b10: switch (funct5)
+               {
+               case 0b00000: return FADD_H();
+               case 0b00001: return FSUB_H();
+               case 0b00010: return FMUL_H();
+               case 0b00011: return FDIV_H();
+               case 0b00100: switch (funct3)
+                             {
+                             case 0b000: return FSGNJ_H();
+                             case 0b001: return FSGNJN_H();
+                             case 0b010: return FSGNJX_H();
+                             default:    return HINT();
+                             }
+                             break;
+               case 0b00101: switch (funct3)
+                             {
+                             case 0b000: return FMIN_H();
+                             case 0b001: return FMAX_H();
+                             default:    return HINT();
+                             }
+                             break;
+               case 0b01000: switch (rs2)
+                             {
+                             case 0b00000: return FCVT_H_S();
+#if RISCV_HAVE_DOUBLE
+                             case 0b00001: return FCVT_H_D();
+#endif
+                             default:      return HINT();
+                             }
+                             break;
+               case 0b01011: return FSQRT_H();
+               case 0b10100: switch (funct3)
+                             {
+                             case 0b000: return FLE_H();
+                             case 0b001: return FLT_H();
+                             case 0b010: return FEQ_H();
+                             default:    return HINT();
+                             }
+                             break;
+               case 0b11000: switch (rs2)
+                             {
+                             case 0b00000: return FCVT_W_H();
+                             case 0b00001: return FCVT_WU_H();
+                             case 0b00010: return FCVT_L_H();
+                             case 0b00011: return FCVT_LU_H();
+                             default:      return HINT();
+                             }
+                             break;
+               case 0b11010: switch (rs2)
+                             {
+                             case 0b00000: return FCVT_H_W();
+                             case 0b00001: return FCVT_H_WU();
+                             case 0b00010: return FCVT_H_L();
+                             case 0b00011: return FCVT_H_LU();
+                             default:      return HINT();
+                             }
+                             break;
+               case 0b11100: switch (funct3)
+                             {
+                             case 0b000: return FMV_X_H();
+                             case 0b001: return FCLASS_H();
+                             default:    return HINT();
+                             }
+                             break;
+               case 0b11110: switch (funct3)
+                             {
+                             case 0b000: return FMV_H_X();
+                             default:    return HINT();
+                             }
+                             break;
+               }
+               break;
+#else
     case 0b10: return HINT();
+#endif
     case 0b11: return HINT();
     }
 }
 //------------------------------------------------------------------------------
-void riscv_cpu::BRANCH()
+void riscv_cpu::OP_V()
 {
     switch (funct3)
     {
-    case 0b000: return BEQ();
-    case 0b001: return BNE();
-    case 0b010: return HINT();
-    case 0b011: return HINT();
-    case 0b100: return BLT();
-    case 0b101: return BGE();
-    case 0b110: return BLTU();
-    case 0b111: return BGEU();
+#if RISCV_HAVE_VECTOR
+    case 0b000: return OPIVV();
+    case 0b001: return OPFVV();
+    case 0b010: return OPMVV();
+    case 0b011: return OPIVI();
+    case 0b100: return OPIVX();
+    case 0b101: return OPFVF();
+    case 0b110: return OPMVX();
+    case 0b111: switch (funct7 >> 5)
+                {
+                case 0b00:
+                case 0b01: return VSETVLI();
+                case 0b10: return VSETVL();
+                case 0b11: return VSETIVLI();
+                }
+                break;
+#else
+    default:    return HINT();
+#endif
     }
 }
 //------------------------------------------------------------------------------
+void riscv_cpu::BRANCH()
+{
+    (this->*select<0b11000>(*this))();
+}
+//------------------------------------------------------------------------------
 void riscv_cpu::SYSTEM()
 {
-    switch (funct3)
-    {
-    case 0b000: switch (immI())
-                {
-                case 0b000000000000: return ECALL();
-                case 0b000000000001: return EBREAK();
-                default:             return HINT();
-                }
-    case 0b001: return CSRRW();
-    case 0b010: return CSRRS();
-    case 0b011: return CSRRC();
-    case 0b100: return HINT();
-    case 0b101: return CSRRWI();
-    case 0b110: return CSRRSI();
-    case 0b111: return CSRRCI();
-    }
+    (this->*select<0b11100>(*this))();
 }
 //------------------------------------------------------------------------------
@@ -10,6 +10,11 @@
 #include <stddef.h>
 #include "riscv_instruction.h"
 
+struct riscv_aot;
+struct riscv_plugin;
+struct riscv_predecode;
+struct riscv_simd;
+
 struct riscv_cpu : public riscv_instruction
 {
     riscv_cpu();
@@ -20,18 +25,44 @@ struct riscv_cpu : public riscv_instruction
     bool issue();
     bool run();
     bool runOnce();
+    bool run(const riscv_predecode& predecode);
+
+    static uint16_t decode(uint32_t format);
+
+    size_t access(uintptr_t& address, bool& store) const;
 
 public:
     uintptr_t* stack;
     uintptr_t reservation;
     register_t x[32];
     uintptr_t pc;
+    size_t length;
 
     register_t f[32];
     register_t fcsr;
+
+    // The host exception flags accumulate fflags until ftestexcept folds them,
+    // run() does both ends itself, a caller of issue() brackets its own loop
     void fclearexcept();
     void ftestexcept();
 
+    // The host rounding mode follows the guest and is only written on a change.
+    // Host code always runs rounding to nearest, after run(), around callbacks
+    // and after a loop of issue() which ends with fsetround(0b000), so the
+    // cached mode holds while several cpus share a thread.
+    void fsetround(int rm);
+    int frounding;
+
+#if RISCV_HAVE_VECTOR
+    enum { VLENB = RISCV_VLEN / 8 };
+    alignas(32) uint8_t v[32][VLENB];
+    uintptr_t vl;
+    uintptr_t vtype;
+    uint8_t vxrm;
+    uint8_t vxsat;
+    const riscv_simd* simd;
+#endif
+
     uintptr_t begin;
     uintptr_t end;
 
@@ -39,10 +70,50 @@ public:
     void (*environmentCall)(riscv_cpu& cpu);
     void (*environmentBreakpoint)(riscv_cpu& cpu);
 
+    // Instrumentation
+    bool attach(riscv_plugin* plugin);
+    void detach(riscv_plugin* plugin);
+
+    // Memory Footprint
+    struct footprint_t
+    {
+        size_t registers;
+        size_t stack;
+        size_t guest;
+        size_t plugin;
+        size_t cache;
+
+        size_t total() const
+        {
+            return registers + stack + guest + plugin + cache;
+        }
+    };
+    footprint_t footprint() const;
+
+    // Decode and translation caches the instance runs from, a cache shared by
+    // several instances counts for each of them
+    footprint_t footprint(const riscv_predecode* predecode, const riscv_aot* aot = nullptr) const;
+
 protected:
     typedef void instruction();
     typedef void (riscv_cpu::*instruction_pointer)();
 
+    enum { STACK_SIZE = 65536 };
+    bool stackMapped;
+    enum { MAX_PLUGIN = 8 };
+    riscv_plugin* plugins[MAX_PLUGIN];
+    size_t pluginCount;
+    int pluginHooks;
+
+    template <bool instrumented> bool step();
+    template <bool instrumented, bool once> bool loop();
+
+    // Floating-point rounding mode of the instruction, frm when rm is dynamic
+    int rounding() const;
+    void fsetround();
+    int64_t fcvt(double value, int width);
+    uint64_t fcvtu(double value, int width);
+
     // RV32I Base Instruction Set
     instruction LUI;
     instruction AUIPC;
@@ -109,6 +180,8 @@ protected:
     instruction CSRRWI;
     instruction CSRRSI;
     instruction CSRRCI;
+    bool csrread(int csr, uintptr_t& value);
+    void csrwrite(int csr, uintptr_t value);
 
     // RV32M Standard Extension
     instruction MUL;
@@ -223,6 +296,141 @@ protected:
     instruction FCVT_D_LU;
     instruction FMV_D_X;
 
+    // RV32/RV64 Zfh Standard Extension
+    instruction FLH;
+    instruction FSH;
+    instruction FMADD_H;
+    instruction FMSUB_H;
+    instruction FNMSUB_H;
+    instruction FNMADD_H;
+    instruction FADD_H;
+    instruction FSUB_H;
+    instruction FMUL_H;
+    instruction FDIV_H;
+    instruction FSQRT_H;
+    instruction FSGNJ_H;
+    instruction FSGNJN_H;
+    instruction FSGNJX_H;
+    instruction FMIN_H;
+    instruction FMAX_H;
+    instruction FCVT_S_H;
+    instruction FCVT_H_S;
+    instruction FCVT_D_H;
+    instruction FCVT_H_D;
+    instruction FEQ_H;
+    instruction FLT_H;
+    instruction FLE_H;
+    instruction FCLASS_H;
+    instruction FCVT_W_H;
+    instruction FCVT_WU_H;
+    instruction FCVT_H_W;
+    instruction FCVT_H_WU;
+    instruction FMV_X_H;
+    instruction FMV_H_X;
+
+    // RV64 Zfh Standard Extension
+    instruction FCVT_L_H;
+    instruction FCVT_LU_H;
+    instruction FCVT_H_L;
+    instruction FCVT_H_LU;
+
+    // RV32/RV64 Zba Standard Extension
+    instruction SH1ADD;
+    instruction SH2ADD;
+    instruction SH3ADD;
+
+    // RV64 Zba Standard Extension
+    instruction ADD_UW;
+    instruction SH1ADD_UW;
+    instruction SH2ADD_UW;
+    instruction SH3ADD_UW;
+    instruction SLLI_UW;
+
+    // RV32/RV64 Zbb Standard Extension
+    instruction ANDN;
+    instruction ORN;
+    instruction XNOR;
+    instruction CLZ;
+    instruction CTZ;
+    instruction CPOP;
+    instruction MAX;
+    instruction MAXU;
+    instruction MIN;
+    instruction MINU;
+    instruction SEXT_B;
+    instruction SEXT_H;
+    instruction ZEXT_H;
+    instruction ROL;
+    instruction ROR;
+    instruction RORI;
+    instruction ORC_B;
+    instruction REV8;
+
+    // RV64 Zbb Standard Extension
+    instruction CLZW;
+    instruction CTZW;
+    instruction CPOPW;
+    instruction ROLW;
+    instruction RORW;
+    instruction RORIW;
+
+    // RV32/RV64 Zbc Standard Extension
+    instruction CLMUL;
+    instruction CLMULH;
+    instruction CLMULR;
+
+    // RV32/RV64 Zbs Standard Extension
+    instruction BCLR;
+    instruction BCLRI;
+    instruction BEXT;
+    instruction BEXTI;
+    instruction BINV;
+    instruction BINVI;
+    instruction BSET;
+    instruction BSETI;
+
+    // RV64 Zkne/Zknd Standard Extension
+    instruction AES64ES;
+    instruction AES64ESM;
+    instruction AES64DS;
+    instruction AES64DSM;
+    instruction AES64IM;
+    instruction AES64KS1I;
+    instruction AES64KS2;
+
+    // RV32/RV64 Zknh Standard Extension
+    instruction SHA256SIG0;
+    instruction SHA256SIG1;
+    instruction SHA256SUM0;
+    instruction SHA256SUM1;
+
+    // RV64 Zknh Standard Extension
+    instruction SHA512SIG0;
+    instruction SHA512SIG1;
+    instruction SHA512SUM0;
+    instruction SHA512SUM1;
+
+    // RVV 1.0 Vector Extension
+    instruction VSETVLI;
+    instruction VSETIVLI;
+    instruction VSETVL;
+    instruction VLOAD;
+    instruction VSTORE;
+    instruction OPIVV;
+    instruction OPFVV;
+    instruction OPMVV;
+    instruction OPIVI;
+    instruction OPIVX;
+    instruction OPFVF;
+    instruction OPMVX;
+    size_t vaccess(uintptr_t& address) const;
+    void vset(uintptr_t avl, uintptr_t type);
+    void vmemory(bool store);
+    void vwrite(const uint8_t* result);
+    void vopi(const uint8_t* b, uintptr_t scalar);
+    void vopm(const uint8_t* b);
+    void vopf(const uint8_t* b);
+
     // Opcode
     instruction HINT;
     instruction LOAD;
@@ -240,9 +448,58 @@ protected:
     instruction NMSUB;
     instruction NMADD;
     instruction OP_FP;
+    instruction OP_V;
     instruction BRANCH;
     instruction SYSTEM;
 
     // Opcode map
     static const instruction_pointer map32[8 * 4];
+
+    // Pre-decoded handlers, the integer opcodes above dispatch through the
+    // same select<opcode>() the decoder uses
+    template <int opcode> static instruction_pointer select(const riscv_instruction& i);
+    static instruction_pointer select(uint32_t format);
+    static const instruction_pointer handlers[];
+    static const size_t handlerCount;
 };
+//------------------------------------------------------------------------------
+inline int riscv_cpu::rounding() const
+{
+    return (funct3 == 0b111) ? fcsr.frm : funct3;
+}
+//------------------------------------------------------------------------------
+inline void riscv_cpu::fsetround()
+{
+    int rm = rounding();
+    if (rm != frounding)
+        fsetround(rm);
+}
+//------------------------------------------------------------------------------
+inline size_t riscv_cpu::access(uintptr_t& address, bool& store) const
+{
+    switch (opcode)
+    {
+    case 0b0000011:
+    case 0b0000111:
+        address = x[rs1].u + simmI();
+        store = false;
+        break;
+    case 0b0100011:
+    case 0b0100111:
+        address = x[rs1].u + simmS();
+        store = true;
+        break;
+    case 0b0101111:
+        address = x[rs1].u;
+        store = (funct5 != 0b00010);
+        break;
+    default:
+        return 0;
+    }
+#if RISCV_HAVE_VECTOR
+    if ((opcode & 0b1011111) == 0b0000111 && (funct3 == 0b000 || funct3 >= 0b101))
+        return vaccess(address);
+#endif
+    return size_t(1) << (funct3 & 0b11);
+}
+//------------------------------------------------------------------------------
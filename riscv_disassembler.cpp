@@ -0,0 +1,631 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <stdio.h>
+#include "riscv_disassembler.h"
+
+//------------------------------------------------------------------------------
+// Chapter 25: RISC-V Assembly Programmer's Handbook
+//------------------------------------------------------------------------------
+static const char* const xname[32] =
+{
+    "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2",
+    "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+    "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7",
+    "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6",
+};
+static const char* const fname[32] =
+{
+    "ft0", "ft1", "ft2", "ft3", "ft4", "ft5", "ft6", "ft7",
+    "fs0", "fs1", "fa0", "fa1", "fa2", "fa3", "fa4", "fa5",
+    "fa6", "fa7", "fs2", "fs3", "fs4", "fs5", "fs6", "fs7",
+    "fs8", "fs9", "fs10", "fs11", "ft8", "ft9", "ft10", "ft11",
+};
+static const char* const vname[32] =
+{
+    "v0", "v1", "v2", "v3", "v4", "v5", "v6", "v7",
+    "v8", "v9", "v10", "v11", "v12", "v13", "v14", "v15",
+    "v16", "v17", "v18", "v19", "v20", "v21", "v22", "v23",
+    "v24", "v25", "v26", "v27", "v28", "v29", "v30", "v31",
+};
+static const char* const fmtname[4] = { "s", "d", "h", "q" };
+static const char* const intname[4] = { "w", "wu", "l", "lu" };
+//------------------------------------------------------------------------------
+// Chapter 6: Configuration-Setting Instructions, "V" Extension Version 1.0
+//------------------------------------------------------------------------------
+static int vtypename(char* text, size_t size, unsigned int vtype)
+{
+    static const char* const lmul[8] = { "m1", "m2", "m4", "m8", nullptr, "mf8", "mf4", "mf2" };
+    if ((vtype >> 8) || (vtype & 0b100000) || lmul[vtype & 0b111] == nullptr)
+        return snprintf(text, size, "%u", vtype);
+    return snprintf(text, size, "e%u, %s, %s, %s", 8u << ((vtype >> 3) & 0b11), lmul[vtype & 0b111],
+                    (vtype & 0b1000000) ? "ta" : "tu", (vtype & 0b10000000) ? "ma" : "mu");
+}
+//------------------------------------------------------------------------------
+size_t riscv_disassembler::disassemble(char* text, size_t size, uintptr_t pc, uint32_t format)
+{
+    // Compressed instructions are shown as the instruction they expand to,
+    // reserved encodings expand to custom-0 and stay a .half
+    riscv_disassembler disassembler;
+    disassembler.format = format;
+    if ((format & 0b11) != 0b11 && expand(format) != 0b0001011)
+        disassembler.format = expand(format);
+    return disassembler.print(text, size, pc);
+}
+//------------------------------------------------------------------------------
+size_t riscv_disassembler::print(char* text, size_t size, uintptr_t pc) const
+{
+    const char* name = nullptr;
+    int length = 0;
+
+    switch (opcode)
+    {
+    case 0b0110111:
+        length = snprintf(text, size, "lui %s, 0x%x", xname[rd], immU() >> 12);
+        break;
+    case 0b0010111:
+        length = snprintf(text, size, "auipc %s, 0x%x", xname[rd], immU() >> 12);
+        break;
+    case 0b1101111:
+        length = snprintf(text, size, "jal %s, 0x%llx", xname[rd], (unsigned long long)(pc + simmJ()));
+        break;
+    case 0b1100111:
+        length = snprintf(text, size, "jalr %s, %d(%s)", xname[rd], simmI(), xname[rs1]);
+        break;
+    case 0b1100011:
+    {
+        static const char* const names[8] = { "beq", "bne", nullptr, nullptr, "blt", "bge", "bltu", "bgeu" };
+        if ((name = names[funct3]) == nullptr)
+            break;
+        length = snprintf(text, size, "%s %s, %s, 0x%llx", name, xname[rs1], xname[rs2], (unsigned long long)(pc + simmB()));
+        break;
+    }
+    case 0b0000011:
+    {
+        static const char* const names[8] = { "lb", "lh", "lw", "ld", "lbu", "lhu", "lwu", nullptr };
+        if ((name = names[funct3]) == nullptr)
+            break;
+        length = snprintf(text, size, "%s %s, %d(%s)", name, xname[rd], simmI(), xname[rs1]);
+        break;
+    }
+    case 0b0100011:
+    {
+        static const char* const names[8] = { "sb", "sh", "sw", "sd", nullptr, nullptr, nullptr, nullptr };
+        if ((name = names[funct3]) == nullptr)
+            break;
+        length = snprintf(text, size, "%s %s, %d(%s)", name, xname[rs2], simmS(), xname[rs1]);
+        break;
+    }
+    case 0b0000111:
+    {
+        static const char* const names[8] = { nullptr, "flh", "flw", "fld", nullptr, nullptr, nullptr, nullptr };
+        if (funct3 == 0b000 || funct3 >= 0b101)
+        {
+            length = vmemory(text, size, "l");
+            break;
+        }
+        if ((name = names[funct3]) == nullptr)
+            break;
+        length = snprintf(text, size, "%s %s, %d(%s)", name, fname[rd], simmI(), xname[rs1]);
+        break;
+    }
+    case 0b0100111:
+    {
+        static const char* const names[8] = { nullptr, "fsh", "fsw", "fsd", nullptr, nullptr, nullptr, nullptr };
+        if (funct3 == 0b000 || funct3 >= 0b101)
+        {
+            length = vmemory(text, size, "s");
+            break;
+        }
+        if ((name = names[funct3]) == nullptr)
+            break;
+        length = snprintf(text, size, "%s %s, %d(%s)", name, fname[rs2], simmS(), xname[rs1]);
+        break;
+    }
+    case 0b0010011:
+    {
+        static const char* const names[8] = { "addi", "slli", "slti", "sltiu", "xori", "srli", "ori", "andi" };
+        name = names[funct3];
+        if (funct3 == 0b001 || funct3 == 0b101)
+        {
+            switch (funct3 << 12 | immI())
+            {
+            case 0b001011000000000: name = "clz";             break;
+            case 0b001011000000001: name = "ctz";             break;
+            case 0b001011000000010: name = "cpop";            break;
+            case 0b001011000000100: name = "sext.b";          break;
+            case 0b001011000000101: name = "sext.h";          break;
+            case 0b001000100000000: name = "sha256sum0";      break;
+            case 0b001000100000001: name = "sha256sum1";      break;
+            case 0b001000100000010: name = "sha256sig0";      break;
+            case 0b001000100000011: name = "sha256sig1";      break;
+            case 0b001000100000100: name = "sha512sum0";      break;
+            case 0b001000100000101: name = "sha512sum1";      break;
+            case 0b001000100000110: name = "sha512sig0";      break;
+            case 0b001000100000111: name = "sha512sig1";      break;
+            case 0b001001100000000: name = "aes64im";         break;
+            case 0b101001010000111: name = "orc.b";           break;
+            case 0b101011010111000: name = "rev8";            break;
+            default:                name = nullptr;           break;
+            }
+            if (name)
+            {
+                length = snprintf(text, size, "%s %s, %s", name, xname[rd], xname[rs1]);
+                break;
+            }
+            if (funct3 == 0b001 && (immI() >> 4) == 0b00110001 && (immI() & 0xF) <= 0xA)
+            {
+                length = snprintf(text, size, "aes64ks1i %s, %s, %d", xname[rd], xname[rs1], immI() & 0xF);
+                break;
+            }
+            switch (funct3 << 6 | immI() >> 6)
+            {
+            case 0b001000000: name = "slli";    break;
+            case 0b001001010: name = "bseti";   break;
+            case 0b001010010: name = "bclri";   break;
+            case 0b001011010: name = "binvi";   break;
+            case 0b101000000: name = "srli";    break;
+            case 0b101010000: name = "srai";    break;
+            case 0b101010010: name = "bexti";   break;
+            case 0b101011000: name = "rori";    break;
+            }
+            if (name == nullptr)
+                break;
+            length = snprintf(text, size, "%s %s, %s, %d", name, xname[rd], xname[rs1], immI() & 0x3F);
+            break;
+        }
+        length = snprintf(text, size, "%s %s, %s, %d", name, xname[rd], xname[rs1], simmI());
+        break;
+    }
+    case 0b0011011:
+    {
+        static const char* const names[8] = { "addiw", "slliw", nullptr, nullptr, nullptr, "srliw", nullptr, nullptr };
+        if ((name = names[funct3]) == nullptr)
+            break;
+        if (funct3 == 0b001 || funct3 == 0b101)
+        {
+            switch (funct3 << 12 | immI())
+            {
+            case 0b001011000000000: name = "clzw";      break;
+            case 0b001011000000001: name = "ctzw";      break;
+            case 0b001011000000010: name = "cpopw";     break;
+            default:                name = nullptr;     break;
+            }
+            if (name)
+            {
+                length = snprintf(text, size, "%s %s, %s", name, xname[rd], xname[rs1]);
+                break;
+            }
+            switch (funct3 << 7 | funct7)
+            {
+            case 0b0010000000: name = "slliw";      break;
+            case 0b0010000100:
+            case 0b0010000101: name = "slli.uw";    break;
+            case 0b1010000000: name = "srliw";      break;
+            case 0b1010100000: name = "sraiw";      break;
+            case 0b1010110000: name = "roriw";      break;
+            }
+            if (name == nullptr)
+                break;
+            int shamt = (funct7 >> 1) == 0b000010 ? immI() & 0x3F : immI() & 0x1F;
+            length = snprintf(text, size, "%s %s, %s, %d", name, xname[rd], xname[rs1], shamt);
+            break;
+        }
+        length = snprintf(text, size, "%s %s, %s, %d", name, xname[rd], xname[rs1], simmI());
+        break;
+    }
+    case 0b0110011:
+    {
+        static const char* const base[8] = { "add", "sll", "slt", "sltu", "xor", "srl", "or", "and" };
+        static const char* const muldiv[8] = { "mul", "mulh", "mulhsu", "mulhu", "div", "divu", "rem", "remu" };
+        static const char* const alt[8] = { "sub", nullptr, nullptr, nullptr, "xnor", "sra", "orn", "andn" };
+        static const char* const minmax[8] = { nullptr, "clmul", "clmulr", "clmulh", "min", "minu", "max", "maxu" };
+        static const char* const shadd[8] = { nullptr, nullptr, "sh1add", nullptr, "sh2add", nullptr, "sh3add", nullptr };
+        static const char* const bset[8] = { nullptr, "bset", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
+        static const char* const bclr[8] = { nullptr, "bclr", nullptr, nullptr, nullptr, "bext", nullptr, nullptr };
+        static const char* const rotate[8] = { nullptr, "rol", nullptr, nullptr, nullptr, "ror", nullptr, nullptr };
+        static const char* const binv[8] = { nullptr, "binv", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
+        static const char* const aes[4] = { "aes64es", "aes64esm", "aes64ds", "aes64dsm" };
+        switch (funct7)
+        {
+        case 0b0011001:
+        case 0b0011011:
+        case 0b0011101:
+        case 0b0011111: name = funct3 ? nullptr : aes[(funct7 >> 1) & 0b11];   break;
+        case 0b0111111: name = funct3 ? nullptr : "aes64ks2";                  break;
+        case 0b0000000: name = base[funct3];    break;
+        case 0b0000001: name = muldiv[funct3];  break;
+        case 0b0000101: name = minmax[funct3];  break;
+        case 0b0010000: name = shadd[funct3];   break;
+        case 0b0010100: name = bset[funct3];    break;
+        case 0b0100000: name = alt[funct3];     break;
+        case 0b0100100: name = bclr[funct3];    break;
+        case 0b0110000: name = rotate[funct3];  break;
+        case 0b0110100: name = binv[funct3];    break;
+        }
+        if (name == nullptr)
+            break;
+        length = snprintf(text, size, "%s %s, %s, %s", name, xname[rd], xname[rs1], xname[rs2]);
+        break;
+    }
+    case 0b0111011:
+    {
+        static const char* const base[8] = { "addw", "sllw", nullptr, nullptr, nullptr, "srlw", nullptr, nullptr };
+        static const char* const muldiv[8] = { "mulw", nullptr, nullptr, nullptr, "divw", "divuw", "remw", "remuw" };
+        static const char* const alt[8] = { "subw", nullptr, nullptr, nullptr, nullptr, "sraw", nullptr, nullptr };
+        static const char* const uw[8] = { "add.uw", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
+        static const char* const shadd[8] = { nullptr, nullptr, "sh1add.uw", nullptr, "sh2add.uw", nullptr, "sh3add.uw", nullptr };
+        static const char* const rotate[8] = { nullptr, "rolw", nullptr, nullptr, nullptr, "rorw", nullptr, nullptr };
+        switch (funct7)
+        {
+        case 0b0000000: name = base[funct3];    break;
+        case 0b0000001: name = muldiv[funct3];  break;
+        case 0b0000100: name = uw[funct3];      break;
+        case 0b0010000: name = shadd[funct3];   break;
+        case 0b0100000: name = alt[funct3];     break;
+        case 0b0110000: name = rotate[funct3];  break;
+        }
+        if (funct7 == 0b0000100 && funct3 == 0b100 && rs2 == 0)
+        {
+            length = snprintf(text, size, "zext.h %s, %s", xname[rd], xname[rs1]);
+            break;
+        }
+        if (name == nullptr)
+            break;
+        length = snprintf(text, size, "%s %s, %s, %s", name, xname[rd], xname[rs1], xname[rs2]);
+        break;
+    }
+    case 0b0001111:
+        switch (funct3)
+        {
+        case 0b000: length = snprintf(text, size, "fence");     break;
+        case 0b001: length = snprintf(text, size, "fence.i");   break;
+        }
+        break;
+    case 0b1110011:
+    {
+        static const char* const names[8] = { nullptr, "csrrw", "csrrs", "csrrc", nullptr, "csrrwi", "csrrsi", "csrrci" };
+        if (funct3 == 0b000)
+        {
+            switch (immI())
+            {
+            case 0b000000000000: length = snprintf(text, size, "ecall");    break;
+            case 0b000000000001: length = snprintf(text, size, "ebreak");   break;
+            }
+            break;
+        }
+        if ((name = names[funct3]) == nullptr)
+            break;
+        if (funct3 & 0b100)
+        {
+            length = snprintf(text, size, "%s %s, 0x%03x, %d", name, xname[rd], immI(), rs1);
+            break;
+        }
+        length = snprintf(text, size, "%s %s, 0x%03x, %s", name, xname[rd], immI(), xname[rs1]);
+        break;
+    }
+    case 0b0101111:
+    {
+        static const char* const names[32] =
+        {
+            "amoadd", "amoswap", "lr", "sc", "amoxor", nullptr, nullptr, nullptr,
+            "amoor", nullptr, nullptr, nullptr, "amoand", nullptr, nullptr, nullptr,
+            "amomin", nullptr, nullptr, nullptr, "amomax", nullptr, nullptr, nullptr,
+            "amominu", nullptr, nullptr, nullptr, "amomaxu", nullptr, nullptr, nullptr,
+        };
+        if ((name = names[funct5]) == nullptr || (funct3 != 0b010 && funct3 != 0b011))
+            break;
+        const char* width = (funct3 == 0b010) ? "w" : "d";
+        if (funct5 == 0b00010)
+        {
+            length = snprintf(text, size, "%s.%s %s, (%s)", name, width, xname[rd], xname[rs1]);
+            break;
+        }
+        length = snprintf(text, size, "%s.%s %s, %s, (%s)", name, width, xname[rd], xname[rs2], xname[rs1]);
+        break;
+    }
+    case 0b1000011:
+    case 0b1000111:
+    case 0b1001011:
+    case 0b1001111:
+    {
+        static const char* const names[4] = { "fmadd", "fmsub", "fnmsub", "fnmadd" };
+        name = names[(opcode >> 2) & 0b11];
+        length = snprintf(text, size, "%s.%s %s, %s, %s, %s", name, fmtname[fmt], fname[rd], fname[rs1], fname[rs2], fname[rs3]);
+        break;
+    }
+    case 0b1010011:
+    {
+        static const char* const arithmetic[4] = { "fadd", "fsub", "fmul", "fdiv" };
+        static const char* const sign[4] = { "fsgnj", "fsgnjn", "fsgnjx", nullptr };
+        static const char* const minmax[4] = { "fmin", "fmax", nullptr, nullptr };
+        static const char* const compare[4] = { "fle", "flt", "feq", nullptr };
+        const char* type = fmtname[fmt];
+        switch (funct5)
+        {
+        case 0b00000:
+        case 0b00001:
+        case 0b00010:
+        case 0b00011:
+            length = snprintf(text, size, "%s.%s %s, %s, %s", arithmetic[funct5], type, fname[rd], fname[rs1], fname[rs2]);
+            break;
+        case 0b00100:
+        case 0b00101:
+            if (funct3 > 0b011 || (name = (funct5 == 0b00100 ? sign : minmax)[funct3]) == nullptr)
+                break;
+            length = snprintf(text, size, "%s.%s %s, %s, %s", name, type, fname[rd], fname[rs1], fname[rs2]);
+            break;
+        case 0b01000:
+            length = snprintf(text, size, "fcvt.%s.%s %s, %s", type, fmtname[rs2 & 0b11], fname[rd], fname[rs1]);
+            break;
+        case 0b01011:
+            length = snprintf(text, size, "fsqrt.%s %s, %s", type, fname[rd], fname[rs1]);
+            break;
+        case 0b10100:
+            if (funct3 > 0b011 || (name = compare[funct3]) == nullptr)
+                break;
+            length = snprintf(text, size, "%s.%s %s, %s, %s", name, type, xname[rd], fname[rs1], fname[rs2]);
+            break;
+        case 0b11000:
+            if (rs2 > 0b00011)
+                break;
+            length = snprintf(text, size, "fcvt.%s.%s %s, %s", intname[rs2], type, xname[rd], fname[rs1]);
+            break;
+        case 0b11010:
+            if (rs2 > 0b00011)
+                break;
+            length = snprintf(text, size, "fcvt.%s.%s %s, %s", type, intname[rs2], fname[rd], xname[rs1]);
+            break;
+        case 0b11100:
+            switch (funct3)
+            {
+            case 0b000: length = snprintf(text, size, "fmv.x.%s %s, %s", fmt ? type : "w", xname[rd], fname[rs1]);  break;
+            case 0b001: length = snprintf(text, size, "fclass.%s %s, %s", type, xname[rd], fname[rs1]);             break;
+            }
+            break;
+        case 0b11110:
+            if (funct3 != 0b000)
+                break;
+            length = snprintf(text, size, "fmv.%s.x %s, %s", fmt ? type : "w", fname[rd], xname[rs1]);
+            break;
+        }
+        break;
+    }
+    case 0b1010111:
+        length = varithmetic(text, size);
+        break;
+    }
+
+    if (length == 0)
+    {
+        if ((opcode & 0b11) != 0b11)
+            length = snprintf(text, size, ".half 0x%04x", format & 0xFFFF);
+        else
+            length = snprintf(text, size, ".word 0x%08x", format);
+    }
+
+    return length;
+}
+//------------------------------------------------------------------------------
+int riscv_disassembler::vmemory(char* text, size_t size, const char* direction) const
+{
+    static const char* const width[8] = { "8", nullptr, nullptr, nullptr, nullptr, "16", "32", "64" };
+    const char* eew = width[funct3];
+    const char* mask = vm ? "" : ", v0.t";
+    bool load = direction[0] == 'l';
+    char segment[8] = "";
+    if (nf)
+        snprintf(segment, sizeof(segment), "seg%d", nf + 1);
+    if (mew)
+        return 0;
+
+    switch (mop)
+    {
+    case 0b00:
+        switch (rs2)
+        {
+        case 0b00000:
+            return snprintf(text, size, "v%s%se%s.v %s, (%s)%s", direction, segment, eew, vname[rd], xname[rs1], mask);
+        case 0b01000:
+            if (vm == 0 || (nf & (nf + 1)) || (load == false && funct3 != 0b000))
+                break;
+            if (load)
+                return snprintf(text, size, "vl%dre%s.v %s, (%s)", nf + 1, eew, vname[rd], xname[rs1]);
+            return snprintf(text, size, "vs%dr.v %s, (%s)", nf + 1, vname[rd], xname[rs1]);
+        case 0b01011:
+            if (vm == 0 || nf || funct3 != 0b000)
+                break;
+            return snprintf(text, size, "v%sm.v %s, (%s)", direction, vname[rd], xname[rs1]);
+        case 0b10000:
+            if (load == false)
+                break;
+            return snprintf(text, size, "vl%se%sff.v %s, (%s)%s", segment, eew, vname[rd], xname[rs1], mask);
+        }
+        break;
+    case 0b10:
+        return snprintf(text, size, "v%ss%se%s.v %s, (%s), %s%s", direction, segment, eew, vname[rd], xname[rs1], xname[rs2], mask);
+    case 0b01:
+    case 0b11:
+        return snprintf(text, size, "v%s%cx%sei%s.v %s, (%s), %s%s", direction, mop == 0b01 ? 'u' : 'o', segment, eew, vname[rd], xname[rs1], vname[rs2], mask);
+    }
+    return 0;
+}
+//------------------------------------------------------------------------------
+int riscv_disassembler::varithmetic(char* text, size_t size) const
+{
+    static const char* const opi[64] =
+    {
+        "vadd", nullptr, "vsub", "vrsub", "vminu", "vmin", "vmaxu", "vmax",
+        nullptr, "vand", "vor", "vxor", "vrgather", nullptr, "vslideup", "vslidedown",
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+        "vmseq", "vmsne", "vmsltu", "vmslt", "vmsleu", "vmsle", "vmsgtu", "vmsgt",
+        nullptr, nullptr, nullptr, nullptr, nullptr, "vsll", nullptr, nullptr,
+        "vsrl", "vsra", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+    };
+    static const char* const opm[64] =
+    {
+        "vredsum", "vredand", "vredor", "vredxor", "vredminu", "vredmin", "vredmaxu", "vredmax",
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "vslide1up", "vslide1down",
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+        "vmandn", "vmand", "vmor", "vmxor", "vmorn", "vmnand", "vmnor", "vmxnor",
+        "vdivu", "vdiv", "vremu", "vrem", "vmulhu", "vmul", "vmulhsu", "vmulh",
+        nullptr, "vmadd", nullptr, "vnmsub", nullptr, "vmacc", nullptr, "vnmsac",
+    };
+    static const char* const opf[64] =
+    {
+        "vfadd", "vfredusum", "vfsub", "vfredosum", "vfmin", "vfredmin", "vfmax", "vfredmax",
+        "vfsgnj", "vfsgnjn", "vfsgnjx", nullptr, nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+        "vmfeq", "vmfle", nullptr, "vmflt", "vmfne", "vmfgt", nullptr, "vmfge",
+        "vfdiv", "vfrdiv", nullptr, nullptr, "vfmul", nullptr, nullptr, "vfrsub",
+        "vfmadd", "vfnmadd", "vfmsub", "vfnmsub", "vfmacc", "vfnmacc", "vfmsac", "vfnmsac",
+    };
+    static const char* const extension[8] = { nullptr, nullptr, "vzext.vf8", "vsext.vf8", "vzext.vf4", "vsext.vf4", "vzext.vf2", "vsext.vf2" };
+    static const char* const convert[8] = { "vfcvt.xu.f.v", "vfcvt.x.f.v", "vfcvt.f.xu.v", "vfcvt.f.x.v", nullptr, nullptr, "vfcvt.rtz.xu.f.v", "vfcvt.rtz.x.f.v" };
+    static const char* const suffix[8] = { "vv", "vv", "vv", "vi", "vx", "vf", "vx", nullptr };
+    const char* mask = vm ? "" : ", v0.t";
+    const char* name = nullptr;
+    char source[32];
+
+    switch (funct3)
+    {
+    case 0b000:
+    case 0b001:
+    case 0b010:
+        snprintf(source, sizeof(source), "%s", vname[rs1]);
+        break;
+    case 0b011:
+        switch (funct6)
+        {
+        case 0b001100:
+        case 0b001110:
+        case 0b001111:
+        case 0b100101:
+        case 0b100111:
+        case 0b101000:
+        case 0b101001:
+            snprintf(source, sizeof(source), "%d", rs1);
+            break;
+        default:
+            snprintf(source, sizeof(source), "%d", int32_t(rs1 << 27) >> 27);
+            break;
+        }
+        break;
+    case 0b100:
+    case 0b110:
+        snprintf(source, sizeof(source), "%s", xname[rs1]);
+        break;
+    case 0b101:
+        snprintf(source, sizeof(source), "%s", fname[rs1]);
+        break;
+    case 0b111:
+    {
+        char type[64];
+        if ((funct7 >> 6) == 0b0)
+        {
+            vtypename(type, sizeof(type), immI() & 0x7FF);
+            return snprintf(text, size, "vsetvli %s, %s, %s", xname[rd], xname[rs1], type);
+        }
+        if ((funct7 >> 5) == 0b11)
+        {
+            vtypename(type, sizeof(type), immI() & 0x3FF);
+            return snprintf(text, size, "vsetivli %s, %d, %s", xname[rd], rs1, type);
+        }
+        if (funct7 == 0b1000000)
+            return snprintf(text, size, "vsetvl %s, %s, %s", xname[rd], xname[rs1], xname[rs2]);
+        return 0;
+    }
+    }
+
+    // Moves, merges and unary operations
+    switch (funct3 << 6 | funct6)
+    {
+    case 0b000010111:
+    case 0b011010111:
+    case 0b100010111:
+        if (vm)
+            return snprintf(text, size, "vmv.v.%c %s, %s", suffix[funct3][1], vname[rd], source);
+        return snprintf(text, size, "vmerge.%sm %s, %s, %s, v0", suffix[funct3], vname[rd], vname[rs2], source);
+    case 0b011100111:
+        return snprintf(text, size, "vmv%dr.v %s, %s", rs1 + 1, vname[rd], vname[rs2]);
+    case 0b010010000:
+        switch (rs1)
+        {
+        case 0b00000: return snprintf(text, size, "vmv.x.s %s, %s", xname[rd], vname[rs2]);
+        case 0b10000: return snprintf(text, size, "vcpop.m %s, %s%s", xname[rd], vname[rs2], mask);
+        case 0b10001: return snprintf(text, size, "vfirst.m %s, %s%s", xname[rd], vname[rs2], mask);
+        }
+        return 0;
+    case 0b110010000:
+        return snprintf(text, size, "vmv.s.x %s, %s", vname[rd], xname[rs1]);
+    case 0b010010010:
+        if (rs1 > 0b00111 || (name = extension[rs1]) == nullptr)
+            return 0;
+        return snprintf(text, size, "%s %s, %s%s", name, vname[rd], vname[rs2], mask);
+    case 0b010010100:
+        switch (rs1)
+        {
+        case 0b00001: name = "vmsbf.m"; break;
+        case 0b00010: name = "vmsof.m"; break;
+        case 0b00011: name = "vmsif.m"; break;
+        case 0b10000: name = "viota.m"; break;
+        case 0b10001: return snprintf(text, size, "vid.v %s%s", vname[rd], mask);
+        default:      return 0;
+        }
+        return snprintf(text, size, "%s %s, %s%s", name, vname[rd], vname[rs2], mask);
+    case 0b001010000:
+        return snprintf(text, size, "vfmv.f.s %s, %s", fname[rd], vname[rs2]);
+    case 0b101010000:
+        return snprintf(text, size, "vfmv.s.f %s, %s", vname[rd], fname[rs1]);
+    case 0b001010010:
+        if (rs1 > 0b00111 || (name = convert[rs1]) == nullptr)
+            return 0;
+        return snprintf(text, size, "%s %s, %s%s", name, vname[rd], vname[rs2], mask);
+    case 0b001010011:
+        if (rs1 != 0b00000)
+            return 0;
+        return snprintf(text, size, "vfsqrt.v %s, %s%s", vname[rd], vname[rs2], mask);
+    case 0b101010111:
+        if (vm)
+            return snprintf(text, size, "vfmv.v.f %s, %s", vname[rd], source);
+        return snprintf(text, size, "vfmerge.vfm %s, %s, %s, v0", vname[rd], vname[rs2], source);
+    }
+
+    // Binary operations, multiply-adds take the accumulator as vd
+    const char* type = suffix[funct3];
+    bool accumulate = false;
+    switch (funct3)
+    {
+    case 0b000:
+    case 0b011:
+    case 0b100:
+        name = opi[funct6];
+        break;
+    case 0b010:
+    case 0b110:
+        name = opm[funct6];
+        accumulate = funct6 >= 0b101000;
+        if (funct6 < 0b001000)
+            type = "vs";
+        if (funct6 >= 0b011000 && funct6 < 0b100000)
+            type = "mm";
+        break;
+    case 0b001:
+    case 0b101:
+        name = opf[funct6];
+        accumulate = funct6 >= 0b101000;
+        if (funct6 < 0b001000 && (funct6 & 1))
+            type = "vs";
+        break;
+    }
+    if (name == nullptr)
+        return 0;
+    if (accumulate)
+        return snprintf(text, size, "%s.%s %s, %s, %s%s", name, type, vname[rd], source, vname[rs2], mask);
+    return snprintf(text, size, "%s.%s %s, %s, %s%s", name, type, vname[rd], vname[rs2], source, mask);
+}
+//------------------------------------------------------------------------------
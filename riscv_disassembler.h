@@ -0,0 +1,21 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include "riscv_instruction.h"
+
+struct riscv_disassembler : public riscv_instruction
+{
+    static size_t disassemble(char* text, size_t size, uintptr_t pc, uint32_t format);
+
+protected:
+    size_t print(char* text, size_t size, uintptr_t pc) const;
+    int vmemory(char* text, size_t size, const char* direction) const;
+    int varithmetic(char* text, size_t size) const;
+};
@@ -10,7 +10,13 @@
 #include <stdint.h>
 
 #define RISCV_HAVE_SINGLE   1
-#define RISCV_HAVE_DOUBLE   0
+#define RISCV_HAVE_DOUBLE   1
+#define RISCV_HAVE_HALF     1
+#define RISCV_HAVE_VECTOR   1
+
+#ifndef RISCV_VLEN
+#define RISCV_VLEN          256
+#endif
 
 struct riscv_instruction
 {
@@ -108,6 +114,23 @@ struct riscv_instruction
             uint32_t _f_dummy : 27;
             uint32_t funct5 : 5;
         };
+        // V - Type
+        // 31......26 25.. 24...20 19...15 14......12 11...7 6........0
+        // [ funct6 ] [vm] [ vs2 ] [ vs1 ] [ funct3 ] [ vd ] [ opcode ]
+        // [nf|mew|mop]
+        struct
+        {
+            uint32_t _v_dummy : 25;
+            uint32_t vm : 1;
+            uint32_t funct6 : 6;
+        };
+        struct
+        {
+            uint32_t _vv_dummy : 26;
+            uint32_t mop : 2;
+            uint32_t mew : 1;
+            uint32_t nf : 3;
+        };
     };
 
     uint32_t immI() const
@@ -160,6 +183,11 @@ struct riscv_instruction
         return (int32_t)immJ() << 11 >> 11;
     }
 
+    // Chapter 16
+    // "C" Standard Extension for Compressed Instructions
+    static uint32_t expand(uint32_t format);
+    static const uint32_t* const expansion;
+
 #if RISCV_HAVE_SINGLE
     union float32_t
     {
@@ -174,10 +202,13 @@ struct riscv_instruction
         operator float() const
         {
 #if RISCV_HAVE_DOUBLE
-            if ((u & (UINT64_MAX << 32)) != (UINT64_MAX << 32))
-                return d;
-#endif
+            // A value which is not NaN-boxed reads as the canonical NaN
+            float32_t boxed;
+            boxed.u = ((u >> 32) == UINT32_MAX) ? u : (UINT64_MAX << 32) | 0x7FC00000;
+            return boxed.f;
+#else
             return f;
+#endif
         }
         float32_t& operator = (float other)
         {
@@ -199,9 +230,7 @@ struct riscv_instruction
 
         operator double() const
         {
-            if ((u & (UINT64_MAX << 32)) != (UINT64_MAX << 32))
-                return d;
-            return f;
+            return d;
         }
         float64_t& operator = (double other)
         {
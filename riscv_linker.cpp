@@ -0,0 +1,337 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "libelf/elf_view.h"
+#include "riscv_cpu.h"
+#include "riscv_linker.h"
+
+//------------------------------------------------------------------------------
+riscv_linker::riscv_linker(const char* directory, size_t size)
+{
+    this->directory = directory;
+    bindings = 0;
+    error = nullptr;
+    libraryCount = 0;
+    instances = nullptr;
+    instanceCount = 0;
+    instanceSize = 0;
+    active = nullptr;
+
+    // Pages are only committed once something is loaded into them
+    size_t page = sysconf(_SC_PAGESIZE);
+    this->size = (size + page - 1) & ~(page - 1);
+    top = 0;
+    arena = (uint8_t*)mmap(nullptr, this->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (arena == MAP_FAILED)
+    {
+        arena = nullptr;
+        this->size = 0;
+        error = "arena is not available";
+    }
+
+    begin = (uintptr_t)arena;
+    end = begin + this->size;
+    trampoline = end;
+}
+//------------------------------------------------------------------------------
+riscv_linker::~riscv_linker()
+{
+    for (size_t i = 0; i < libraryCount; ++i)
+    {
+        delete libraries[i];
+        delete[] names[i];
+        delete[] files[i];
+        delete[] pristine[i];
+        for (size_t j = 0; j < instanceCount; ++j)
+            delete[] instances[j].data[i];
+    }
+    delete[] instances;
+    if (arena)
+        munmap(arena, size);
+}
+//------------------------------------------------------------------------------
+void* riscv_linker::allocate(size_t size)
+{
+    if (arena == nullptr || size > this->size - top)
+        return nullptr;
+    void* memory = arena + top;
+    top += size;
+    return memory;
+}
+//------------------------------------------------------------------------------
+bool riscv_linker::link(riscv_loader& instance)
+{
+    if (instance.elf.elfFile == nullptr)
+    {
+        error = "instance is not open";
+        return false;
+    }
+
+    // ET_EXEC images stay at their link address
+    void* base = nullptr;
+    if (((Elf64_Ehdr*)instance.elf.elfFile)->e_type == ET_DYN)
+    {
+        base = allocate(instance.span());
+        if (base == nullptr)
+        {
+            error = "arena is full";
+            return false;
+        }
+    }
+
+    instance.resolve = resolve;
+    instance.context = this;
+    instance.lazy = true;
+    if (instance.load(base) == false)
+    {
+        error = instance.error;
+        return false;
+    }
+    if (require(instance) == false)
+        return false;
+
+    // GOT[0] is _dl_runtime_resolve, GOT[1] is the link map
+    if (instance.pltgot)
+    {
+        instance.pltgot[0] = trampoline;
+        instance.pltgot[1] = (uintptr_t)&instance;
+    }
+
+    // bind() only trusts link maps it handed out
+    if (known((uintptr_t)&instance) == nullptr)
+    {
+        if (instanceCount == instanceSize)
+        {
+            instanceSize = instanceSize ? instanceSize * 2 : 16;
+            instance_t* old = instances;
+            instances = new instance_t[instanceSize];
+            for (size_t i = 0; i < instanceCount; ++i)
+                instances[i] = old[i];
+            if (active)
+                active = instances + (active - old);
+            delete[] old;
+        }
+        instance_t& entry = instances[instanceCount++];
+        entry.loader = &instance;
+        for (size_t i = 0; i < MAX_LIBRARY; ++i)
+            entry.data[i] = nullptr;
+    }
+
+    error = nullptr;
+    return true;
+}
+//------------------------------------------------------------------------------
+riscv_loader* riscv_linker::known(uintptr_t map) const
+{
+    for (size_t i = 0; i < libraryCount; ++i)
+    {
+        if ((uintptr_t)libraries[i] == map)
+            return libraries[i];
+    }
+    for (size_t i = 0; i < instanceCount; ++i)
+    {
+        if ((uintptr_t)instances[i].loader == map)
+            return instances[i].loader;
+    }
+    return nullptr;
+}
+//------------------------------------------------------------------------------
+bool riscv_linker::require(const riscv_loader& loader)
+{
+    for (size_t i = 0; i < loader.neededCount; ++i)
+    {
+        const char* name = loader.needed[i];
+        bool found = false;
+        for (size_t j = 0; j < libraryCount; ++j)
+        {
+            if (strcmp(names[j], name) == 0)
+                found = true;
+        }
+        if (found)
+            continue;
+        if (libraryCount >= MAX_LIBRARY)
+        {
+            error = "too many libraries";
+            return false;
+        }
+
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", directory, name);
+        size_t size = 0;
+        char* data = riscv_loader::read(path, size);
+        if (data == nullptr)
+        {
+            error = "needed library not found";
+            return false;
+        }
+
+        // Registered before it is linked, so cyclic dependencies terminate
+        size_t index = libraryCount++;
+        libraries[index] = new riscv_loader;
+        names[index] = new char[strlen(name) + 1];
+        strcpy(names[index], name);
+        files[index] = data;
+        loaded[index] = false;
+        this->data[index] = nullptr;
+        dataSize[index] = 0;
+        pristine[index] = nullptr;
+
+        riscv_loader& library = *libraries[index];
+        if (library.open(data, size) == false)
+        {
+            error = "needed library is not a valid shared object";
+            return false;
+        }
+        if (link(library) == false)
+            return false;
+        loaded[index] = true;
+
+        // Every instance starts from the relocated data
+        elf64_view view(&library.elf);
+        uintptr_t first = UINTPTR_MAX;
+        uintptr_t last = 0;
+        for (const Elf64_Phdr& phdr : view.programHeaders())
+        {
+            if (phdr.p_type != PT_LOAD || (phdr.p_flags & PF_W) == 0 || phdr.p_memsz == 0)
+                continue;
+            if (first > library.bias + phdr.p_vaddr)
+                first = library.bias + phdr.p_vaddr;
+            if (last < library.bias + phdr.p_vaddr + phdr.p_memsz)
+                last = library.bias + phdr.p_vaddr + phdr.p_memsz;
+        }
+        if (first < last)
+        {
+            this->data[index] = (uint8_t*)first;
+            dataSize[index] = last - first;
+            pristine[index] = new uint8_t[dataSize[index]];
+            memcpy(pristine[index], this->data[index], dataSize[index]);
+        }
+    }
+    return true;
+}
+//------------------------------------------------------------------------------
+void riscv_linker::save(instance_t& instance)
+{
+    for (size_t i = 0; i < libraryCount; ++i)
+    {
+        if (dataSize[i] == 0)
+            continue;
+        if (instance.data[i] == nullptr)
+            instance.data[i] = new uint8_t[dataSize[i]];
+        memcpy(instance.data[i], data[i], dataSize[i]);
+    }
+}
+//------------------------------------------------------------------------------
+void riscv_linker::restore(const instance_t& instance)
+{
+    for (size_t i = 0; i < libraryCount; ++i)
+    {
+        if (dataSize[i] == 0)
+            continue;
+        memcpy(data[i], instance.data[i] ? instance.data[i] : pristine[i], dataSize[i]);
+    }
+}
+//------------------------------------------------------------------------------
+void riscv_linker::activate(const riscv_loader& instance)
+{
+    instance_t* next = nullptr;
+    for (size_t i = 0; i < instanceCount; ++i)
+    {
+        if (instances[i].loader == &instance)
+            next = &instances[i];
+    }
+    if (next == nullptr || next == active)
+        return;
+    if (active)
+        save(*active);
+    restore(*next);
+    active = next;
+}
+//------------------------------------------------------------------------------
+uintptr_t riscv_linker::resolve(void* context, const riscv_loader& loader, const char* name)
+{
+    riscv_linker* linker = (riscv_linker*)context;
+    if (linker->require(loader) == false)
+        return 0;
+    return linker->symbol(name);
+}
+//------------------------------------------------------------------------------
+uintptr_t riscv_linker::symbol(const char* name) const
+{
+    for (size_t i = 0; i < libraryCount; ++i)
+    {
+        if (loaded[i] == false)
+            continue;
+        uintptr_t value = libraries[i]->symbol(name);
+        if (value)
+            return value;
+    }
+    return 0;
+}
+//------------------------------------------------------------------------------
+void riscv_linker::program(riscv_cpu& cpu, const riscv_loader& instance)
+{
+    activate(instance);
+    instance.program(cpu);
+    if (cpu.begin > begin)
+        cpu.begin = begin;
+    if (cpu.end < end)
+        cpu.end = end;
+}
+//------------------------------------------------------------------------------
+bool riscv_linker::bind(riscv_cpu& cpu)
+{
+    if (cpu.pc != trampoline)
+        return false;
+
+    // PLT0 leaves the link map in t0 and the .got.plt slot offset in t1
+    const riscv_loader* map = known(cpu.x[5].u);
+    size_t index = cpu.x[6].u / sizeof(uintptr_t);
+    if (map == nullptr || index >= map->jmprelCount || map->symbols == nullptr || map->strings == nullptr ||
+        ELF64_R_SYM(map->jmprel[index].r_info) >= map->symbolCount)
+    {
+        error = "invalid PLT slot";
+        return false;
+    }
+
+    const riscv_loader& loader = *map;
+    const Elf64_Rela& rela = loader.jmprel[index];
+    const Elf64_Sym& symbol = loader.symbols[ELF64_R_SYM(rela.r_info)];
+    uintptr_t target = 0;
+    if (symbol.st_shndx != SHN_UNDEF)
+        target = loader.bias + symbol.st_value;
+    else if (symbol.st_name < loader.stringSize)
+        target = this->symbol(loader.strings + symbol.st_name);
+    if (target == 0)
+    {
+        error = "undefined symbol";
+        return false;
+    }
+
+    *(uint64_t*)(loader.bias + rela.r_offset) = target;
+    cpu.pc = target;
+    bindings++;
+    return true;
+}
+//------------------------------------------------------------------------------
+bool riscv_linker::run(riscv_cpu& cpu)
+{
+    for (;;)
+    {
+        if (cpu.run() == false)
+            return false;
+        if (cpu.pc != trampoline)
+            return true;
+        if (bind(cpu) == false)
+            return false;
+    }
+}
+//------------------------------------------------------------------------------
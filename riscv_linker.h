@@ -0,0 +1,92 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "riscv_loader.h"
+
+struct riscv_cpu;
+
+//------------------------------------------------------------------------------
+// Dynamic linker
+//------------------------------------------------------------------------------
+// Instances and shared objects are packed into one arena. DT_NEEDED libraries
+// are read from directory the first time an instance needs them and their
+// text is mapped once for all instances. Library code reaches its data
+// pc-relative, so the writable segments stay at one address and each instance
+// keeps its own copy of them, which program() / activate() swap in. A new
+// instance starts from the data as it was right after relocation. Only one
+// instance of a linker runs at a time.
+// PLT slots are bound lazily. GOT[0] points at the trampoline, which is the
+// first address after the arena, so riscv_cpu::run() returns when a guest
+// enters PLT0. bind() then resolves the slot from t0 (link map) and t1 (slot
+// offset), writes the target into the GOT and resumes there. Later calls go
+// through the PLT straight to the target. run() does this loop. t0 must be a
+// library or an instance linked here, anything else is an invalid PLT slot.
+//------------------------------------------------------------------------------
+struct riscv_linker
+{
+    riscv_linker(const char* directory, size_t size = size_t(1) << 30);
+    ~riscv_linker();
+
+    bool link(riscv_loader& instance);
+    void activate(const riscv_loader& instance);
+    void program(riscv_cpu& cpu, const riscv_loader& instance);
+    bool bind(riscv_cpu& cpu);
+    bool run(riscv_cpu& cpu);
+
+    uintptr_t symbol(const char* name) const;
+
+public:
+    const char* directory;
+    uintptr_t begin;
+    uintptr_t end;
+    uintptr_t trampoline;
+    size_t bindings;
+    const char* error;
+
+protected:
+    static uintptr_t resolve(void* context, const riscv_loader& loader, const char* name);
+    bool require(const riscv_loader& loader);
+    riscv_loader* known(uintptr_t map) const;
+    void* allocate(size_t size);
+
+    enum { MAX_LIBRARY = 32 };
+
+    // Library data of an instance while it is not active, nullptr until saved
+    struct instance_t
+    {
+        riscv_loader* loader;
+        uint8_t* data[MAX_LIBRARY];
+    };
+    void save(instance_t& instance);
+    void restore(const instance_t& instance);
+
+    riscv_loader* libraries[MAX_LIBRARY];
+    char* names[MAX_LIBRARY];
+    char* files[MAX_LIBRARY];
+    bool loaded[MAX_LIBRARY];
+    size_t libraryCount;
+
+    // Range of the writable segments of each library and its contents right
+    // after relocation
+    uint8_t* data[MAX_LIBRARY];
+    size_t dataSize[MAX_LIBRARY];
+    uint8_t* pristine[MAX_LIBRARY];
+
+    instance_t* instances;
+    size_t instanceCount;
+    size_t instanceSize;
+    instance_t* active;
+
+    uint8_t* arena;
+    size_t size;
+    size_t top;
+};
+//------------------------------------------------------------------------------
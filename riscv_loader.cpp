@@ -0,0 +1,526 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "libelf/elf_view.h"
+#include "riscv_cpu.h"
+#include "riscv_loader.h"
+
+// RISC-V ELF psABI
+enum
+{
+    R_RISCV_NONE        = 0,
+    R_RISCV_64          = 2,
+    R_RISCV_RELATIVE    = 3,
+    R_RISCV_JUMP_SLOT   = 5,
+};
+
+// GNU extension
+enum
+{
+    DT_GNU_HASH         = 0x6ffffef5,
+};
+
+//------------------------------------------------------------------------------
+riscv_loader::riscv_loader()
+{
+    memset(&elf, 0, sizeof(elf));
+    bias = 0;
+    entry = 0;
+    begin = 0;
+    end = 0;
+    relocations = 0;
+    error = nullptr;
+
+    resolve = nullptr;
+    context = nullptr;
+    lazy = false;
+
+    neededCount = 0;
+    jmprel = nullptr;
+    jmprelCount = 0;
+    symbols = nullptr;
+    symbolCount = 0;
+    strings = nullptr;
+    stringSize = 0;
+    pltgot = nullptr;
+
+    hash = nullptr;
+    gnuHash = nullptr;
+    low = 0;
+    high = 0;
+    memory = nullptr;
+    owned = false;
+}
+//------------------------------------------------------------------------------
+riscv_loader::~riscv_loader()
+{
+    unload();
+}
+//------------------------------------------------------------------------------
+bool riscv_loader::open(const void* file, size_t size)
+{
+    unload();
+
+    if (elf_newFile(file, size, &elf) < 0 || elf.elfClass != ELFCLASS64)
+    {
+        error = "not a valid ELF64 file";
+        return false;
+    }
+
+    elf64_view view(&elf);
+    const Elf64_Ehdr& header = view.header();
+    if (header.e_machine != EM_RISCV || (header.e_type != ET_EXEC && header.e_type != ET_DYN))
+    {
+        error = "not a RISC-V executable or shared object";
+        return false;
+    }
+
+    size_t page = sysconf(_SC_PAGESIZE);
+    low = UINTPTR_MAX;
+    high = 0;
+    for (const Elf64_Phdr& phdr : view.programHeaders())
+    {
+        if (phdr.p_type != PT_LOAD || phdr.p_memsz == 0)
+            continue;
+        if (phdr.p_filesz > phdr.p_memsz || phdr.p_offset > size || phdr.p_filesz > size - phdr.p_offset)
+        {
+            error = "segment exceeds the file";
+            return false;
+        }
+        if (phdr.p_vaddr > UINTPTR_MAX - page || phdr.p_memsz > UINTPTR_MAX - page - phdr.p_vaddr)
+        {
+            error = "segment exceeds the address space";
+            return false;
+        }
+        if (low > phdr.p_vaddr)
+            low = phdr.p_vaddr;
+        if (high < phdr.p_vaddr + phdr.p_memsz)
+            high = phdr.p_vaddr + phdr.p_memsz;
+    }
+    if (low >= high)
+    {
+        error = "no loadable segment";
+        return false;
+    }
+    low = low & ~(page - 1);
+    high = (high + page - 1) & ~(page - 1);
+
+    error = nullptr;
+    return true;
+}
+//------------------------------------------------------------------------------
+size_t riscv_loader::span() const
+{
+    return high - low;
+}
+//------------------------------------------------------------------------------
+bool riscv_loader::load(void* base)
+{
+    if (elf.elfFile == nullptr || memory != nullptr)
+    {
+        error = "no image or already loaded";
+        return false;
+    }
+
+    elf64_view view(&elf);
+    bool relocatable = (view.header().e_type == ET_DYN);
+    size_t page = sysconf(_SC_PAGESIZE);
+    if (base && ((uintptr_t)base & (page - 1)))
+    {
+        error = "base is not page aligned";
+        return false;
+    }
+    if (base && relocatable == false && (uintptr_t)base != low)
+    {
+        error = "ET_EXEC cannot be relocated";
+        return false;
+    }
+
+    // The caller owns memory it passes in, otherwise it is mapped here
+    memory = (uint8_t*)base;
+    owned = false;
+    if (memory == nullptr)
+    {
+        void* hint = relocatable ? nullptr : (void*)low;
+        void* mapped = mmap(hint, span(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped == MAP_FAILED || (relocatable == false && mapped != hint))
+        {
+            if (mapped != MAP_FAILED)
+                munmap(mapped, span());
+            error = "guest memory is not available";
+            return false;
+        }
+        memory = (uint8_t*)mapped;
+        owned = true;
+    }
+    bias = (uintptr_t)memory - low;
+
+    const Elf64_Phdr* dynamicHeader = nullptr;
+    for (const Elf64_Phdr& phdr : view.programHeaders())
+    {
+        if (phdr.p_type == PT_DYNAMIC)
+            dynamicHeader = &phdr;
+        if (phdr.p_type != PT_LOAD || phdr.p_memsz == 0)
+            continue;
+        uint8_t* dest = (uint8_t*)(bias + phdr.p_vaddr);
+        memcpy(dest, view.file + phdr.p_offset, phdr.p_filesz);
+        memset(dest + phdr.p_filesz, 0, phdr.p_memsz - phdr.p_filesz);
+    }
+
+    // Code may be copied into a writable segment and executed from there
+    entry = bias + view.header().e_entry;
+    begin = bias + low;
+    end = bias + high;
+
+    relocations = 0;
+    neededCount = 0;
+    jmprel = nullptr;
+    jmprelCount = 0;
+    symbols = nullptr;
+    symbolCount = 0;
+    strings = nullptr;
+    stringSize = 0;
+    pltgot = nullptr;
+    hash = nullptr;
+    gnuHash = nullptr;
+    if (dynamicHeader)
+    {
+        const Elf64_Dyn* dyn = (Elf64_Dyn*)(bias + dynamicHeader->p_vaddr);
+        if (inside(dyn, dynamicHeader->p_memsz) == false)
+        {
+            error = "dynamic section out of range";
+            unload();
+            return false;
+        }
+        if (dynamic(dyn, dynamicHeader->p_memsz / sizeof(Elf64_Dyn)) == false)
+        {
+            unload();
+            return false;
+        }
+    }
+
+    error = nullptr;
+    return true;
+}
+//------------------------------------------------------------------------------
+void riscv_loader::unload()
+{
+    if (memory && owned)
+        munmap(memory, span());
+    memory = nullptr;
+    owned = false;
+    elf_freeIndex(&elf);
+}
+//------------------------------------------------------------------------------
+bool riscv_loader::inside(const void* address, size_t size) const
+{
+    uintptr_t first = (uintptr_t)memory;
+    uintptr_t last = first + span();
+    return (uintptr_t)address >= first && (uintptr_t)address <= last && size <= last - (uintptr_t)address;
+}
+//------------------------------------------------------------------------------
+size_t riscv_loader::count()
+{
+    // nchain is the number of symbols
+    if (hash && inside(hash, 2 * sizeof(uint32_t)))
+    {
+        if (inside(hash, (2 + size_t(hash[0]) + hash[1]) * sizeof(uint32_t)))
+        {
+            gnuHash = nullptr;
+            return hash[1];
+        }
+    }
+    hash = nullptr;
+
+    // The last symbol is at the end of the chain of the highest bucket
+    if (gnuHash && inside(gnuHash, 4 * sizeof(uint32_t)) && gnuHash[0])
+    {
+        uint32_t bucketCount = gnuHash[0];
+        uint32_t first = gnuHash[1];
+        const uint32_t* buckets = (uint32_t*)((uint64_t*)(gnuHash + 4) + gnuHash[2]);
+        const uint32_t* chains = buckets + bucketCount;
+        if (inside(buckets, bucketCount * sizeof(uint32_t)))
+        {
+            uint32_t last = 0;
+            for (uint32_t i = 0; i < bucketCount; ++i)
+            {
+                if (last < buckets[i])
+                    last = buckets[i];
+            }
+            if (last < first)
+                return first;
+            for (; inside(chains + last - first, sizeof(uint32_t)); ++last)
+            {
+                if (chains[last - first] & 1)
+                    return last + 1;
+            }
+        }
+    }
+    gnuHash = nullptr;
+
+    // Otherwise the section which holds the table
+    elf64_view view(&elf);
+    for (const Elf64_Shdr& shdr : view.sections())
+    {
+        if (shdr.sh_type == SHT_DYNSYM && bias + shdr.sh_addr == (uintptr_t)symbols)
+            return shdr.sh_size / sizeof(Elf64_Sym);
+    }
+    return 0;
+}
+//------------------------------------------------------------------------------
+bool riscv_loader::dynamic(const Elf64_Dyn* dyn, size_t entries)
+{
+    const Elf64_Rela* rela = nullptr;
+    size_t relaSize = 0;
+    size_t jmprelSize = 0;
+    size_t neededName[MAX_NEEDED];
+    for (const Elf64_Dyn* last = dyn + entries; dyn < last && dyn->d_tag != DT_NULL; ++dyn)
+    {
+        switch (dyn->d_tag)
+        {
+        case DT_NEEDED:
+            if (neededCount >= MAX_NEEDED)
+            {
+                error = "too many needed libraries";
+                return false;
+            }
+            neededName[neededCount++] = dyn->d_un.d_val;
+            break;
+        case DT_RELA:       rela = (Elf64_Rela*)(bias + dyn->d_un.d_ptr);       break;
+        case DT_RELASZ:     relaSize = dyn->d_un.d_val;                         break;
+        case DT_JMPREL:     jmprel = (Elf64_Rela*)(bias + dyn->d_un.d_ptr);     break;
+        case DT_PLTRELSZ:   jmprelSize = dyn->d_un.d_val;                       break;
+        case DT_SYMTAB:     symbols = (Elf64_Sym*)(bias + dyn->d_un.d_ptr);     break;
+        case DT_STRTAB:     strings = (char*)(bias + dyn->d_un.d_ptr);          break;
+        case DT_STRSZ:      stringSize = dyn->d_un.d_val;                       break;
+        case DT_HASH:       hash = (uint32_t*)(bias + dyn->d_un.d_ptr);         break;
+        case DT_GNU_HASH:   gnuHash = (uint32_t*)(bias + dyn->d_un.d_ptr);      break;
+        case DT_PLTGOT:     pltgot = (uintptr_t*)(bias + dyn->d_un.d_ptr);      break;
+        }
+    }
+    if (neededCount && strings == nullptr)
+    {
+        error = "needed libraries without a string table";
+        return false;
+    }
+    if (strings && (stringSize == 0 || inside(strings, stringSize) == false || strings[stringSize - 1] != 0))
+    {
+        error = "string table out of range";
+        return false;
+    }
+    if (symbols)
+    {
+        symbolCount = count();
+        if (symbolCount == 0 || inside(symbols, symbolCount * sizeof(Elf64_Sym)) == false)
+        {
+            error = "symbol table out of range";
+            return false;
+        }
+    }
+    for (size_t i = 0; i < neededCount; ++i)
+    {
+        if (neededName[i] >= stringSize)
+        {
+            error = "needed library name out of range";
+            return false;
+        }
+        needed[i] = strings + neededName[i];
+    }
+    if ((rela && inside(rela, relaSize) == false) || (jmprel && inside(jmprel, jmprelSize) == false))
+    {
+        error = "relocation table out of range";
+        return false;
+    }
+    jmprelCount = jmprel ? jmprelSize / sizeof(Elf64_Rela) : 0;
+
+    return relocate(rela, relaSize, false) && relocate(jmprel, jmprelSize, true);
+}
+//------------------------------------------------------------------------------
+bool riscv_loader::relocate(const Elf64_Rela* table, size_t size, bool plt)
+{
+    if (table == nullptr)
+        return true;
+
+    uintptr_t first = (uintptr_t)memory;
+    uintptr_t last = first + span() - sizeof(uint64_t);
+    for (size_t i = 0; i < size / sizeof(Elf64_Rela); ++i)
+    {
+        const Elf64_Rela& rela = table[i];
+        uintptr_t target = bias + rela.r_offset;
+        uint32_t type = ELF64_R_TYPE(rela.r_info);
+        if (type == R_RISCV_NONE)
+            continue;
+        if (target < first || target > last)
+        {
+            error = "relocation outside of the image";
+            return false;
+        }
+        if (type != R_RISCV_RELATIVE && symbols == nullptr)
+        {
+            error = "relocation without a symbol table";
+            return false;
+        }
+        if (type != R_RISCV_RELATIVE && ELF64_R_SYM(rela.r_info) >= symbolCount)
+        {
+            error = "relocation symbol out of range";
+            return false;
+        }
+
+        uintptr_t symbol = 0;
+        switch (type)
+        {
+        case R_RISCV_RELATIVE:
+            *(uint64_t*)target = bias + rela.r_addend;
+            break;
+        case R_RISCV_64:
+            if (value(symbols[ELF64_R_SYM(rela.r_info)], symbol) == false)
+                return false;
+            *(uint64_t*)target = symbol + rela.r_addend;
+            break;
+        case R_RISCV_JUMP_SLOT:
+            // The slot holds the link address of PLT0 until riscv_linker binds it
+            if (plt && lazy && pltgot)
+            {
+                *(uint64_t*)target += bias;
+                break;
+            }
+            if (value(symbols[ELF64_R_SYM(rela.r_info)], symbol) == false)
+                return false;
+            *(uint64_t*)target = symbol;
+            break;
+        default:
+            error = "unsupported relocation";
+            return false;
+        }
+        relocations++;
+    }
+    return true;
+}
+//------------------------------------------------------------------------------
+bool riscv_loader::value(const Elf64_Sym& symbol, uintptr_t& value)
+{
+    // S is the load address of the symbol, weak undefined symbols are zero
+    value = 0;
+    if (symbol.st_shndx != SHN_UNDEF)
+    {
+        value = bias + symbol.st_value;
+        return true;
+    }
+    if (resolve && strings)
+    {
+        if (symbol.st_name >= stringSize)
+        {
+            error = "symbol name out of range";
+            return false;
+        }
+        value = resolve(context, *this, strings + symbol.st_name);
+        if (value)
+            return true;
+    }
+    if (ELF_ST_BIND(symbol.st_info) == STB_WEAK)
+        return true;
+
+    error = "undefined symbol";
+    return false;
+}
+//------------------------------------------------------------------------------
+void riscv_loader::program(riscv_cpu& cpu) const
+{
+    cpu.program((void*)entry, end - entry);
+    cpu.begin = begin;
+}
+//------------------------------------------------------------------------------
+bool riscv_loader::exported(size_t index, const char* name) const
+{
+    const Elf64_Sym& symbol = symbols[index];
+    int binding = ELF_ST_BIND(symbol.st_info);
+    if (symbol.st_shndx == SHN_UNDEF || (binding != STB_GLOBAL && binding != STB_WEAK))
+        return false;
+    return symbol.st_name < stringSize && strcmp(strings + symbol.st_name, name) == 0;
+}
+//------------------------------------------------------------------------------
+uintptr_t riscv_loader::symbol(const char* name) const
+{
+    // Only what the image exports through its dynamic symbol table
+    if (symbols == nullptr || strings == nullptr)
+        return 0;
+
+    if (gnuHash)
+    {
+        uint32_t h = 5381;
+        for (const char* c = name; *c; ++c)
+            h = h * 33 + (uint8_t)*c;
+        uint32_t bucketCount = gnuHash[0];
+        uint32_t first = gnuHash[1];
+        const uint32_t* buckets = (uint32_t*)((uint64_t*)(gnuHash + 4) + gnuHash[2]);
+        const uint32_t* chains = buckets + bucketCount;
+        for (size_t i = buckets[h % bucketCount]; i >= first && i < symbolCount; ++i)
+        {
+            if ((chains[i - first] | 1) == (h | 1) && exported(i, name))
+                return bias + symbols[i].st_value;
+            if (chains[i - first] & 1)
+                break;
+        }
+        return 0;
+    }
+
+    if (hash)
+    {
+        uint32_t h = 0;
+        for (const char* c = name; *c; ++c)
+        {
+            h = (h << 4) + (uint8_t)*c;
+            h = (h ^ ((h & 0xf0000000) >> 24)) & 0x0fffffff;
+        }
+        uint32_t bucketCount = hash[0];
+        const uint32_t* buckets = hash + 2;
+        const uint32_t* chains = buckets + bucketCount;
+        size_t steps = 0;
+        for (size_t i = bucketCount ? buckets[h % bucketCount] : 0; i && i < symbolCount && steps < symbolCount; i = chains[i], ++steps)
+        {
+            if (exported(i, name))
+                return bias + symbols[i].st_value;
+        }
+        return 0;
+    }
+
+    for (size_t i = 1; i < symbolCount; ++i)
+    {
+        if (exported(i, name))
+            return bias + symbols[i].st_value;
+    }
+    return 0;
+}
+//------------------------------------------------------------------------------
+char* riscv_loader::read(const char* path, size_t& size)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr)
+        return nullptr;
+    long length = -1;
+    if (fseek(file, 0, SEEK_END) == 0)
+        length = ftell(file);
+    if (length < 0 || fseek(file, 0, SEEK_SET) != 0)
+    {
+        fclose(file);
+        return nullptr;
+    }
+    size = length;
+    char* data = new char[size];
+    if (fread(data, 1, size, file) != size)
+    {
+        delete[] data;
+        data = nullptr;
+    }
+    fclose(file);
+    return data;
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,88 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "libelf/elf.h"
+
+struct riscv_cpu;
+
+//------------------------------------------------------------------------------
+// ELF loader
+//------------------------------------------------------------------------------
+// Guest addresses are host addresses. ET_EXEC images can only be loaded at
+// their link address, ET_DYN images are loaded at any page-aligned base and
+// relocated in place, so several instances of the same program can share one
+// address space. The loader owns the mapping when it allocated it itself.
+//   open()     validate an RV64 ET_EXEC or ET_DYN image
+//   span()     bytes of guest memory the image needs
+//   load()     map and copy PT_LOAD segments, then apply .rela.dyn / .rela.plt
+//   program()  point a riscv_cpu at the entry, begin / end cover the image
+//   read()     read a whole image file for open()
+// Undefined symbols are passed to resolve(). With lazy set, JUMP_SLOT entries
+// keep pointing at PLT0 and are bound later by riscv_linker. symbol() only
+// finds defined global and weak symbols of the dynamic symbol table.
+//------------------------------------------------------------------------------
+struct riscv_loader
+{
+    riscv_loader();
+    ~riscv_loader();
+
+    bool open(const void* file, size_t size);
+    size_t span() const;
+    bool load(void* base = nullptr);
+    void unload();
+    void program(riscv_cpu& cpu) const;
+
+    uintptr_t symbol(const char* name) const;
+
+    // Whole file in a new[] buffer, nullptr when it cannot be read
+    static char* read(const char* path, size_t& size);
+
+public:
+    elf_t elf;
+    uintptr_t bias;
+    uintptr_t entry;
+    uintptr_t begin;
+    uintptr_t end;
+    size_t relocations;
+    const char* error;
+
+    // Dynamic linking
+    enum { MAX_NEEDED = 16 };
+    uintptr_t (*resolve)(void* context, const riscv_loader& loader, const char* name);
+    void* context;
+    bool lazy;
+
+    const char* needed[MAX_NEEDED];
+    size_t neededCount;
+    const Elf64_Rela* jmprel;
+    size_t jmprelCount;
+    const Elf64_Sym* symbols;
+    size_t symbolCount;
+    const char* strings;
+    size_t stringSize;
+    uintptr_t* pltgot;
+
+protected:
+    bool inside(const void* address, size_t size) const;
+    size_t count();
+    bool exported(size_t index, const char* name) const;
+    bool dynamic(const Elf64_Dyn* dyn, size_t entries);
+    bool relocate(const Elf64_Rela* table, size_t size, bool plt);
+    bool value(const Elf64_Sym& symbol, uintptr_t& value);
+
+    const uint32_t* hash;
+    const uint32_t* gnuHash;
+    uintptr_t low;
+    uintptr_t high;
+    uint8_t* memory;
+    bool owned;
+};
+//------------------------------------------------------------------------------
@@ -0,0 +1,60 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct riscv_cpu;
+
+//------------------------------------------------------------------------------
+// Instrumentation plugin
+//------------------------------------------------------------------------------
+// A plugin declares the callbacks it wants in hooks before it is attached to a
+// riscv_cpu. While no plugin is attached, run() / runOnce() use the dispatch
+// loop without any instrumentation compiled in.
+//   FETCH   before an instruction executes, cpu.format is already fetched and
+//           expanded when it was compressed, cpu.length is 2 or 4
+//   RETIRE  after an instruction executes, address is its pc
+//   BLOCK   after a BRANCH, JAL or JALR, cpu.pc is the next block
+//   MEMORY  before a load, store or AMO, cpu.pc is the instruction
+//   ECALL   before environmentCall is invoked
+//   FAULT   after SIGSEGV has unwound the dispatch loop
+//   FLOAT   the callbacks use host floating point, which then runs with the
+//           host rounding mode and without touching the guest fflags
+//------------------------------------------------------------------------------
+struct riscv_plugin
+{
+    enum
+    {
+        FETCH   = 1 << 0,
+        RETIRE  = 1 << 1,
+        BLOCK   = 1 << 2,
+        MEMORY  = 1 << 3,
+        ECALL   = 1 << 4,
+        FAULT   = 1 << 5,
+        FLOAT   = 1 << 6,
+    };
+
+    riscv_plugin(int hooks) : hooks(hooks) {}
+    virtual ~riscv_plugin() {}
+
+    virtual void fetch(const riscv_cpu& cpu) {}
+    virtual void retire(const riscv_cpu& cpu, uintptr_t address) {}
+    virtual void block(const riscv_cpu& cpu, uintptr_t address) {}
+    virtual void memory(const riscv_cpu& cpu, uintptr_t address, size_t size, bool store) {}
+    virtual void ecall(const riscv_cpu& cpu) {}
+    virtual void fault(const riscv_cpu& cpu) {}
+
+    // Bytes of state owned by the plugin
+    virtual size_t footprint() const { return 0; }
+
+public:
+    int hooks;
+};
+//------------------------------------------------------------------------------
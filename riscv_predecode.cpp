@@ -0,0 +1,238 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "riscv_cpu.h"
+#include "riscv_predecode.h"
+
+static const char magic[8] = { 'R', 'V', 'P', 'D', 'E', 'C', 0, 0 };
+
+//------------------------------------------------------------------------------
+riscv_predecode::riscv_predecode()
+{
+    begin = 0;
+    end = 0;
+    code = 0;
+    cached = false;
+    error = nullptr;
+
+    entries = nullptr;
+    decoded = nullptr;
+    mapping = nullptr;
+    mappingSize = 0;
+}
+//------------------------------------------------------------------------------
+riscv_predecode::~riscv_predecode()
+{
+    close();
+}
+//------------------------------------------------------------------------------
+bool riscv_predecode::open(const char* directory, const void* code, size_t size)
+{
+    if (load(directory, code, size))
+        return true;
+    if (decode(code, size) == false)
+        return false;
+
+    // A cache which cannot be written only costs the next process a decode
+    save(directory);
+    return true;
+}
+//------------------------------------------------------------------------------
+bool riscv_predecode::load(const char* directory, const void* code, size_t size)
+{
+    close();
+    this->code = hash(code, size);
+
+    char name[1024];
+    path(name, sizeof(name), directory);
+    int file = ::open(name, O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+    {
+        error = "cache not found";
+        return false;
+    }
+    struct stat st;
+    size_t count = size / 2;
+    size_t expected = sizeof(header_t) + count * sizeof(entry_t);
+    if (fstat(file, &st) != 0 || size_t(st.st_size) != expected)
+    {
+        ::close(file);
+        error = "cache has the wrong size";
+        return false;
+    }
+    void* memory = mmap(nullptr, expected, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (memory == MAP_FAILED)
+    {
+        error = "cache cannot be mapped";
+        return false;
+    }
+
+    const header_t* header = (header_t*)memory;
+    const entry_t* table = (entry_t*)(header + 1);
+    if (memcmp(header->magic, magic, sizeof(magic)) != 0 ||
+        header->engine != engine() ||
+        header->code != this->code ||
+        header->count != count ||
+        header->checksum != hash(table, count * sizeof(entry_t)))
+    {
+        munmap(memory, expected);
+        error = "cache is stale or corrupt";
+        return false;
+    }
+
+    mapping = memory;
+    mappingSize = expected;
+    entries = table;
+    begin = (uintptr_t)code;
+    end = begin + count * 2;
+    cached = true;
+    error = nullptr;
+    return true;
+}
+//------------------------------------------------------------------------------
+bool riscv_predecode::decode(const void* code, size_t size)
+{
+    close();
+    this->code = hash(code, size);
+
+    size_t count = size / 2;
+    decoded = new entry_t[count];
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t format = 0;
+        memcpy(&format, (uint8_t*)code + i * 2, i * 2 + 4 <= size ? 4 : 2);
+        uint16_t length = 4;
+        decoded[i].code = format;
+        if ((format & 0b11) != 0b11)
+        {
+            format = riscv_instruction::expand(format);
+            length = 2;
+        }
+        decoded[i].format = format;
+        decoded[i].handler = riscv_cpu::decode(format);
+        decoded[i].length = length;
+    }
+
+    entries = decoded;
+    begin = (uintptr_t)code;
+    end = begin + count * 2;
+    cached = false;
+    error = nullptr;
+    return true;
+}
+//------------------------------------------------------------------------------
+bool riscv_predecode::save(const char* directory) const
+{
+    if (entries == nullptr)
+        return false;
+
+    size_t count = (end - begin) / 2;
+    header_t header = {};
+    memcpy(header.magic, magic, sizeof(magic));
+    header.engine = engine();
+    header.code = code;
+    header.count = count;
+    header.checksum = hash(entries, count * sizeof(entry_t));
+
+    char name[1024];
+    char temp[1024 + 32];
+    path(name, sizeof(name), directory);
+    snprintf(temp, sizeof(temp), "%s.%d", name, (int)getpid());
+    FILE* file = fopen(temp, "wb");
+    if (file == nullptr)
+        return false;
+    bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+    if (count)
+        success &= fwrite(entries, sizeof(entry_t), count, file) == count;
+    success &= fclose(file) == 0;
+    if (success == false || rename(temp, name) != 0)
+    {
+        unlink(temp);
+        return false;
+    }
+    return true;
+}
+//------------------------------------------------------------------------------
+size_t riscv_predecode::footprint() const
+{
+    // A mapped file is shared with every process which maps it
+    if (mapping)
+        return sizeof(riscv_predecode) + mappingSize;
+    return sizeof(riscv_predecode) + (end - begin) / 2 * sizeof(entry_t);
+}
+//------------------------------------------------------------------------------
+void riscv_predecode::close()
+{
+    if (mapping)
+        munmap(mapping, mappingSize);
+    mapping = nullptr;
+    mappingSize = 0;
+    delete[] decoded;
+    decoded = nullptr;
+    entries = nullptr;
+    begin = 0;
+    end = 0;
+    cached = false;
+}
+//------------------------------------------------------------------------------
+void riscv_predecode::path(char* path, size_t length, const char* directory) const
+{
+    snprintf(path, length, "%s/%016llx-%016llx.rvpd", directory, (unsigned long long)code, (unsigned long long)engine());
+}
+//------------------------------------------------------------------------------
+uint64_t riscv_predecode::engine()
+{
+    // Handler indices are only meaningful for the build which chose them, so
+    // the engine is the decoding of every opcode, funct3 and funct7 and the
+    // expansion of every compressed instruction
+    static uint64_t engine = 0;
+    if (engine == 0)
+    {
+        uint32_t version = VERSION;
+        uint64_t value = hash(&version, sizeof(version));
+        for (uint32_t format = 0; format < (1u << 16); ++format)
+        {
+            uint32_t expanded = riscv_instruction::expand(format);
+            value = hash(&expanded, sizeof(expanded), value);
+        }
+        for (uint32_t low = 0; low < (1u << 8); ++low)
+        {
+            for (uint32_t high = 0; high < (1u << 8); ++high)
+            {
+                uint32_t format = (low & 0b11111) << 2 | 0b11 | (low >> 5) << 12 | (high & 1) << 20 | (high >> 1) << 25;
+                uint16_t handler = riscv_cpu::decode(format);
+                value = hash(&handler, sizeof(handler), value);
+            }
+        }
+        engine = value;
+    }
+    return engine;
+}
+//------------------------------------------------------------------------------
+uint64_t riscv_predecode::hash(const void* data, size_t size, uint64_t hash)
+{
+    // FNV-1a over 64-bit words, then the tail bytes
+    const uint8_t* bytes = (uint8_t*)data;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    for (; i < size; ++i)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,92 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//------------------------------------------------------------------------------
+// Pre-decoded code cache
+//------------------------------------------------------------------------------
+// One entry per halfword of code holds the instruction word, the instruction
+// it expands to when it is compressed, its length and the index of the
+// riscv_cpu handler it resolves to, so riscv_cpu::run(predecode) neither
+// expands nor decodes again. open() maps <directory>/<code>-<engine>.rvpd
+// read-only when it exists, otherwise it decodes the code and saves the file
+// through a temporary and rename(), so concurrent writers never expose a
+// partial file. The name carries a hash of the code bytes and the engine, and
+// the header repeats both together with a checksum of the entries. Anything
+// that does not match is ignored and decoded again. Entries are position
+// independent, and riscv_cpu still compares every entry with the code it
+// executes before it is used.
+//------------------------------------------------------------------------------
+struct riscv_predecode
+{
+    enum { VERSION = 2 };
+
+    struct entry_t
+    {
+        uint32_t code;
+        uint32_t format;
+        uint16_t handler;
+        uint16_t length;
+    };
+
+    struct header_t
+    {
+        char magic[8];
+        uint64_t engine;
+        uint64_t code;
+        uint64_t count;
+        uint64_t checksum;
+    };
+
+    riscv_predecode();
+    ~riscv_predecode();
+
+    bool open(const char* directory, const void* code, size_t size);
+    bool load(const char* directory, const void* code, size_t size);
+    bool decode(const void* code, size_t size);
+    bool save(const char* directory) const;
+    void close();
+
+    bool empty() const;
+    const entry_t* lookup(uintptr_t pc) const;
+    size_t footprint() const;
+
+    static uint64_t engine();
+    static uint64_t hash(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+public:
+    uintptr_t begin;
+    uintptr_t end;
+    uint64_t code;
+    bool cached;
+    const char* error;
+
+protected:
+    void path(char* path, size_t length, const char* directory) const;
+
+    const entry_t* entries;
+    entry_t* decoded;
+    void* mapping;
+    size_t mappingSize;
+};
+//------------------------------------------------------------------------------
+inline bool riscv_predecode::empty() const
+{
+    return entries == nullptr;
+}
+//------------------------------------------------------------------------------
+inline const riscv_predecode::entry_t* riscv_predecode::lookup(uintptr_t pc) const
+{
+    if (pc < begin || pc + 4 > end)
+        return nullptr;
+    return &entries[(pc - begin) >> 1];
+}
+//------------------------------------------------------------------------------
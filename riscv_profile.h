@@ -0,0 +1,177 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+//------------------------------------------------------------------------------
+// Per-pc statistics for the instrumentation plugins
+//------------------------------------------------------------------------------
+// An open-addressing table keyed by pc, pc 0 marks a free slot. T is a plain
+// statistic with operator += so rows can be folded into their functions.
+//------------------------------------------------------------------------------
+template <typename T>
+struct riscv_profile
+{
+    typedef const char* symbol(void* context, uintptr_t pc, uintptr_t* base);
+
+    struct row
+    {
+        uintptr_t pc;
+        char name[64];
+        T statistic;
+    };
+
+    riscv_profile(size_t size);
+    ~riscv_profile();
+
+    void reset();
+    T& find(uintptr_t pc);
+    size_t footprint() const;
+
+    // One row per pc, or per function containing the pcs when symbol is set
+    row* pcs(symbol* symbol, void* context, size_t& count) const;
+    row* functions(symbol* symbol, void* context, size_t& count) const;
+
+protected:
+    struct slot
+    {
+        uintptr_t pc;
+        T statistic;
+    };
+
+    static size_t hash(uintptr_t pc, size_t size);
+
+    slot* slots;
+    size_t slotCount;
+    size_t slotSize;
+};
+//------------------------------------------------------------------------------
+template <typename T>
+riscv_profile<T>::riscv_profile(size_t size)
+{
+    slotCount = 0;
+    slotSize = size;
+    slots = new slot[slotSize]();
+}
+//------------------------------------------------------------------------------
+template <typename T>
+riscv_profile<T>::~riscv_profile()
+{
+    delete[] slots;
+}
+//------------------------------------------------------------------------------
+template <typename T>
+size_t riscv_profile<T>::hash(uintptr_t pc, size_t size)
+{
+    return size_t(uint64_t(pc) * 0x9E3779B97F4A7C15ull >> 32) & (size - 1);
+}
+//------------------------------------------------------------------------------
+template <typename T>
+void riscv_profile<T>::reset()
+{
+    slotCount = 0;
+    for (size_t i = 0; i < slotSize; ++i)
+    {
+        slots[i] = slot();
+    }
+}
+//------------------------------------------------------------------------------
+template <typename T>
+T& riscv_profile<T>::find(uintptr_t pc)
+{
+    if (slotCount * 2 >= slotSize)
+    {
+        slot* old = slots;
+        size_t oldSize = slotSize;
+        slotSize *= 2;
+        slots = new slot[slotSize]();
+        for (size_t i = 0; i < oldSize; ++i)
+        {
+            if (old[i].pc == 0)
+                continue;
+            size_t index = hash(old[i].pc, slotSize);
+            while (slots[index].pc)
+                index = (index + 1) & (slotSize - 1);
+            slots[index] = old[i];
+        }
+        delete[] old;
+    }
+
+    size_t index = hash(pc, slotSize);
+    while (slots[index].pc != pc)
+    {
+        if (slots[index].pc == 0)
+        {
+            slots[index].pc = pc;
+            slotCount++;
+            break;
+        }
+        index = (index + 1) & (slotSize - 1);
+    }
+    return slots[index].statistic;
+}
+//------------------------------------------------------------------------------
+template <typename T>
+size_t riscv_profile<T>::footprint() const
+{
+    return sizeof(slot) * slotSize;
+}
+//------------------------------------------------------------------------------
+template <typename T>
+typename riscv_profile<T>::row* riscv_profile<T>::pcs(symbol* symbol, void* context, size_t& count) const
+{
+    row* rows = new row[slotCount + 1];
+    count = 0;
+    for (size_t i = 0; i < slotSize; ++i)
+    {
+        if (slots[i].pc == 0)
+            continue;
+        row& row = rows[count++];
+        uintptr_t base = 0;
+        const char* function = symbol ? symbol(context, slots[i].pc, &base) : nullptr;
+        if (function)
+            snprintf(row.name, sizeof(row.name), "%s+0x%llx", function, (unsigned long long)(slots[i].pc - base));
+        else
+            snprintf(row.name, sizeof(row.name), "0x%llx", (unsigned long long)slots[i].pc);
+        row.pc = slots[i].pc;
+        row.statistic = slots[i].statistic;
+    }
+    return rows;
+}
+//------------------------------------------------------------------------------
+template <typename T>
+typename riscv_profile<T>::row* riscv_profile<T>::functions(symbol* symbol, void* context, size_t& count) const
+{
+    row* rows = new row[slotCount + 1];
+    count = 0;
+    for (size_t i = 0; symbol && i < slotSize; ++i)
+    {
+        if (slots[i].pc == 0)
+            continue;
+        uintptr_t base = 0;
+        const char* function = symbol(context, slots[i].pc, &base);
+        if (function == nullptr)
+            continue;
+        size_t index = 0;
+        while (index < count && rows[index].pc != base)
+            index++;
+        if (index == count)
+        {
+            rows[index].pc = base;
+            snprintf(rows[index].name, sizeof(rows[index].name), "%s", function);
+            rows[index].statistic = T();
+            count++;
+        }
+        rows[index].statistic += slots[i].statistic;
+    }
+    return rows;
+}
+//------------------------------------------------------------------------------
@@ -5,8 +5,8 @@
 // December 13, 2019
 //==============================================================================
 
+#include <math.h>
 #include "riscv_cpu.h"
-#include "riscv_float.h"
 
 #if RISCV_HAVE_DOUBLE
 //------------------------------------------------------------------------------
@@ -28,9 +28,8 @@ void riscv_cpu::FSD()
 //------------------------------------------------------------------------------
 void riscv_cpu::FMADD_D()
 {
-    fclearexcept();
+    fsetround();
     f[rd].d = fma(f[rs1].d, f[rs2].d, f[rs3].d);
-    ftestexcept();
     if (isnan(f[rd].d))
     {
         f[rd].d = NAN;
@@ -40,9 +39,8 @@ void riscv_cpu::FMADD_D()
 //------------------------------------------------------------------------------
 void riscv_cpu::FMSUB_D()
 {
-    fclearexcept();
+    fsetround();
     f[rd].d = fma(f[rs1].d, f[rs2].d, -f[rs3].d);
-    ftestexcept();
     if (isnan(f[rd].d))
     {
         f[rd].d = NAN;
@@ -52,9 +50,8 @@ void riscv_cpu::FMSUB_D()
 //------------------------------------------------------------------------------
 void riscv_cpu::FNMSUB_D()
 {
-    fclearexcept();
-    f[rd].d = -fma(f[rs1].d, f[rs2].d, -f[rs3].d);
-    ftestexcept();
+    fsetround();
+    f[rd].d = fma(-f[rs1].d, f[rs2].d, f[rs3].d);
     if (isnan(f[rd].d))
     {
         f[rd].d = NAN;
@@ -64,9 +61,8 @@ void riscv_cpu::FNMSUB_D()
 //------------------------------------------------------------------------------
 void riscv_cpu::FNMADD_D()
 {
-    fclearexcept();
-    f[rd].d = -fma(f[rs1].d, f[rs2].d, f[rs3].d);
-    ftestexcept();
+    fsetround();
+    f[rd].d = fma(-f[rs1].d, f[rs2].d, -f[rs3].d);
     if (isnan(f[rd].d))
     {
         f[rd].d = NAN;
@@ -76,9 +72,8 @@ void riscv_cpu::FNMADD_D()
 //------------------------------------------------------------------------------
 void riscv_cpu::FADD_D()
 {
-    fclearexcept();
+    fsetround();
     f[rd].d = f[rs1].d + f[rs2].d;
-    ftestexcept();
     if (isnan(f[rd].d))
     {
         f[rd].d = NAN;
@@ -88,9 +83,8 @@ void riscv_cpu::FADD_D()
 //------------------------------------------------------------------------------
 void riscv_cpu::FSUB_D()
 {
-    fclearexcept();
+    fsetround();
     f[rd].d = f[rs1].d - f[rs2].d;
-    ftestexcept();
     if (isnan(f[rd].d))
     {
         f[rd].d = NAN;
@@ -100,9 +94,8 @@ void riscv_cpu::FSUB_D()
 //------------------------------------------------------------------------------
 void riscv_cpu::FMUL_D()
 {
-    fclearexcept();
+    fsetround();
     f[rd].d = f[rs1].d * f[rs2].d;
-    ftestexcept();
     if (isnan(f[rd].d))
     {
         f[rd].d = NAN;
@@ -112,9 +105,8 @@ void riscv_cpu::FMUL_D()
 //------------------------------------------------------------------------------
 void riscv_cpu::FDIV_D()
 {
-    fclearexcept();
+    fsetround();
     f[rd].d = f[rs1].d / f[rs2].d;
-    ftestexcept();
     if (isnan(f[rd].d))
     {
         f[rd].d = NAN;
@@ -124,9 +116,8 @@ void riscv_cpu::FDIV_D()
 //------------------------------------------------------------------------------
 void riscv_cpu::FSQRT_D()
 {
-    fclearexcept();
+    fsetround();
     f[rd].d = sqrt(f[rs1].d);
-    ftestexcept();
     if (isnan(f[rd].d))
     {
         f[rd].d = NAN;
@@ -175,7 +166,7 @@ void riscv_cpu::FMIN_D()
     {
         f[rd].d = fmin(f[rs1].d, f[rs2].d);
     }
-    fcsr.nv = (issignaling(f[rs1].d) || issignaling(f[rs2].d));
+    fcsr.nv |= (issignaling(f[rs1].d) || issignaling(f[rs2].d));
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FMAX_D()
@@ -204,11 +195,12 @@ void riscv_cpu::FMAX_D()
     {
         f[rd].d = fmax(f[rs1].d, f[rs2].d);
     }
-    fcsr.nv = (issignaling(f[rs1].d) || issignaling(f[rs2].d));
+    fcsr.nv |= (issignaling(f[rs1].d) || issignaling(f[rs2].d));
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FCVT_S_D()
 {
+    fsetround();
     f[rd].f = f[rs1].d;
     if (isnan(f[rd].f))
     {
@@ -229,123 +221,39 @@ void riscv_cpu::FCVT_D_S()
 //------------------------------------------------------------------------------
 void riscv_cpu::FCVT_W_D()
 {
-    double value = f[rs1].d;
-    if (value <= INT32_MIN || value == -INFINITY)
-    {
-        x[rd].s = int32_t(INT32_MIN);
-        fcsr.fflags = 0;
-        fcsr.nv = true;
-        return;
-    }
-    if (value >= INT32_MAX || value == INFINITY || isnan(value))
-    {
-        x[rd].s = int32_t(INT32_MAX);
-        fcsr.fflags = 0;
-        fcsr.nv = true;
-        return;
-    }
-    fclearexcept();
-    int frm = (funct3 == 0b111) ? fcsr.frm : funct3;
-    switch (frm)
-    {
-    case 0b000:
-        x[rd].s = fromfp(value, FP_INT_TONEAREST, 32);
-        break;
-    case 0b001:
-        x[rd].s = fromfp(value, FP_INT_TOWARDZERO, 32);
-        break;
-    case 0b010:
-        x[rd].s = fromfp(value, FP_INT_DOWNWARD, 32);
-        break;
-    case 0b011:
-        x[rd].s = fromfp(value, FP_INT_UPWARD, 32);
-        break;
-    case 0b100:
-        x[rd].s = fromfp(value, FP_INT_TONEARESTFROMZERO, 32);
-        break;
-    case 0b101:
-    case 0b110:
-    case 0b111:
-        HINT();
-        break;
-    }
-    ftestexcept();
+    if (rounding() > 0b100)
+        return HINT();
+    x[rd].s = int32_t(fcvt(f[rs1].d, 32));
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FCVT_WU_D()
 {
-    double value = f[rs1].d;
-    if (value <= -1.0 || value == -INFINITY)
-    {
-        x[rd].u = 0;
-        fcsr.fflags = 0;
-        fcsr.nv = true;
-        return;
-    }
-    if (value >= UINT32_MAX || value == INFINITY || isnan(value))
-    {
-        x[rd].u = int32_t(UINT32_MAX);
-        fcsr.fflags = 0;
-        fcsr.nv = true;
-        return;
-    }
-    fclearexcept();
-    int frm = (funct3 == 0b111) ? fcsr.frm : funct3;
-    switch (frm)
-    {
-    case 0b000:
-        x[rd].u = int32_t(ufromfp(value, FP_INT_TONEAREST, 32));
-        break;
-    case 0b001:
-        x[rd].u = int32_t(ufromfp(value, FP_INT_TOWARDZERO, 32));
-        break;
-    case 0b010:
-        x[rd].u = int32_t(ufromfp(value, FP_INT_DOWNWARD, 32));
-        break;
-    case 0b011:
-        x[rd].u = int32_t(ufromfp(value, FP_INT_UPWARD, 32));
-        break;
-    case 0b100:
-        x[rd].u = int32_t(ufromfp(value, FP_INT_TONEARESTFROMZERO, 32));
-        break;
-    case 0b101:
-    case 0b110:
-    case 0b111:
-        HINT();
-        break;
-    }
-    ftestexcept();
+    if (rounding() > 0b100)
+        return HINT();
+    x[rd].s = int32_t(fcvtu(f[rs1].d, 32));
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FMV_X_D()
 {
-    if ((f[rs1].u64 & 0xFFFFFFFF00000000ull) == 0xFFFFFFFF00000000ull)
-    {
-        if (isnan(f[rs1].f))
-        {
-            x[rd].u = f[rs1].u64 & 0xFFFFFFFFFFC00000ull;
-            return;
-        }
-    }
     x[rd].u = f[rs1].u64;
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FEQ_D()
 {
     x[rd].u = (f[rs1].d == f[rs2].d);
-    fcsr.nv = (issignaling(f[rs1].d) || issignaling(f[rs2].d));
+    fcsr.nv |= (issignaling(f[rs1].d) || issignaling(f[rs2].d));
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FLT_D()
 {
     x[rd].u = (f[rs1].d < f[rs2].d);
-    fcsr.nv = (isnan(f[rs1].d) || isnan(f[rs2].d));
+    fcsr.nv |= (isnan(f[rs1].d) || isnan(f[rs2].d));
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FLE_D()
 {
     x[rd].u = (f[rs1].d <= f[rs2].d);
-    fcsr.nv = (isnan(f[rs1].d) || isnan(f[rs2].d));
+    fcsr.nv |= (isnan(f[rs1].d) || isnan(f[rs2].d));
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FCLASS_D()
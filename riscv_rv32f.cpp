@@ -5,8 +5,8 @@
 // December 13, 2019
 //==============================================================================
 
+#include <math.h>
 #include "riscv_cpu.h"
-#include "riscv_float.h"
 
 #if RISCV_HAVE_SINGLE
 //------------------------------------------------------------------------------
@@ -28,9 +28,8 @@ void riscv_cpu::FSW()
 //------------------------------------------------------------------------------
 void riscv_cpu::FMADD_S()
 {
-    fclearexcept();
+    fsetround();
     f[rd].f = fmaf(f[rs1].f, f[rs2].f, f[rs3].f);
-    ftestexcept();
     if (isnan(f[rd].f))
     {
         f[rd].f = NAN;
@@ -40,9 +39,8 @@ void riscv_cpu::FMADD_S()
 //------------------------------------------------------------------------------
 void riscv_cpu::FMSUB_S()
 {
-    fclearexcept();
+    fsetround();
     f[rd].f = fmaf(f[rs1].f, f[rs2].f, -f[rs3].f);
-    ftestexcept();
     if (isnan(f[rd].f))
     {
         f[rd].f = NAN;
@@ -52,9 +50,8 @@ void riscv_cpu::FMSUB_S()
 //------------------------------------------------------------------------------
 void riscv_cpu::FNMSUB_S()
 {
-    fclearexcept();
-    f[rd].f = -fmaf(f[rs1].f, f[rs2].f, -f[rs3].f);;
-    ftestexcept();
+    fsetround();
+    f[rd].f = fmaf(-f[rs1].f, f[rs2].f, f[rs3].f);
     if (isnan(f[rd].f))
     {
         f[rd].f = NAN;
@@ -65,9 +62,8 @@ void riscv_cpu::FNMSUB_S()
 //------------------------------------------------------------------------------
 void riscv_cpu::FNMADD_S()
 {
-    fclearexcept();
-    f[rd].f = -fmaf(f[rs1].f, f[rs2].f, f[rs3].f);
-    ftestexcept();
+    fsetround();
+    f[rd].f = fmaf(-f[rs1].f, f[rs2].f, -f[rs3].f);
     if (isnan(f[rd].f))
     {
         f[rd].f = NAN;
@@ -77,9 +73,8 @@ void riscv_cpu::FNMADD_S()
 //------------------------------------------------------------------------------
 void riscv_cpu::FADD_S()
 {
-    fclearexcept();
+    fsetround();
     f[rd].f = f[rs1].f + f[rs2].f;
-    ftestexcept();
     if (isnan(f[rd].f))
     {
         f[rd].f = NAN;
@@ -89,9 +84,8 @@ void riscv_cpu::FADD_S()
 //------------------------------------------------------------------------------
 void riscv_cpu::FSUB_S()
 {
-    fclearexcept();
+    fsetround();
     f[rd].f = f[rs1].f - f[rs2].f;
-    ftestexcept();
     if (isnan(f[rd].f))
     {
         f[rd].f = NAN;
@@ -101,9 +95,8 @@ void riscv_cpu::FSUB_S()
 //------------------------------------------------------------------------------
 void riscv_cpu::FMUL_S()
 {
-    fclearexcept();
+    fsetround();
     f[rd].f = f[rs1].f * f[rs2].f;
-    ftestexcept();
     if (isnan(f[rd].f))
     {
         f[rd].f = NAN;
@@ -113,9 +106,8 @@ void riscv_cpu::FMUL_S()
 //------------------------------------------------------------------------------
 void riscv_cpu::FDIV_S()
 {
-    fclearexcept();
+    fsetround();
     f[rd].f = f[rs1].f / f[rs2].f;
-    ftestexcept();
     if (isnan(f[rd].f))
     {
         f[rd].f = NAN;
@@ -125,9 +117,8 @@ void riscv_cpu::FDIV_S()
 //------------------------------------------------------------------------------
 void riscv_cpu::FSQRT_S()
 {
-    fclearexcept();
+    fsetround();
     f[rd].f = sqrtf(f[rs1].f);
-    ftestexcept();
     if (isnan(f[rd].f))
     {
         f[rd].f = NAN;
@@ -182,7 +173,7 @@ void riscv_cpu::FMIN_S()
     {
         f[rd].f = fminf(f[rs1].f, f[rs2].f);
     }
-    fcsr.nv = (issignaling(f[rs1].f) || issignaling(f[rs2].f));
+    fcsr.nv |= (issignaling(f[rs1].f) || issignaling(f[rs2].f));
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FMAX_S()
@@ -211,130 +202,44 @@ void riscv_cpu::FMAX_S()
     {
         f[rd].f = fmaxf(f[rs1].f, f[rs2].f);
     }
-    fcsr.nv = (issignaling(f[rs1].f) || issignaling(f[rs2].f));
+    fcsr.nv |= (issignaling(f[rs1].f) || issignaling(f[rs2].f));
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FCVT_W_S()
 {
-    float value = f[rs1].f;
-    if (value <= INT32_MIN || value == -INFINITY)
-    {
-        x[rd].s = int32_t(INT32_MIN);
-        fcsr.fflags = 0;
-        fcsr.nv = true;
-        return;
-    }
-    if (value >= INT32_MAX || value == INFINITY || isnan(value))
-    {
-        x[rd].s = int32_t(INT32_MAX);
-        fcsr.fflags = 0;
-        fcsr.nv = true;
-        return;
-    }
-    fclearexcept();
-    int frm = (funct3 == 0b111) ? fcsr.frm : funct3;
-    switch (frm)
-    {
-    case 0b000:
-        x[rd].s = fromfp(value, FP_INT_TONEAREST, 32);
-        break;
-    case 0b001:
-        x[rd].s = fromfp(value, FP_INT_TOWARDZERO, 32);
-        break;
-    case 0b010:
-        x[rd].s = fromfp(value, FP_INT_DOWNWARD, 32);
-        break;
-    case 0b011:
-        x[rd].s = fromfp(value, FP_INT_UPWARD, 32);
-        break;
-    case 0b100:
-        x[rd].s = fromfp(value, FP_INT_TONEARESTFROMZERO, 32);
-        break;
-    case 0b101:
-    case 0b110:
-    case 0b111:
-        HINT();
-        break;
-    }
-    ftestexcept();
+    if (rounding() > 0b100)
+        return HINT();
+    x[rd].s = int32_t(fcvt(f[rs1].f, 32));
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FCVT_WU_S()
 {
-    float value = f[rs1].f;
-    if (value <= -1.0f || value == -INFINITY)
-    {
-        x[rd].u = 0;
-        fcsr.fflags = 0;
-        fcsr.nv = true;
-        return;
-    }
-    if (value >= UINT32_MAX || value == INFINITY || isnan(value))
-    {
-        x[rd].u = int32_t(UINT32_MAX);
-        fcsr.fflags = 0;
-        fcsr.nv = true;
-        return;
-    }
-    fclearexcept();
-    int frm = (funct3 == 0b111) ? fcsr.frm : funct3;
-    switch (frm)
-    {
-    case 0b000:
-        x[rd].u = int32_t(ufromfp(value, FP_INT_TONEAREST, 32));
-        break;
-    case 0b001:
-        x[rd].u = int32_t(ufromfp(value, FP_INT_TOWARDZERO, 32));
-        break;
-    case 0b010:
-        x[rd].u = int32_t(ufromfp(value, FP_INT_DOWNWARD, 32));
-        break;
-    case 0b011:
-        x[rd].u = int32_t(ufromfp(value, FP_INT_UPWARD, 32));
-        break;
-    case 0b100:
-        x[rd].u = int32_t(ufromfp(value, FP_INT_TONEARESTFROMZERO, 32));
-        break;
-    case 0b101:
-    case 0b110:
-    case 0b111:
-        HINT();
-        break;
-    }
-    ftestexcept();
+    if (rounding() > 0b100)
+        return HINT();
+    x[rd].s = int32_t(fcvtu(f[rs1].f, 32));
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FMV_X_W()
 {
-#if RISCV_HAVE_DOUBLE
-    if ((f[rs1].u64 & 0xFFFFFFFF00000000ull) == 0xFFFFFFFF00000000ull)
-    {
-        if (isnan(f[rs1].f))
-        {
-            x[rd].u = int32_t(f[rs1].u & 0xFFC00000);
-            return;
-        }
-    }
-#endif
     x[rd].s = f[rs1].s32;
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FEQ_S()
 {
     x[rd].u = (f[rs1].f == f[rs2].f);
-    fcsr.nv = (issignaling(f[rs1].f) || issignaling(f[rs2].f));
+    fcsr.nv |= (issignaling(f[rs1].f) || issignaling(f[rs2].f));
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FLT_S()
 {
     x[rd].u = (f[rs1].f < f[rs2].f);
-    fcsr.nv = (isnan(f[rs1].f) || isnan(f[rs2].f));
+    fcsr.nv |= (isnan(f[rs1].f) || isnan(f[rs2].f));
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FLE_S()
 {
     x[rd].u = (f[rs1].f <= f[rs2].f);
-    fcsr.nv = (isnan(f[rs1].f) || isnan(f[rs2].f));
+    fcsr.nv |= (isnan(f[rs1].f) || isnan(f[rs2].f));
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FCLASS_S()
@@ -359,11 +264,13 @@ void riscv_cpu::FCLASS_S()
 //------------------------------------------------------------------------------
 void riscv_cpu::FCVT_S_W()
 {
+    fsetround();
     f[rd].f = x[rs1].s32;
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FCVT_S_WU()
 {
+    fsetround();
     f[rd].f = x[rs1].u32;
 }
 //------------------------------------------------------------------------------
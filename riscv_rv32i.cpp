@@ -21,14 +21,14 @@ void riscv_cpu::AUIPC()
 void riscv_cpu::JAL()
 {
     uintptr_t base = pc;
-    x[rd] = pc + 4;
+    x[rd] = pc + length;
     pc = base + simmJ();
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::JALR()
 {
     uintptr_t base = x[rs1];
-    x[rd] = pc + 4;
+    x[rd] = pc + length;
     pc = base + simmI();
 }
 //------------------------------------------------------------------------------
@@ -222,11 +222,17 @@ void riscv_cpu::FENCE()
 //------------------------------------------------------------------------------
 void riscv_cpu::ECALL()
 {
+    ftestexcept();
+    fsetround(0b000);
     environmentCall(*this);
+    fclearexcept();
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::EBREAK()
 {
+    ftestexcept();
+    fsetround(0b000);
     environmentBreakpoint(*this);
+    fclearexcept();
 }
 //------------------------------------------------------------------------------
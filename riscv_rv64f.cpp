@@ -5,108 +5,34 @@
 // December 13, 2019
 //==============================================================================
 
+#include <math.h>
 #include "riscv_cpu.h"
-#include "riscv_float.h"
 
 #if RISCV_HAVE_SINGLE
 //------------------------------------------------------------------------------
 void riscv_cpu::FCVT_L_S()
 {
-    float value = f[rs1].f;
-    if (value <= INT64_MIN || value == -INFINITY)
-    {
-        x[rd].s = int64_t(INT64_MIN);
-        fcsr.fflags = 0;
-        fcsr.nv = true;
-        return;
-    }
-    if (value >= INT64_MAX || value == INFINITY || isnan(value))
-    {
-        x[rd].s = int64_t(INT64_MAX);
-        fcsr.fflags = 0;
-        fcsr.nv = true;
-        return;
-    }
-    fclearexcept();
-    int frm = (funct3 == 0b111) ? fcsr.frm : funct3;
-    switch (frm)
-    {
-    case 0b000:
-        x[rd].s = fromfp(value, FP_INT_TONEAREST, 64);
-        break;
-    case 0b001:
-        x[rd].s = fromfp(value, FP_INT_TOWARDZERO, 64);
-        break;
-    case 0b010:
-        x[rd].s = fromfp(value, FP_INT_DOWNWARD, 64);
-        break;
-    case 0b011:
-        x[rd].s = fromfp(value, FP_INT_UPWARD, 64);
-        break;
-    case 0b100:
-        x[rd].s = fromfp(value, FP_INT_TONEARESTFROMZERO, 64);
-        break;
-    case 0b101:
-    case 0b110:
-    case 0b111:
-        HINT();
-        break;
-    }
-    ftestexcept();
+    if (rounding() > 0b100)
+        return HINT();
+    x[rd].s = fcvt(f[rs1].f, 64);
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FCVT_LU_S()
 {
-    float value = f[rs1].f;
-    if (value <= -1.0f || value == -INFINITY)
-    {
-        x[rd].u = uint64_t(0);
-        fcsr.fflags = 0;
-        fcsr.nv = true;
-        return;
-    }
-    if (value >= UINT64_MAX || value == INFINITY || isnan(value))
-    {
-        x[rd].u = uint64_t(UINT64_MAX);
-        fcsr.fflags = 0;
-        fcsr.nv = true;
-        return;
-    }
-    fclearexcept();
-    int frm = (funct3 == 0b111) ? fcsr.frm : funct3;
-    switch (frm)
-    {
-    case 0b000:
-        x[rd].u = ufromfp(value, FP_INT_TONEAREST, 64);
-        break;
-    case 0b001:
-        x[rd].u = ufromfp(value, FP_INT_TOWARDZERO, 64);
-        break;
-    case 0b010:
-        x[rd].u = ufromfp(value, FP_INT_DOWNWARD, 64);
-        break;
-    case 0b011:
-        x[rd].u = ufromfp(value, FP_INT_UPWARD, 64);
-        break;
-    case 0b100:
-        x[rd].u = ufromfp(value, FP_INT_TONEARESTFROMZERO, 64);
-        break;
-    case 0b101:
-    case 0b110:
-    case 0b111:
-        HINT();
-        break;
-    }
-    ftestexcept();
+    if (rounding() > 0b100)
+        return HINT();
+    x[rd].u = fcvtu(f[rs1].f, 64);
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FCVT_S_L()
 {
+    fsetround();
     f[rd].f = x[rs1].s64;
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::FCVT_S_LU()
 {
+    fsetround();
     f[rd].f = x[rs1].u64;
 }
 //------------------------------------------------------------------------------
@@ -0,0 +1,216 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include "riscv_instruction.h"
+
+//------------------------------------------------------------------------------
+// Chapter 16: "C" Standard Extension for Compressed Instructions
+//------------------------------------------------------------------------------
+// Every RV64C instruction is expanded into the 32-bit instruction it stands
+// for. Reserved encodings expand into custom-0, which executes as a HINT.
+//------------------------------------------------------------------------------
+static inline uint32_t bits(uint32_t c, int high, int low)
+{
+    return (c >> low) & ((1u << (high - low + 1)) - 1);
+}
+//------------------------------------------------------------------------------
+static inline uint32_t sext(uint32_t value, int width)
+{
+    return uint32_t(int32_t(value << (32 - width)) >> (32 - width));
+}
+//------------------------------------------------------------------------------
+static inline uint32_t R(uint32_t funct7, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode)
+{
+    return funct7 << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | opcode;
+}
+//------------------------------------------------------------------------------
+static inline uint32_t I(uint32_t imm, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode)
+{
+    return (imm & 0xFFF) << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | opcode;
+}
+//------------------------------------------------------------------------------
+static inline uint32_t S(uint32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t opcode)
+{
+    return bits(imm, 11, 5) << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | bits(imm, 4, 0) << 7 | opcode;
+}
+//------------------------------------------------------------------------------
+static inline uint32_t B(uint32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t opcode)
+{
+    return bits(imm, 12, 12) << 31 | bits(imm, 10, 5) << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | bits(imm, 4, 1) << 8 | bits(imm, 11, 11) << 7 | opcode;
+}
+//------------------------------------------------------------------------------
+static inline uint32_t J(uint32_t imm, uint32_t rd, uint32_t opcode)
+{
+    return bits(imm, 20, 20) << 31 | bits(imm, 10, 1) << 21 | bits(imm, 11, 11) << 20 | bits(imm, 19, 12) << 12 | rd << 7 | opcode;
+}
+//------------------------------------------------------------------------------
+enum
+{
+    LOAD        = 0b0000011,
+    LOAD_FP     = 0b0000111,
+    CUSTOM_0    = 0b0001011,
+    OP_IMM      = 0b0010011,
+    OP_IMM_32   = 0b0011011,
+    STORE       = 0b0100011,
+    STORE_FP    = 0b0100111,
+    OP          = 0b0110011,
+    LUI         = 0b0110111,
+    OP_32       = 0b0111011,
+    BRANCH      = 0b1100011,
+    JALR        = 0b1100111,
+    JAL         = 0b1101111,
+    SYSTEM      = 0b1110011,
+};
+//------------------------------------------------------------------------------
+uint32_t riscv_instruction::expand(uint32_t format)
+{
+    uint32_t c = format & 0xFFFF;
+
+    // Registers x8-x15 of the CIW, CL, CS, CA and CB formats
+    uint32_t rd_ = bits(c, 4, 2) + 8;
+    uint32_t rs1_ = bits(c, 9, 7) + 8;
+    uint32_t rd = bits(c, 11, 7);
+    uint32_t rs2 = bits(c, 6, 2);
+
+    // Immediates
+    uint32_t imm6 = sext(bits(c, 12, 12) << 5 | bits(c, 6, 2), 6);
+    uint32_t uimmW = bits(c, 12, 10) << 3 | bits(c, 6, 6) << 2 | bits(c, 5, 5) << 6;
+    uint32_t uimmD = bits(c, 12, 10) << 3 | bits(c, 6, 5) << 6;
+
+    switch (bits(c, 1, 0) << 3 | bits(c, 15, 13))
+    {
+    // Quadrant 0
+    case 0b00000:   // C.ADDI4SPN
+    {
+        uint32_t imm = bits(c, 12, 11) << 4 | bits(c, 10, 7) << 6 | bits(c, 6, 6) << 2 | bits(c, 5, 5) << 3;
+        if (imm == 0)
+            break;
+        return I(imm, 2, 0b000, rd_, OP_IMM);
+    }
+    case 0b00001:   // C.FLD
+        return I(uimmD, rs1_, 0b011, rd_, LOAD_FP);
+    case 0b00010:   // C.LW
+        return I(uimmW, rs1_, 0b010, rd_, LOAD);
+    case 0b00011:   // C.LD
+        return I(uimmD, rs1_, 0b011, rd_, LOAD);
+    case 0b00101:   // C.FSD
+        return S(uimmD, rd_, rs1_, 0b011, STORE_FP);
+    case 0b00110:   // C.SW
+        return S(uimmW, rd_, rs1_, 0b010, STORE);
+    case 0b00111:   // C.SD
+        return S(uimmD, rd_, rs1_, 0b011, STORE);
+
+    // Quadrant 1
+    case 0b01000:   // C.ADDI
+        return I(imm6, rd, 0b000, rd, OP_IMM);
+    case 0b01001:   // C.ADDIW
+        if (rd == 0)
+            break;
+        return I(imm6, rd, 0b000, rd, OP_IMM_32);
+    case 0b01010:   // C.LI
+        return I(imm6, 0, 0b000, rd, OP_IMM);
+    case 0b01011:
+        if (rd == 2)
+        {
+            // C.ADDI16SP
+            uint32_t imm = sext(bits(c, 12, 12) << 9 | bits(c, 6, 6) << 4 | bits(c, 5, 5) << 6 | bits(c, 4, 3) << 7 | bits(c, 2, 2) << 5, 10);
+            if (imm == 0)
+                break;
+            return I(imm, 2, 0b000, 2, OP_IMM);
+        }
+        // C.LUI
+        if (imm6 == 0)
+            break;
+        return (imm6 << 12) | rd << 7 | LUI;
+    case 0b01100:
+        switch (bits(c, 11, 10))
+        {
+        case 0b00:  // C.SRLI
+            return I(bits(c, 12, 12) << 5 | rs2, rs1_, 0b101, rs1_, OP_IMM);
+        case 0b01:  // C.SRAI
+            return I(0x400 | bits(c, 12, 12) << 5 | rs2, rs1_, 0b101, rs1_, OP_IMM);
+        case 0b10:  // C.ANDI
+            return I(imm6, rs1_, 0b111, rs1_, OP_IMM);
+        case 0b11:
+            switch (bits(c, 12, 12) << 2 | bits(c, 6, 5))
+            {
+            case 0b000: return R(0b0100000, rd_, rs1_, 0b000, rs1_, OP);       // C.SUB
+            case 0b001: return R(0b0000000, rd_, rs1_, 0b100, rs1_, OP);       // C.XOR
+            case 0b010: return R(0b0000000, rd_, rs1_, 0b110, rs1_, OP);       // C.OR
+            case 0b011: return R(0b0000000, rd_, rs1_, 0b111, rs1_, OP);       // C.AND
+            case 0b100: return R(0b0100000, rd_, rs1_, 0b000, rs1_, OP_32);    // C.SUBW
+            case 0b101: return R(0b0000000, rd_, rs1_, 0b000, rs1_, OP_32);    // C.ADDW
+            }
+            break;
+        }
+        break;
+    case 0b01101:   // C.J
+    {
+        uint32_t imm = sext(bits(c, 12, 12) << 11 | bits(c, 11, 11) << 4 | bits(c, 10, 9) << 8 | bits(c, 8, 8) << 10 |
+                            bits(c, 7, 7) << 6 | bits(c, 6, 6) << 7 | bits(c, 5, 3) << 1 | bits(c, 2, 2) << 5, 12);
+        return J(imm, 0, JAL);
+    }
+    case 0b01110:   // C.BEQZ
+    case 0b01111:   // C.BNEZ
+    {
+        uint32_t imm = sext(bits(c, 12, 12) << 8 | bits(c, 11, 10) << 3 | bits(c, 6, 5) << 6 | bits(c, 4, 3) << 1 | bits(c, 2, 2) << 5, 9);
+        return B(imm, 0, rs1_, bits(c, 13, 13), BRANCH);
+    }
+
+    // Quadrant 2
+    case 0b10000:   // C.SLLI
+        return I(bits(c, 12, 12) << 5 | rs2, rd, 0b001, rd, OP_IMM);
+    case 0b10001:   // C.FLDSP
+        return I(bits(c, 12, 12) << 5 | bits(c, 6, 5) << 3 | bits(c, 4, 2) << 6, 2, 0b011, rd, LOAD_FP);
+    case 0b10010:   // C.LWSP
+        if (rd == 0)
+            break;
+        return I(bits(c, 12, 12) << 5 | bits(c, 6, 4) << 2 | bits(c, 3, 2) << 6, 2, 0b010, rd, LOAD);
+    case 0b10011:   // C.LDSP
+        if (rd == 0)
+            break;
+        return I(bits(c, 12, 12) << 5 | bits(c, 6, 5) << 3 | bits(c, 4, 2) << 6, 2, 0b011, rd, LOAD);
+    case 0b10100:
+        if (bits(c, 12, 12) == 0)
+        {
+            if (rs2)                            // C.MV
+                return R(0b0000000, rs2, 0, 0b000, rd, OP);
+            if (rd == 0)
+                break;
+            return I(0, rd, 0b000, 0, JALR);    // C.JR
+        }
+        if (rs2)                                // C.ADD
+            return R(0b0000000, rs2, rd, 0b000, rd, OP);
+        if (rd == 0)                            // C.EBREAK
+            return I(1, 0, 0b000, 0, SYSTEM);
+        return I(0, rd, 0b000, 1, JALR);        // C.JALR
+    case 0b10101:   // C.FSDSP
+        return S(bits(c, 12, 10) << 3 | bits(c, 9, 7) << 6, rs2, 2, 0b011, STORE_FP);
+    case 0b10110:   // C.SWSP
+        return S(bits(c, 12, 9) << 2 | bits(c, 8, 7) << 6, rs2, 2, 0b010, STORE);
+    case 0b10111:   // C.SDSP
+        return S(bits(c, 12, 10) << 3 | bits(c, 9, 7) << 6, rs2, 2, 0b011, STORE);
+    }
+
+    return CUSTOM_0;
+}
+//------------------------------------------------------------------------------
+// expand() of every 16-bit code, built once before main() so interpreting a
+// compressed instruction costs one load
+//------------------------------------------------------------------------------
+static const uint32_t* build()
+{
+    static uint32_t table[1 << 16];
+    for (uint32_t c = 0; c < (1 << 16); ++c)
+    {
+        table[c] = riscv_instruction::expand(c);
+    }
+    return table;
+}
+//------------------------------------------------------------------------------
+const uint32_t* const riscv_instruction::expansion = build();
+//------------------------------------------------------------------------------
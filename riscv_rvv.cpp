@@ -0,0 +1,1008 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <math.h>
+#include <string.h>
+#include "riscv_cpu.h"
+#include "riscv_float.h"
+#include "riscv_simd.h"
+
+#if RISCV_HAVE_VECTOR
+//------------------------------------------------------------------------------
+// "V" Standard Extension for Vector Operations, Version 1.0
+//------------------------------------------------------------------------------
+// A group of LMUL registers is contiguous in v[], so element i of a group is
+// element i of its first register. vstart is always 0, tail and masked-off
+// elements are left undisturbed. Element-wise integer and floating-point
+// arithmetic runs through the host SIMD kernels, everything else one element
+// at a time. Floating-point elements are 32-bit, and 64-bit with
+// RISCV_HAVE_DOUBLE. Reserved encodings and instructions with vill set
+// execute as HINT. Fixed-point, widening and narrowing instructions are not
+// implemented.
+//------------------------------------------------------------------------------
+static const uintptr_t VILL = uintptr_t(1) << (sizeof(uintptr_t) * 8 - 1);
+enum { VLENB = riscv_cpu::VLENB };
+
+//------------------------------------------------------------------------------
+static int vsew(uintptr_t vtype)
+{
+    // log2 of SEW in bytes
+    return (vtype >> 3) & 0b111;
+}
+//------------------------------------------------------------------------------
+static int vlmul(uintptr_t vtype)
+{
+    // log2 of LMUL, -4 is reserved
+    return int32_t(uint32_t(vtype) << 29) >> 29;
+}
+//------------------------------------------------------------------------------
+static size_t vlmax(uintptr_t vtype)
+{
+    // 0 for any vtype which sets vill, SEW is at most LMUL * ELEN
+    int sew = vsew(vtype);
+    int lmul = vlmul(vtype);
+    if ((vtype >> 8) || sew > 3 || lmul < -3 || sew > 3 + lmul)
+        return 0;
+    int shift = lmul - sew;
+    return shift >= 0 ? size_t(VLENB) << shift : size_t(VLENB) >> -shift;
+}
+//------------------------------------------------------------------------------
+static bool vgroup(unsigned int reg, int emul)
+{
+    // Register groups are aligned to their size
+    if (emul < -3 || emul > 3)
+        return false;
+    unsigned int count = emul > 0 ? 1u << emul : 1u;
+    return (reg & (count - 1)) == 0;
+}
+//------------------------------------------------------------------------------
+static bool vbit(const uint8_t* mask, size_t i)
+{
+    return (mask[i >> 3] >> (i & 7)) & 1;
+}
+//------------------------------------------------------------------------------
+static void vsetbit(uint8_t* mask, size_t i, bool value)
+{
+    mask[i >> 3] = uint8_t((mask[i >> 3] & ~(1u << (i & 7))) | (unsigned(value) << (i & 7)));
+}
+//------------------------------------------------------------------------------
+template <typename F>
+static void integer(int sew, F f)
+{
+    switch (sew)
+    {
+    case 0: f(uint8_t(), int8_t());     break;
+    case 1: f(uint16_t(), int16_t());   break;
+    case 2: f(uint32_t(), int32_t());   break;
+    case 3: f(uint64_t(), int64_t());   break;
+    }
+}
+//------------------------------------------------------------------------------
+template <typename F>
+static bool floating(int sew, F f)
+{
+    switch (sew)
+    {
+    case 2: f(float(), uint32_t(), int32_t());      return true;
+#if RISCV_HAVE_DOUBLE
+    case 3: f(double(), uint64_t(), int64_t());     return true;
+#endif
+    }
+    return false;
+}
+//------------------------------------------------------------------------------
+static void fget(float& value, const riscv_cpu::register_t& reg)
+{
+    value = reg.f;
+}
+//------------------------------------------------------------------------------
+static void fset(riscv_cpu::register_t& reg, float value)
+{
+    reg.f = value;
+}
+//------------------------------------------------------------------------------
+#if RISCV_HAVE_DOUBLE
+static void fget(double& value, const riscv_cpu::register_t& reg)
+{
+    value = reg.d;
+}
+//------------------------------------------------------------------------------
+static void fset(riscv_cpu::register_t& reg, double value)
+{
+    reg.d = value;
+}
+#endif
+//------------------------------------------------------------------------------
+template <typename T>
+static T fminimum(T a, T b)
+{
+    if (a != a)
+        return b != b ? T(NAN) : b;
+    if (b != b)
+        return a;
+    if (a == b)
+        return signbit(a) ? a : b;
+    return a < b ? a : b;
+}
+//------------------------------------------------------------------------------
+template <typename T>
+static T fmaximum(T a, T b)
+{
+    if (a != a)
+        return b != b ? T(NAN) : b;
+    if (b != b)
+        return a;
+    if (a == b)
+        return signbit(a) ? b : a;
+    return a > b ? a : b;
+}
+//------------------------------------------------------------------------------
+static void vsplat(uint8_t* d, uintptr_t value, int sew, size_t count)
+{
+    integer(sew, [&](auto u, auto)
+    {
+        typedef decltype(u) U;
+        for (size_t i = 0; i < count; ++i)
+            ((U*)d)[i] = U(value);
+    });
+}
+//------------------------------------------------------------------------------
+size_t riscv_cpu::vaccess(uintptr_t& address) const
+{
+    // Unit-stride accesses report their whole span, strided and indexed
+    // accesses their first element
+    int eew = (funct3 == 0b000) ? 0 : funct3 - 4;
+    address = x[rs1].u;
+    if (mop == 0b00 && rs2 == 0b01000)
+        return (nf + 1) * VLENB;
+    if ((vtype & VILL) || vl == 0)
+        return 0;
+    if (mop == 0b00 && rs2 == 0b01011)
+        return (vl + 7) / 8;
+    if (mop == 0b00)
+        return vl * (nf + 1) << eew;
+    if (mop == 0b10)
+        return size_t(1) << eew;
+    uint64_t offset = 0;
+    memcpy(&offset, v[rs2], size_t(1) << eew);
+    address += offset;
+    return size_t(1) << vsew(vtype);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::vset(uintptr_t avl, uintptr_t type)
+{
+    size_t max = vlmax(type);
+    if (max == 0)
+    {
+        vtype = VILL;
+        vl = 0;
+    }
+    else
+    {
+        vtype = type;
+        vl = avl < max ? avl : max;
+    }
+    x[rd] = vl;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::vmemory(bool store)
+{
+    int eew = (funct3 == 0b000) ? 0 : funct3 - 4;
+    size_t fields = nf + 1;
+    uint8_t* memory = (uint8_t*)x[rs1].u;
+    if (mew)
+        return;
+
+    // Whole registers ignore vtype and vl
+    if (mop == 0b00 && rs2 == 0b01000)
+    {
+        if ((fields & (fields - 1)) || (rd & (fields - 1)))
+            return;
+        if (store)
+            memcpy(memory, v[rd], fields * VLENB);
+        else
+            memcpy(v[rd], memory, fields * VLENB);
+        return;
+    }
+    if (vtype & VILL)
+        return;
+
+    // Mask
+    if (mop == 0b00 && rs2 == 0b01011)
+    {
+        if (eew != 0 || fields != 1)
+            return;
+        if (store)
+            memcpy(memory, v[rd], (vl + 7) / 8);
+        else
+            memcpy(v[rd], memory, (vl + 7) / 8);
+        return;
+    }
+
+    // Unit-stride, fault-only-first loads never fault here
+    if (mop == 0b00 && rs2 != 0b00000 && (rs2 != 0b10000 || store))
+        return;
+
+    int sew = vsew(vtype);
+    int lmul = vlmul(vtype);
+    bool indexed = mop & 1;
+    int emul = indexed ? lmul : eew - sew + lmul;
+    size_t count = emul > 0 ? size_t(1) << emul : 1;
+    if (vgroup(rd, emul) == false || fields * count > 8 || rd + fields * count > 32)
+        return;
+    if (indexed && vgroup(rs2, eew - sew + lmul) == false)
+        return;
+
+    size_t size = size_t(1) << (indexed ? sew : eew);
+    uintptr_t stride = (mop == 0b10) ? x[rs2].u : fields * size;
+    if (mop == 0b00 && fields == 1 && vm)
+    {
+        if (store)
+            memcpy(memory, v[rd], vl * size);
+        else
+            memcpy(v[rd], memory, vl * size);
+        return;
+    }
+    for (size_t i = 0; i < vl; ++i)
+    {
+        if (vm == 0 && vbit(v[0], i) == false)
+            continue;
+        uint8_t* address = memory + i * stride;
+        if (indexed)
+        {
+            uint64_t offset = 0;
+            memcpy(&offset, v[rs2] + (i << eew), size_t(1) << eew);
+            address = memory + offset;
+        }
+        for (size_t f = 0; f < fields; ++f)
+        {
+            uint8_t* element = v[rd + f * count] + i * size;
+            if (store)
+                memcpy(address + f * size, element, size);
+            else
+                memcpy(element, address + f * size, size);
+        }
+    }
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::vwrite(const uint8_t* result)
+{
+    // Active elements of the destination group
+    size_t size = size_t(1) << vsew(vtype);
+    if (vm)
+    {
+        memcpy(v[rd], result, vl * size);
+        return;
+    }
+    for (size_t i = 0; i < vl; ++i)
+    {
+        if (vbit(v[0], i))
+            memcpy(v[rd] + i * size, result + i * size, size);
+    }
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::vopi(const uint8_t* b, uintptr_t scalar)
+{
+    // vmv<nr>r.v ignores vtype
+    if (funct6 == 0b100111)
+    {
+        size_t count = scalar + 1;
+        if (funct3 != 0b011 || (count & (count - 1)) || count > 8 || ((rd | rs2) & (count - 1)))
+            return;
+        memmove(v[rd], v[rs2], count * VLENB);
+        return;
+    }
+
+    int sew = vsew(vtype);
+    int lmul = vlmul(vtype);
+    bool mask = (funct6 >> 3) == 0b011;
+    if ((vtype & VILL) || vgroup(rd, mask ? 0 : lmul) == false || vgroup(rs2, lmul) == false)
+        return;
+    if (funct3 == 0b000 && vgroup(rs1, lmul) == false)
+        return;
+
+    const uint8_t* a = v[rs2];
+    size_t size = size_t(1) << sew;
+    alignas(32) uint8_t result[8 * VLENB];
+    riscv_simd::kernel* kernel = nullptr;
+    switch (funct6)
+    {
+    case 0b000000:  kernel = simd->integer[riscv_simd::ADD][sew];   break;
+    case 0b000010:  kernel = simd->integer[riscv_simd::SUB][sew];   break;
+    case 0b000011:  kernel = simd->integer[riscv_simd::RSUB][sew];  break;
+    case 0b000100:  kernel = simd->integer[riscv_simd::MINU][sew];  break;
+    case 0b000101:  kernel = simd->integer[riscv_simd::MIN][sew];   break;
+    case 0b000110:  kernel = simd->integer[riscv_simd::MAXU][sew];  break;
+    case 0b000111:  kernel = simd->integer[riscv_simd::MAX][sew];   break;
+    case 0b001001:  kernel = simd->integer[riscv_simd::AND][sew];   break;
+    case 0b001010:  kernel = simd->integer[riscv_simd::OR][sew];    break;
+    case 0b001011:  kernel = simd->integer[riscv_simd::XOR][sew];   break;
+    case 0b100101:  kernel = simd->integer[riscv_simd::SLL][sew];   break;
+    case 0b101000:  kernel = simd->integer[riscv_simd::SRL][sew];   break;
+    case 0b101001:  kernel = simd->integer[riscv_simd::SRA][sew];   break;
+    case 0b001100:  // vrgather
+        integer(sew, [&](auto u, auto)
+        {
+            typedef decltype(u) U;
+            size_t max = vlmax(vtype);
+            for (size_t i = 0; i < vl; ++i)
+            {
+                uintptr_t index = (funct3 == 0b000) ? ((U*)b)[i] : scalar;
+                ((U*)result)[i] = index < max ? ((U*)a)[index] : 0;
+            }
+        });
+        return vwrite(result);
+    case 0b001110:  // vslideup
+        memcpy(result, v[rd], vl * size);
+        for (size_t i = scalar; i < vl; ++i)
+            memcpy(result + i * size, a + (i - scalar) * size, size);
+        return vwrite(result);
+    case 0b001111:  // vslidedown
+    {
+        size_t max = vlmax(vtype);
+        for (size_t i = 0; i < vl; ++i)
+        {
+            if (scalar < max - i)
+                memcpy(result + i * size, a + (i + scalar) * size, size);
+            else
+                memset(result + i * size, 0, size);
+        }
+        return vwrite(result);
+    }
+    case 0b010111:  // vmerge, vmv.v
+        if (vm)
+        {
+            memmove(v[rd], b, vl * size);
+            return;
+        }
+        for (size_t i = 0; i < vl; ++i)
+            memcpy(result + i * size, (vbit(v[0], i) ? b : a) + i * size, size);
+        memcpy(v[rd], result, vl * size);
+        return;
+    case 0b011000:  // vmseq
+    case 0b011001:  // vmsne
+    case 0b011010:  // vmsltu
+    case 0b011011:  // vmslt
+    case 0b011100:  // vmsleu
+    case 0b011101:  // vmsle
+    case 0b011110:  // vmsgtu
+    case 0b011111:  // vmsgt
+    {
+        uint8_t bits[VLENB];
+        memcpy(bits, v[rd], VLENB);
+        integer(sew, [&](auto u, auto s)
+        {
+            typedef decltype(u) U;
+            typedef decltype(s) S;
+            for (size_t i = 0; i < vl; ++i)
+            {
+                if (vm == 0 && vbit(v[0], i) == false)
+                    continue;
+                U p = ((U*)a)[i];
+                U q = ((U*)b)[i];
+                bool value = false;
+                switch (funct6 & 0b111)
+                {
+                case 0b000: value = p == q;         break;
+                case 0b001: value = p != q;         break;
+                case 0b010: value = p < q;          break;
+                case 0b011: value = S(p) < S(q);    break;
+                case 0b100: value = p <= q;         break;
+                case 0b101: value = S(p) <= S(q);   break;
+                case 0b110: value = p > q;          break;
+                case 0b111: value = S(p) > S(q);    break;
+                }
+                vsetbit(bits, i, value);
+            }
+        });
+        memcpy(v[rd], bits, VLENB);
+        return;
+    }
+    default:
+        return;
+    }
+
+    kernel(vm ? v[rd] : result, a, b, nullptr, vl);
+    if (vm == 0)
+        vwrite(result);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::vopm(const uint8_t* b)
+{
+    int sew = vsew(vtype);
+    int lmul = vlmul(vtype);
+    if (vtype & VILL)
+        return;
+
+    const uint8_t* a = v[rs2];
+    size_t size = size_t(1) << sew;
+    alignas(32) uint8_t result[8 * VLENB];
+    switch (funct6)
+    {
+    case 0b000000:  // vredsum
+    case 0b000001:  // vredand
+    case 0b000010:  // vredor
+    case 0b000011:  // vredxor
+    case 0b000100:  // vredminu
+    case 0b000101:  // vredmin
+    case 0b000110:  // vredmaxu
+    case 0b000111:  // vredmax
+        if (funct3 != 0b010 || vgroup(rs2, lmul) == false || vl == 0)
+            return;
+        integer(sew, [&](auto u, auto s)
+        {
+            typedef decltype(u) U;
+            typedef decltype(s) S;
+            U sum = ((U*)b)[0];
+            for (size_t i = 0; i < vl; ++i)
+            {
+                if (vm == 0 && vbit(v[0], i) == false)
+                    continue;
+                U e = ((U*)a)[i];
+                switch (funct6)
+                {
+                case 0b000000: sum = sum + e;                   break;
+                case 0b000001: sum = sum & e;                   break;
+                case 0b000010: sum = sum | e;                   break;
+                case 0b000011: sum = sum ^ e;                   break;
+                case 0b000100: sum = e < sum ? e : sum;         break;
+                case 0b000101: sum = S(e) < S(sum) ? e : sum;   break;
+                case 0b000110: sum = e > sum ? e : sum;         break;
+                case 0b000111: sum = S(e) > S(sum) ? e : sum;   break;
+                }
+            }
+            ((U*)v[rd])[0] = sum;
+        });
+        return;
+    case 0b001110:  // vslide1up
+    case 0b001111:  // vslide1down
+        if (funct3 != 0b110 || vgroup(rd, lmul) == false || vgroup(rs2, lmul) == false)
+            return;
+        for (size_t i = 0; i < vl; ++i)
+        {
+            size_t j = (funct6 & 1) ? i + 1 : i - 1;
+            const uint8_t* source = (j < vl) ? a + j * size : b;
+            memcpy(result + i * size, source, size);
+        }
+        return vwrite(result);
+    case 0b010000:
+        if (funct3 == 0b110)
+        {
+            // vmv.s.x
+            if (rs2 == 0 && vl)
+                memcpy(v[rd], b, size);
+            return;
+        }
+        switch (rs1)
+        {
+        case 0b00000:   // vmv.x.s
+            integer(sew, [&](auto, auto s)
+            {
+                typedef decltype(s) S;
+                x[rd].s = ((S*)a)[0];
+            });
+            break;
+        case 0b10000:   // vcpop.m
+        {
+            size_t count = 0;
+            for (size_t i = 0; i < vl; ++i)
+                count += (vm || vbit(v[0], i)) && vbit(a, i);
+            x[rd] = count;
+            break;
+        }
+        case 0b10001:   // vfirst.m
+            x[rd].s = -1;
+            for (size_t i = 0; i < vl; ++i)
+            {
+                if ((vm || vbit(v[0], i)) && vbit(a, i))
+                {
+                    x[rd] = i;
+                    break;
+                }
+            }
+            break;
+        }
+        return;
+    case 0b010010:  // vzext, vsext
+    {
+        int factor = 4 - (rs1 >> 1);
+        if (funct3 != 0b010 || rs1 < 0b00010 || rs1 > 0b00111 || sew < factor)
+            return;
+        if (vgroup(rd, lmul) == false || vgroup(rs2, lmul - factor) == false)
+            return;
+        integer(sew - factor, [&](auto u, auto s)
+        {
+            typedef decltype(u) U;
+            typedef decltype(s) S;
+            for (size_t i = 0; i < vl; ++i)
+                vsplat(result + i * size, (rs1 & 1) ? uintptr_t(S(((U*)a)[i])) : ((U*)a)[i], sew, 1);
+        });
+        return vwrite(result);
+    }
+    case 0b010100:
+        if (funct3 != 0b010)
+            return;
+        if (rs1 >= 0b00001 && rs1 <= 0b00011)
+        {
+            // vmsbf.m, vmsof.m, vmsif.m
+            uint8_t bits[VLENB];
+            memcpy(bits, v[rd], VLENB);
+            bool before = true;
+            for (size_t i = 0; i < vl; ++i)
+            {
+                if (vm == 0 && vbit(v[0], i) == false)
+                    continue;
+                bool first = before && vbit(a, i);
+                switch (rs1)
+                {
+                case 0b00001: vsetbit(bits, i, before && first == false);   break;
+                case 0b00010: vsetbit(bits, i, first);                      break;
+                case 0b00011: vsetbit(bits, i, before);                     break;
+                }
+                before = before && first == false;
+            }
+            memcpy(v[rd], bits, VLENB);
+            return;
+        }
+        if (vgroup(rd, lmul) == false)
+            return;
+        switch (rs1)
+        {
+        case 0b10000:   // viota.m
+        {
+            size_t count = 0;
+            for (size_t i = 0; i < vl; ++i)
+            {
+                if (vm == 0 && vbit(v[0], i) == false)
+                    continue;
+                vsplat(result + i * size, count, sew, 1);
+                count += vbit(a, i);
+            }
+            return vwrite(result);
+        }
+        case 0b10001:   // vid.v
+            for (size_t i = 0; i < vl; ++i)
+                vsplat(result + i * size, i, sew, 1);
+            return vwrite(result);
+        }
+        return;
+    case 0b011000:  // vmandn
+    case 0b011001:  // vmand
+    case 0b011010:  // vmor
+    case 0b011011:  // vmxor
+    case 0b011100:  // vmorn
+    case 0b011101:  // vmnand
+    case 0b011110:  // vmnor
+    case 0b011111:  // vmxnor
+    {
+        if (funct3 != 0b010)
+            return;
+        auto logical = [this](unsigned int p, unsigned int q) -> unsigned int
+        {
+            switch (funct6 & 0b111)
+            {
+            case 0b000: return p & ~q;
+            case 0b001: return p & q;
+            case 0b010: return p | q;
+            case 0b011: return p ^ q;
+            case 0b100: return p | ~q;
+            case 0b101: return ~(p & q);
+            case 0b110: return ~(p | q);
+            default:    return ~(p ^ q);
+            }
+        };
+        uint8_t bits[VLENB];
+        memcpy(bits, v[rd], VLENB);
+        size_t full = vl / 8;
+        for (size_t i = 0; i < full; ++i)
+            bits[i] = uint8_t(logical(v[rs2][i], v[rs1][i]));
+        for (size_t i = full * 8; i < vl; ++i)
+            vsetbit(bits, i, (logical(v[rs2][i >> 3], v[rs1][i >> 3]) >> (i & 7)) & 1);
+        memcpy(v[rd], bits, VLENB);
+        return;
+    }
+    }
+
+    // Element-wise
+    if (vgroup(rd, lmul) == false || vgroup(rs2, lmul) == false)
+        return;
+    if (funct3 == 0b010 && vgroup(rs1, lmul) == false)
+        return;
+    riscv_simd::kernel* kernel = nullptr;
+    const void* operands[3] = { b, a, nullptr };
+    switch (funct6)
+    {
+    case 0b100000:  // vdivu
+    case 0b100001:  // vdiv
+    case 0b100010:  // vremu
+    case 0b100011:  // vrem
+        integer(sew, [&](auto u, auto s)
+        {
+            typedef decltype(u) U;
+            typedef decltype(s) S;
+            for (size_t i = 0; i < vl; ++i)
+            {
+                U p = ((U*)a)[i];
+                U q = ((U*)b)[i];
+                U r = 0;
+                bool overflow = S(p) == S(U(1) << (sizeof(U) * 8 - 1)) && S(q) == -1;
+                switch (funct6 & 0b11)
+                {
+                case 0b00: r = q ? U(p / q) : U(-1);                            break;
+                case 0b01: r = q ? overflow ? p : U(S(p) / S(q)) : U(-1);       break;
+                case 0b10: r = q ? U(p % q) : p;                                break;
+                case 0b11: r = q ? overflow ? 0 : U(S(p) % S(q)) : p;           break;
+                }
+                ((U*)result)[i] = r;
+            }
+        });
+        return vwrite(result);
+    case 0b100100:  // vmulhu
+    case 0b100110:  // vmulhsu
+    case 0b100111:  // vmulh
+        integer(sew, [&](auto u, auto s)
+        {
+            typedef decltype(u) U;
+            typedef decltype(s) S;
+            for (size_t i = 0; i < vl; ++i)
+            {
+                U p = ((U*)a)[i];
+                U q = ((U*)b)[i];
+                __int128 r;
+                switch (funct6)
+                {
+                case 0b100100: r = (unsigned __int128)p * q;    break;
+                case 0b100110: r = (__int128)S(p) * q;          break;
+                default:       r = (__int128)S(p) * S(q);       break;
+                }
+                ((U*)result)[i] = U(r >> (sizeof(U) * 8));
+            }
+        });
+        return vwrite(result);
+    case 0b100101:  // vmul
+        kernel = simd->integer[riscv_simd::MUL][sew];
+        operands[0] = a;
+        operands[1] = b;
+        break;
+    case 0b101001:  // vmadd
+    case 0b101011:  // vnmsub
+    case 0b101101:  // vmacc
+    case 0b101111:  // vnmsac
+        kernel = simd->integer[(funct6 & 0b10) ? riscv_simd::NMSAC : riscv_simd::MACC][sew];
+        if (funct6 & 0b100)
+        {
+            operands[2] = v[rd];
+        }
+        else
+        {
+            operands[1] = v[rd];
+            operands[2] = a;
+        }
+        break;
+    default:
+        return;
+    }
+
+    kernel(vm ? v[rd] : result, operands[0], operands[1], operands[2], vl);
+    if (vm == 0)
+        vwrite(result);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::vopf(const uint8_t* b)
+{
+    int sew = vsew(vtype);
+    int lmul = vlmul(vtype);
+    if ((vtype & VILL) || (sew != 2 && (sew != 3 || RISCV_HAVE_DOUBLE == 0)))
+        return;
+
+    const uint8_t* a = v[rs2];
+    size_t size = size_t(1) << sew;
+    alignas(32) uint8_t result[8 * VLENB];
+    fsetround(fcsr.frm);
+
+    // vfmv.f.s and vfmv.s.f
+    if (funct6 == 0b010000)
+    {
+        floating(sew, [&](auto t, auto, auto)
+        {
+            typedef decltype(t) T;
+            if (funct3 == 0b001 && rs1 == 0)
+                fset(f[rd], ((T*)a)[0]);
+            else if (funct3 == 0b101 && rs2 == 0 && vl)
+                memcpy(v[rd], b, size);
+        });
+        return;
+    }
+
+    // Reductions write element 0, compares a mask
+    bool reduction = (funct6 >> 3) == 0b000 && (funct6 & 1);
+    bool mask = (funct6 >> 3) == 0b011;
+    bool unary = funct6 == 0b010010 || funct6 == 0b010011;
+    if (vgroup(rd, (reduction || mask) ? 0 : lmul) == false || vgroup(rs2, lmul) == false)
+        return;
+    if (reduction && funct3 != 0b001)
+        return;
+    if (funct3 == 0b001 && reduction == false && unary == false && vgroup(rs1, lmul) == false)
+        return;
+
+    bool invalid = false;
+    bool inexact = false;
+    floating(sew, [&](auto t, auto u, auto s)
+    {
+        typedef decltype(t) T;
+        typedef decltype(u) U;
+        typedef decltype(s) S;
+        const T* p = (T*)a;
+        const T* q = (T*)b;
+        T* r = (T*)result;
+        riscv_simd::kernel* kernel = nullptr;
+        const void* operands[3] = { a, b, nullptr };
+        switch (funct6)
+        {
+        case 0b000000:  kernel = simd->floating[riscv_simd::FADD][sew - 2];     break;
+        case 0b000010:  kernel = simd->floating[riscv_simd::FSUB][sew - 2];     break;
+        case 0b100111:  kernel = simd->floating[riscv_simd::FRSUB][sew - 2];    break;
+        case 0b100100:  kernel = simd->floating[riscv_simd::FMUL][sew - 2];     break;
+        case 0b100000:  kernel = simd->floating[riscv_simd::FDIV][sew - 2];     break;
+        case 0b100001:  kernel = simd->floating[riscv_simd::FRDIV][sew - 2];    break;
+        case 0b101000:  // vfmadd
+        case 0b101001:  // vfnmadd
+        case 0b101010:  // vfmsub
+        case 0b101011:  // vfnmsub
+        case 0b101100:  // vfmacc
+        case 0b101101:  // vfnmacc
+        case 0b101110:  // vfmsac
+        case 0b101111:  // vfnmsac
+        {
+            static const int fused[4] = { riscv_simd::FMACC, riscv_simd::FNMACC, riscv_simd::FMSAC, riscv_simd::FNMSAC };
+            kernel = simd->fused[fused[funct6 & 0b11]][sew - 2];
+            operands[0] = b;
+            operands[1] = (funct6 & 0b100) ? a : v[rd];
+            operands[2] = (funct6 & 0b100) ? v[rd] : a;
+            break;
+        }
+        case 0b000001:  // vfredusum
+        case 0b000011:  // vfredosum
+        case 0b000101:  // vfredmin
+        case 0b000111:  // vfredmax
+        {
+            if (vl == 0)
+                return;
+            T sum = q[0];
+            for (size_t i = 0; i < vl; ++i)
+            {
+                if (vm == 0 && vbit(v[0], i) == false)
+                    continue;
+                switch (funct6)
+                {
+                case 0b000101:  sum = fminimum(sum, p[i]);  break;
+                case 0b000111:  sum = fmaximum(sum, p[i]);  break;
+                default:        sum = sum + p[i];           break;
+                }
+            }
+            ((T*)v[rd])[0] = sum == sum ? sum : T(NAN);
+            return;
+        }
+        case 0b000100:  // vfmin
+        case 0b000110:  // vfmax
+            for (size_t i = 0; i < vl; ++i)
+                r[i] = (funct6 == 0b000100) ? fminimum(p[i], q[i]) : fmaximum(p[i], q[i]);
+            vwrite(result);
+            return;
+        case 0b001000:  // vfsgnj
+        case 0b001001:  // vfsgnjn
+        case 0b001010:  // vfsgnjx
+            for (size_t i = 0; i < vl; ++i)
+            {
+                const U sign = U(1) << (sizeof(U) * 8 - 1);
+                U value = ((U*)a)[i];
+                U other = ((U*)b)[i];
+                switch (funct6)
+                {
+                case 0b001000:  ((U*)result)[i] = (value & ~sign) | (other & sign);     break;
+                case 0b001001:  ((U*)result)[i] = (value & ~sign) | (~other & sign);    break;
+                case 0b001010:  ((U*)result)[i] = value ^ (other & sign);               break;
+                }
+            }
+            vwrite(result);
+            return;
+        case 0b010111:  // vfmerge, vfmv.v.f
+            if (vm)
+            {
+                memmove(v[rd], b, vl * size);
+                return;
+            }
+            for (size_t i = 0; i < vl; ++i)
+                r[i] = vbit(v[0], i) ? q[i] : p[i];
+            memcpy(v[rd], result, vl * size);
+            return;
+        case 0b010011:  // vfsqrt
+            if (rs1 != 0b00000)
+                return;
+            for (size_t i = 0; i < vl; ++i)
+            {
+                T value = sqrt(p[i]);
+                r[i] = value == value ? value : T(NAN);
+            }
+            vwrite(result);
+            return;
+        case 0b010010:  // vfcvt
+        {
+            bool truncate = (rs1 & 0b00110) == 0b00110;
+            if (rs1 > 0b00111 || rs1 == 0b00100 || rs1 == 0b00101)
+                return;
+            for (size_t i = 0; i < vl; ++i)
+            {
+                switch (truncate ? rs1 & 0b001 : rs1 & 0b011)
+                {
+                case 0b00:  // xu.f
+                case 0b01:  // x.f
+                {
+                    const T limit = T(U(1) << (sizeof(U) * 8 - 1));
+                    T value = fround(p[i], truncate ? 0b001 : fcsr.frm);
+                    inexact |= value != p[i] && value == value;
+                    if (rs1 & 1)
+                    {
+                        bool over = value != value || value >= limit;
+                        bool under = value < -limit;
+                        invalid |= over || under;
+                        ((S*)result)[i] = over ? S(~U(0) >> 1) : under ? S(U(1) << (sizeof(U) * 8 - 1)) : S(value);
+                    }
+                    else
+                    {
+                        bool over = value != value || value >= limit * 2;
+                        bool under = value < 0;
+                        invalid |= over || under;
+                        ((U*)result)[i] = over ? ~U(0) : under ? 0 : U(value);
+                    }
+                    break;
+                }
+                case 0b10:  // f.xu
+                    r[i] = T(((U*)a)[i]);
+                    break;
+                case 0b11:  // f.x
+                    r[i] = T(((S*)a)[i]);
+                    break;
+                }
+            }
+            vwrite(result);
+            return;
+        }
+        case 0b011000:  // vmfeq
+        case 0b011001:  // vmfle
+        case 0b011011:  // vmflt
+        case 0b011100:  // vmfne
+        case 0b011101:  // vmfgt
+        case 0b011111:  // vmfge
+        {
+            uint8_t bits[VLENB];
+            memcpy(bits, v[rd], VLENB);
+            for (size_t i = 0; i < vl; ++i)
+            {
+                if (vm == 0 && vbit(v[0], i) == false)
+                    continue;
+                bool value = false;
+                switch (funct6)
+                {
+                case 0b011000:  value = p[i] == q[i];   break;
+                case 0b011001:  value = p[i] <= q[i];   break;
+                case 0b011011:  value = p[i] < q[i];    break;
+                case 0b011100:  value = p[i] != q[i];   break;
+                case 0b011101:  value = p[i] > q[i];    break;
+                case 0b011111:  value = p[i] >= q[i];   break;
+                }
+                vsetbit(bits, i, value);
+            }
+            memcpy(v[rd], bits, VLENB);
+            return;
+        }
+        default:
+            return;
+        }
+
+        kernel(vm ? v[rd] : result, operands[0], operands[1], operands[2], vl);
+        if (vm == 0)
+            vwrite(result);
+    });
+    fcsr.nv |= invalid;
+    fcsr.nx |= inexact;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::VSETVLI()
+{
+    uintptr_t avl = rs1 ? x[rs1].u : rd ? UINTPTR_MAX : vl;
+    vset(avl, immI() & 0x7FF);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::VSETIVLI()
+{
+    vset(rs1, immI() & 0x3FF);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::VSETVL()
+{
+    if (funct7 != 0b1000000)
+        return;
+    uintptr_t avl = rs1 ? x[rs1].u : rd ? UINTPTR_MAX : vl;
+    vset(avl, x[rs2].u);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::VLOAD()
+{
+    vmemory(false);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::VSTORE()
+{
+    vmemory(true);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::OPIVV()
+{
+    vopi(v[rs1], 0);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::OPIVX()
+{
+    alignas(32) uint8_t b[8 * VLENB];
+    vsplat(b, x[rs1].u, vsew(vtype), vl);
+    vopi(b, x[rs1].u);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::OPIVI()
+{
+    // Shifts, slides, gathers and whole register moves are unsigned
+    uintptr_t imm = intptr_t(int32_t(rs1 << 27) >> 27);
+    switch (funct6)
+    {
+    case 0b001100:
+    case 0b001110:
+    case 0b001111:
+    case 0b100101:
+    case 0b100111:
+    case 0b101000:
+    case 0b101001:
+        imm = rs1;
+        break;
+    }
+    alignas(32) uint8_t b[8 * VLENB];
+    vsplat(b, imm, vsew(vtype), vl);
+    vopi(b, imm);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::OPMVV()
+{
+    vopm(v[rs1]);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::OPMVX()
+{
+    alignas(32) uint8_t b[8 * VLENB];
+    vsplat(b, x[rs1].u, vsew(vtype), vl ? vl : 1);
+    vopm(b);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::OPFVV()
+{
+    vopf(v[rs1]);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::OPFVF()
+{
+    alignas(32) uint8_t b[8 * VLENB];
+    floating(vsew(vtype), [&](auto t, auto, auto)
+    {
+        typedef decltype(t) T;
+        T value;
+        fget(value, f[rs1]);
+        for (size_t i = 0; i < (vl ? vl : 1); ++i)
+            ((T*)b)[i] = value;
+    });
+    vopf(b);
+}
+//------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,303 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "riscv_simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RISCV_SIMD_X86 1
+#else
+#define RISCV_SIMD_X86 0
+#endif
+
+#define INLINE inline __attribute__((always_inline))
+
+//------------------------------------------------------------------------------
+// Operations, V is either one element or a host vector of them
+//------------------------------------------------------------------------------
+template <int op, typename U, typename V, typename S>
+static INLINE void integerOp(V& d, const V& a, const V& b, const V& c)
+{
+    const U shift = sizeof(U) * 8 - 1;
+    switch (op)
+    {
+    case riscv_simd::ADD:   d = a + b;                              break;
+    case riscv_simd::SUB:   d = a - b;                              break;
+    case riscv_simd::RSUB:  d = b - a;                              break;
+    case riscv_simd::AND:   d = a & b;                              break;
+    case riscv_simd::OR:    d = a | b;                              break;
+    case riscv_simd::XOR:   d = a ^ b;                              break;
+    case riscv_simd::MINU:  d = a < b ? a : b;                      break;
+    case riscv_simd::MIN:   d = (S)a < (S)b ? a : b;                break;
+    case riscv_simd::MAXU:  d = a > b ? a : b;                      break;
+    case riscv_simd::MAX:   d = (S)a > (S)b ? a : b;                break;
+    case riscv_simd::MUL:   d = a * b;                              break;
+    case riscv_simd::SLL:   d = a << (b & shift);                   break;
+    case riscv_simd::SRL:   d = a >> (b & shift);                   break;
+    case riscv_simd::SRA:   d = (V)((S)a >> (S)(b & shift));        break;
+    case riscv_simd::MACC:  d = a * b + c;                          break;
+    case riscv_simd::NMSAC: d = c - a * b;                          break;
+    }
+}
+//------------------------------------------------------------------------------
+template <int op, typename T, typename V>
+static INLINE void floatOp(V& d, const V& a, const V& b)
+{
+    switch (op)
+    {
+    case riscv_simd::FADD:  d = a + b;  break;
+    case riscv_simd::FSUB:  d = a - b;  break;
+    case riscv_simd::FRSUB: d = b - a;  break;
+    case riscv_simd::FMUL:  d = a * b;  break;
+    case riscv_simd::FDIV:  d = a / b;  break;
+    case riscv_simd::FRDIV: d = b / a;  break;
+    }
+    d = d == d ? d : V{} + T(NAN);
+}
+//------------------------------------------------------------------------------
+#if RISCV_SIMD_X86
+typedef float float8 __attribute__((vector_size(32)));
+typedef double double4 __attribute__((vector_size(32)));
+//------------------------------------------------------------------------------
+__attribute__((target("avx2,fma")))
+static inline void multiplyAdd(float8& d, const float8& a, const float8& b, const float8& c)
+{
+    d = (float8)_mm256_fmadd_ps((__m256)a, (__m256)b, (__m256)c);
+}
+//------------------------------------------------------------------------------
+__attribute__((target("avx2,fma")))
+static inline void multiplyAdd(double4& d, const double4& a, const double4& b, const double4& c)
+{
+    d = (double4)_mm256_fmadd_pd((__m256d)a, (__m256d)b, (__m256d)c);
+}
+#endif
+//------------------------------------------------------------------------------
+// Loops over W bytes at a time, W of 0 is one element at a time
+//------------------------------------------------------------------------------
+template <int W, typename U, typename S, int op>
+static INLINE void integerLoop(void* d, const void* a, const void* b, const void* c, size_t count)
+{
+    size_t i = 0;
+    if constexpr (W != 0)
+    {
+        typedef U V __attribute__((vector_size(W)));
+        typedef S SV __attribute__((vector_size(W)));
+        for (; i + W / sizeof(U) <= count; i += W / sizeof(U))
+        {
+            V x, y, z = {}, r;
+            memcpy(&x, (U*)a + i, W);
+            memcpy(&y, (U*)b + i, W);
+            if (op == riscv_simd::MACC || op == riscv_simd::NMSAC)
+                memcpy(&z, (U*)c + i, W);
+            integerOp<op, U, V, SV>(r, x, y, z);
+            memcpy((U*)d + i, &r, W);
+        }
+    }
+    for (; i < count; ++i)
+    {
+        U z = c ? ((U*)c)[i] : 0;
+        U r;
+        integerOp<op, U, U, S>(r, ((U*)a)[i], ((U*)b)[i], z);
+        ((U*)d)[i] = r;
+    }
+}
+//------------------------------------------------------------------------------
+template <int W, typename T, int op>
+static INLINE void floatLoop(void* d, const void* a, const void* b, const void*, size_t count)
+{
+    size_t i = 0;
+    if constexpr (W != 0)
+    {
+        typedef T V __attribute__((vector_size(W)));
+        for (; i + W / sizeof(T) <= count; i += W / sizeof(T))
+        {
+            V x, y, r;
+            memcpy(&x, (T*)a + i, W);
+            memcpy(&y, (T*)b + i, W);
+            floatOp<op, T>(r, x, y);
+            memcpy((T*)d + i, &r, W);
+        }
+    }
+    for (; i < count; ++i)
+    {
+        T r;
+        floatOp<op, T>(r, ((T*)a)[i], ((T*)b)[i]);
+        ((T*)d)[i] = r;
+    }
+}
+//------------------------------------------------------------------------------
+template <int W, typename T, int op>
+static INLINE void fusedLoop(void* d, const void* a, const void* b, const void* c, size_t count)
+{
+    size_t i = 0;
+#if RISCV_SIMD_X86
+    if constexpr (W == 32)
+    {
+        typedef T V __attribute__((vector_size(W)));
+        for (; i + W / sizeof(T) <= count; i += W / sizeof(T))
+        {
+            V x, y, z, r;
+            memcpy(&x, (T*)a + i, W);
+            memcpy(&y, (T*)b + i, W);
+            memcpy(&z, (T*)c + i, W);
+            if (op & 1)
+                x = -x;
+            if (op & 2)
+                z = -z;
+            multiplyAdd(r, x, y, z);
+            r = r == r ? r : V{} + T(NAN);
+            memcpy((T*)d + i, &r, W);
+        }
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        T x = ((T*)a)[i];
+        T z = ((T*)c)[i];
+        T r = fma((op & 1) ? -x : x, ((T*)b)[i], (op & 2) ? -z : z);
+        ((T*)d)[i] = r == r ? r : T(NAN);
+    }
+}
+//------------------------------------------------------------------------------
+// Targets
+//------------------------------------------------------------------------------
+struct scalar
+{
+    template <typename U, typename S, int op>
+    static void integer(void* d, const void* a, const void* b, const void* c, size_t count)
+    {
+        integerLoop<0, U, S, op>(d, a, b, c, count);
+    }
+    template <typename T, int op>
+    static void floating(void* d, const void* a, const void* b, const void* c, size_t count)
+    {
+        floatLoop<0, T, op>(d, a, b, c, count);
+    }
+    template <typename T, int op>
+    static void fused(void* d, const void* a, const void* b, const void* c, size_t count)
+    {
+        fusedLoop<0, T, op>(d, a, b, c, count);
+    }
+};
+//------------------------------------------------------------------------------
+#if RISCV_SIMD_X86
+struct sse2
+{
+    template <typename U, typename S, int op> __attribute__((target("sse2")))
+    static void integer(void* d, const void* a, const void* b, const void* c, size_t count)
+    {
+        integerLoop<16, U, S, op>(d, a, b, c, count);
+    }
+    template <typename T, int op> __attribute__((target("sse2")))
+    static void floating(void* d, const void* a, const void* b, const void* c, size_t count)
+    {
+        floatLoop<16, T, op>(d, a, b, c, count);
+    }
+    template <typename T, int op> __attribute__((target("sse2")))
+    static void fused(void* d, const void* a, const void* b, const void* c, size_t count)
+    {
+        // SSE2 has no fused multiply-add
+        fusedLoop<0, T, op>(d, a, b, c, count);
+    }
+};
+//------------------------------------------------------------------------------
+struct avx2
+{
+    template <typename U, typename S, int op> __attribute__((target("avx2,fma")))
+    static void integer(void* d, const void* a, const void* b, const void* c, size_t count)
+    {
+        integerLoop<32, U, S, op>(d, a, b, c, count);
+    }
+    template <typename T, int op> __attribute__((target("avx2,fma")))
+    static void floating(void* d, const void* a, const void* b, const void* c, size_t count)
+    {
+        floatLoop<32, T, op>(d, a, b, c, count);
+    }
+    template <typename T, int op> __attribute__((target("avx2,fma")))
+    static void fused(void* d, const void* a, const void* b, const void* c, size_t count)
+    {
+        fusedLoop<32, T, op>(d, a, b, c, count);
+    }
+};
+#endif
+//------------------------------------------------------------------------------
+template <class T, int op = 0>
+static void fill(riscv_simd& simd)
+{
+    if constexpr (op < riscv_simd::MAX_INTEGER)
+    {
+        simd.integer[op][0] = T::template integer<uint8_t, int8_t, op>;
+        simd.integer[op][1] = T::template integer<uint16_t, int16_t, op>;
+        simd.integer[op][2] = T::template integer<uint32_t, int32_t, op>;
+        simd.integer[op][3] = T::template integer<uint64_t, int64_t, op>;
+        fill<T, op + 1>(simd);
+    }
+    if constexpr (op < riscv_simd::MAX_FLOAT)
+    {
+        simd.floating[op][0] = T::template floating<float, op>;
+        simd.floating[op][1] = T::template floating<double, op>;
+    }
+    if constexpr (op < riscv_simd::MAX_FUSED)
+    {
+        simd.fused[op][0] = T::template fused<float, op>;
+        simd.fused[op][1] = T::template fused<double, op>;
+    }
+}
+//------------------------------------------------------------------------------
+template <class T>
+static riscv_simd build(const char* name)
+{
+    riscv_simd simd;
+    fill<T>(simd);
+    simd.name = name;
+    return simd;
+}
+//------------------------------------------------------------------------------
+const riscv_simd* riscv_simd::select(level level)
+{
+    switch (level)
+    {
+    case SCALAR:
+    {
+        static const riscv_simd table = build<scalar>("scalar");
+        return &table;
+    }
+#if RISCV_SIMD_X86
+    case SSE2:
+    {
+        if (__builtin_cpu_supports("sse2") == false)
+            break;
+        static const riscv_simd table = build<sse2>("sse2");
+        return &table;
+    }
+    case AVX2:
+    {
+        if (__builtin_cpu_supports("avx2") == false || __builtin_cpu_supports("fma") == false)
+            break;
+        static const riscv_simd table = build<avx2>("avx2");
+        return &table;
+    }
+#endif
+    default:
+        break;
+    }
+    return nullptr;
+}
+//------------------------------------------------------------------------------
+const riscv_simd& riscv_simd::host()
+{
+    const riscv_simd* simd = select(AVX2);
+    if (simd == nullptr)
+        simd = select(SSE2);
+    if (simd == nullptr)
+        simd = select(SCALAR);
+    return *simd;
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,62 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#pragma once
+
+#include <stddef.h>
+
+//------------------------------------------------------------------------------
+// Host SIMD kernels
+//------------------------------------------------------------------------------
+// Element-wise kernels for the vector extension, indexed by operation and by
+// log2 of the element size in bytes (floating-point tables start at 32 bits).
+// A kernel processes count elements, as many per host instruction as the
+// host vector holds, and the remainder one by one. Every kernel computes
+// d = a op b, fused and multiply-add kernels d = ±(a * b) ± c. select()
+// returns the AVX2, SSE2 or scalar table, host() the best one the host CPU
+// supports. Floating-point results are canonical NaNs where RISC-V needs them.
+//------------------------------------------------------------------------------
+struct riscv_simd
+{
+    enum
+    {
+        ADD, SUB, RSUB, AND, OR, XOR, MINU, MIN, MAXU, MAX, MUL, SLL, SRL, SRA,
+        MACC,           // a * b + c
+        NMSAC,          // -(a * b) + c
+        MAX_INTEGER
+    };
+    enum
+    {
+        FADD, FSUB, FRSUB, FMUL, FDIV, FRDIV,
+        MAX_FLOAT
+    };
+    enum
+    {
+        FMACC,          // a * b + c
+        FNMSAC,         // -(a * b) + c
+        FMSAC,          // a * b - c
+        FNMACC,         // -(a * b) - c
+        MAX_FUSED
+    };
+    enum level
+    {
+        SCALAR,
+        SSE2,
+        AVX2,
+    };
+
+    typedef void kernel(void* d, const void* a, const void* b, const void* c, size_t count);
+
+    kernel* integer[MAX_INTEGER][4];
+    kernel* floating[MAX_FLOAT][2];
+    kernel* fused[MAX_FUSED][2];
+    const char* name;
+
+    static const riscv_simd* select(level level);
+    static const riscv_simd& host();
+};
+//------------------------------------------------------------------------------
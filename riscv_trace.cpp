@@ -0,0 +1,231 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include "riscv_trace.h"
+
+//------------------------------------------------------------------------------
+struct riscv_trace_file
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t blockSize;
+    uint32_t blockCount;
+};
+//------------------------------------------------------------------------------
+riscv_trace::riscv_trace(size_t size, size_t block) : riscv_plugin(FETCH | RETIRE | FAULT)
+{
+    blockSize = block;
+    blockCount = size / block;
+    if (blockCount < 2)
+        blockCount = 2;
+    buffer = new uint8_t[blockSize * blockCount];
+
+    faultPath = nullptr;
+
+    reset();
+}
+//------------------------------------------------------------------------------
+riscv_trace::~riscv_trace()
+{
+    delete[] buffer;
+}
+//------------------------------------------------------------------------------
+void riscv_trace::reset()
+{
+    blockHead = blockCount - 1;
+    blockWritten = 0;
+
+    current = nullptr;
+    cursor = nullptr;
+    limit = nullptr;
+    branch = nullptr;
+    branchBit = 8;
+
+    next = 0;
+    last = 0;
+}
+//------------------------------------------------------------------------------
+void riscv_trace::begin(uintptr_t pc)
+{
+    if (current)
+        current->used = uint32_t(cursor - (uint8_t*)(current + 1));
+
+    blockHead = (blockHead + 1) % blockCount;
+    blockWritten++;
+
+    current = (header*)(buffer + blockHead * blockSize);
+    current->pc = pc;
+    current->address = last;
+    current->count = 0;
+    current->used = 0;
+
+    cursor = (uint8_t*)(current + 1);
+    limit = buffer + (blockHead + 1) * blockSize;
+    branch = nullptr;
+    branchBit = 8;
+
+    next = pc;
+}
+//------------------------------------------------------------------------------
+size_t riscv_trace::size() const
+{
+    size_t count = blockWritten < blockCount ? blockWritten : blockCount;
+    return sizeof(riscv_trace_file) + count * blockSize;
+}
+//------------------------------------------------------------------------------
+size_t riscv_trace::dump(void* data, size_t size) const
+{
+    size_t count = blockWritten < blockCount ? blockWritten : blockCount;
+    if (size < sizeof(riscv_trace_file) + count * blockSize)
+        return 0;
+
+    riscv_trace_file file = { { 'R', 'V', 'T', 'R' }, 1, uint32_t(blockSize), uint32_t(count) };
+    memcpy(data, &file, sizeof(file));
+
+    uint8_t* output = (uint8_t*)data + sizeof(file);
+    size_t oldest = (blockHead + blockCount - count + 1) % blockCount;
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t index = (oldest + i) % blockCount;
+        memcpy(output, buffer + index * blockSize, blockSize);
+        if (index == blockHead)
+        {
+            header* block = (header*)output;
+            block->used = uint32_t(cursor - (uint8_t*)(current + 1));
+        }
+        output += blockSize;
+    }
+
+    return output - (uint8_t*)data;
+}
+//------------------------------------------------------------------------------
+bool riscv_trace::dump(const char* path) const
+{
+    size_t size = riscv_trace::size();
+    uint8_t* data = new uint8_t[size];
+    size = dump(data, size);
+
+    bool success = false;
+    FILE* file = fopen(path, "wb");
+    if (file)
+    {
+        success = fwrite(data, 1, size, file) == size;
+        fclose(file);
+    }
+    delete[] data;
+
+    return success;
+}
+//------------------------------------------------------------------------------
+void riscv_trace::fault(const riscv_cpu& cpu)
+{
+    if (faultPath)
+        dump(faultPath);
+}
+//------------------------------------------------------------------------------
+size_t riscv_trace::footprint() const
+{
+    return sizeof(riscv_trace) + blockSize * blockCount;
+}
+//------------------------------------------------------------------------------
+static bool get(const uint8_t*& cursor, const uint8_t* end, intptr_t& delta)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (cursor >= end)
+            return false;
+        uint8_t byte = *cursor++;
+        value |= uint64_t(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            delta = intptr_t((value >> 1) ^ (0 - (value & 1)));
+            return true;
+        }
+    }
+    return false;
+}
+//------------------------------------------------------------------------------
+bool riscv_trace::decode(const void* data, size_t size, read* read, step* step, void* context)
+{
+    riscv_trace_file file;
+    if (size < sizeof(file))
+        return false;
+    memcpy(&file, data, sizeof(file));
+    if (memcmp(file.magic, "RVTR", 4) != 0 || file.version != 1)
+        return false;
+    if (file.blockSize <= sizeof(header) || size < sizeof(file) + size_t(file.blockSize) * file.blockCount)
+        return false;
+
+    const uint8_t* blocks = (uint8_t*)data + sizeof(file);
+    for (uint32_t i = 0; i < file.blockCount; ++i)
+    {
+        header block;
+        memcpy(&block, blocks + size_t(i) * file.blockSize, sizeof(block));
+        if (block.used > file.blockSize - sizeof(header))
+            return false;
+
+        const uint8_t* cursor = blocks + size_t(i) * file.blockSize + sizeof(header);
+        const uint8_t* end = cursor + block.used;
+        uint8_t branch = 0;
+        unsigned int branchBit = 8;
+        uintptr_t pc = block.pc;
+        uintptr_t last = block.address;
+
+        riscv_instruction instruction;
+        for (uint32_t count = 0; count < block.count; ++count)
+        {
+            uint32_t format = read(context, pc);
+            size_t length = (format & 0b11) == 0b11 ? 4 : 2;
+            instruction.format = length == 4 ? format : riscv_instruction::expand(format);
+
+            intptr_t delta = 0;
+            uintptr_t address = 0;
+            uintptr_t next = pc + length;
+            switch (instruction.opcode)
+            {
+            case 0b0000011:
+            case 0b0000111:
+            case 0b0100011:
+            case 0b0100111:
+            case 0b0101111:
+                if (get(cursor, end, delta) == false)
+                    break;
+                last += delta;
+                address = last;
+                break;
+            case 0b1100011:
+                if (branchBit == 8)
+                {
+                    if (cursor >= end)
+                        break;
+                    branch = *cursor++;
+                    branchBit = 0;
+                }
+                if (branch & (1 << branchBit++))
+                    next = pc + instruction.simmB();
+                break;
+            case 0b1100111:
+                if (get(cursor, end, delta) == false)
+                    break;
+                next = pc + delta;
+                break;
+            case 0b1101111:
+                next = pc + instruction.simmJ();
+                break;
+            }
+
+            step(context, pc, format, address, next);
+            pc = next;
+        }
+    }
+
+    return true;
+}
+//------------------------------------------------------------------------------
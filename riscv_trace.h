@@ -0,0 +1,142 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include "riscv_cpu.h"
+#include "riscv_plugin.h"
+
+//------------------------------------------------------------------------------
+// Execution trace
+//------------------------------------------------------------------------------
+// The ring buffer is split into fixed-size blocks. Every block starts with the
+// absolute pc and memory address, so the oldest block can be overwritten
+// without losing the ability to decode the rest. Sequential execution is not
+// recorded at all; the decoder walks the guest code and only consumes
+//   - one bit per conditional branch (taken / not taken)
+//   - one zigzag LEB128 pc delta per JALR
+//   - one zigzag LEB128 address delta per load / store / AMO
+// Any other discontinuity (ECALL changing pc, program()) opens a new block.
+// On SIGSEGV the trace is dumped to faultPath when it is set.
+//------------------------------------------------------------------------------
+struct riscv_trace : public riscv_plugin
+{
+    riscv_trace(size_t size = 16 << 20, size_t block = 4096);
+    ~riscv_trace();
+
+    void reset();
+    void fetch(const riscv_cpu& cpu);
+    void retire(const riscv_cpu& cpu, uintptr_t address);
+    void fault(const riscv_cpu& cpu);
+    size_t footprint() const;
+
+    size_t size() const;
+    size_t dump(void* buffer, size_t size) const;
+    bool dump(const char* path) const;
+
+    typedef uint32_t read(void* context, uintptr_t pc);
+    typedef void step(void* context, uintptr_t pc, uint32_t format, uintptr_t address, uintptr_t next);
+    static bool decode(const void* data, size_t size, read* read, step* step, void* context);
+
+public:
+    const char* faultPath;
+
+protected:
+    struct header
+    {
+        uint64_t pc;
+        uint64_t address;
+        uint32_t count;
+        uint32_t used;
+    };
+
+    void begin(uintptr_t pc);
+    void put(intptr_t delta);
+
+    uint8_t* buffer;
+    size_t blockSize;
+    size_t blockCount;
+    size_t blockHead;
+    size_t blockWritten;
+
+    header* current;
+    uint8_t* cursor;
+    uint8_t* limit;
+    uint8_t* branch;
+    unsigned int branchBit;
+
+    uintptr_t next;
+    uintptr_t last;
+};
+//------------------------------------------------------------------------------
+inline void riscv_trace::put(intptr_t delta)
+{
+    uint64_t value = (uint64_t(delta) << 1) ^ uint64_t(int64_t(delta) >> 63);
+    while (value >= 0x80)
+    {
+        *cursor++ = uint8_t(value | 0x80);
+        value >>= 7;
+    }
+    *cursor++ = uint8_t(value);
+}
+//------------------------------------------------------------------------------
+inline void riscv_trace::fetch(const riscv_cpu& cpu)
+{
+    if (cpu.pc != next || cursor + 32 > limit)
+        begin(cpu.pc);
+    current->count++;
+
+    // decode() reads a delta for every memory opcode, even when the access
+    // is empty, such as a vector access with vl == 0
+    uintptr_t address;
+    bool store;
+    if (cpu.access(address, store) == 0)
+    {
+        switch (cpu.opcode)
+        {
+        case 0b0000011:
+        case 0b0000111:
+        case 0b0100011:
+        case 0b0100111:
+        case 0b0101111:
+            put(0);
+            break;
+        }
+        return;
+    }
+    put(address - last);
+    last = address;
+}
+//------------------------------------------------------------------------------
+inline void riscv_trace::retire(const riscv_cpu& cpu, uintptr_t address)
+{
+    switch (cpu.opcode)
+    {
+    case 0b1100011:
+        if (branchBit == 8)
+        {
+            branch = cursor++;
+            *branch = 0;
+            branchBit = 0;
+        }
+        *branch |= (cpu.pc != address + cpu.length) << branchBit++;
+        next = cpu.pc;
+        break;
+    case 0b1100111:
+        put(cpu.pc - address);
+        next = cpu.pc;
+        break;
+    case 0b1101111:
+        next = address + cpu.simmJ();
+        break;
+    default:
+        next = address + cpu.length;
+        break;
+    }
+}
+//------------------------------------------------------------------------------
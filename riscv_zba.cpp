@@ -0,0 +1,53 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include "riscv_cpu.h"
+
+//------------------------------------------------------------------------------
+// RISC-V Bit-Manipulation ISA-extensions Version 1.0.0
+// Zba: Address generation
+//------------------------------------------------------------------------------
+void riscv_cpu::SH1ADD()
+{
+    x[rd] = (x[rs1].u << 1) + x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SH2ADD()
+{
+    x[rd] = (x[rs1].u << 2) + x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SH3ADD()
+{
+    x[rd] = (x[rs1].u << 3) + x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::ADD_UW()
+{
+    x[rd] = (uint64_t)x[rs1].u32 + x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SH1ADD_UW()
+{
+    x[rd] = ((uint64_t)x[rs1].u32 << 1) + x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SH2ADD_UW()
+{
+    x[rd] = ((uint64_t)x[rs1].u32 << 2) + x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SH3ADD_UW()
+{
+    x[rd] = ((uint64_t)x[rs1].u32 << 3) + x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SLLI_UW()
+{
+    x[rd] = (uint64_t)x[rs1].u32 << (immI() & 0x3F);
+}
+//------------------------------------------------------------------------------
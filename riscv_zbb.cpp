@@ -0,0 +1,150 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include "riscv_cpu.h"
+
+//------------------------------------------------------------------------------
+// RISC-V Bit-Manipulation ISA-extensions Version 1.0.0
+// Zbb: Basic bit-manipulation
+//------------------------------------------------------------------------------
+// Counts and rotates are written as the builtins and idioms which compilers
+// turn into lzcnt, tzcnt, popcnt, rol, ror and bswap when the host has them.
+//------------------------------------------------------------------------------
+static inline uint64_t rol64(uint64_t value, unsigned int shift)
+{
+    return (value << (shift & 63)) | (value >> (-shift & 63));
+}
+//------------------------------------------------------------------------------
+static inline uint32_t rol32(uint32_t value, unsigned int shift)
+{
+    return (value << (shift & 31)) | (value >> (-shift & 31));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::ANDN()
+{
+    x[rd] = x[rs1].u & ~x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::ORN()
+{
+    x[rd] = x[rs1].u | ~x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::XNOR()
+{
+    x[rd] = ~(x[rs1].u ^ x[rs2].u);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::CLZ()
+{
+    x[rd] = x[rs1].u64 ? __builtin_clzll(x[rs1].u64) : 64;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::CTZ()
+{
+    x[rd] = x[rs1].u64 ? __builtin_ctzll(x[rs1].u64) : 64;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::CPOP()
+{
+    x[rd] = __builtin_popcountll(x[rs1].u64);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::MAX()
+{
+    x[rd] = x[rs1].s < x[rs2].s ? x[rs2].u : x[rs1].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::MAXU()
+{
+    x[rd] = x[rs1].u < x[rs2].u ? x[rs2].u : x[rs1].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::MIN()
+{
+    x[rd] = x[rs1].s < x[rs2].s ? x[rs1].u : x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::MINU()
+{
+    x[rd] = x[rs1].u < x[rs2].u ? x[rs1].u : x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SEXT_B()
+{
+    x[rd] = x[rs1].s8;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SEXT_H()
+{
+    x[rd] = x[rs1].s16;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::ZEXT_H()
+{
+    x[rd] = x[rs1].u16;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::ROL()
+{
+    x[rd] = rol64(x[rs1].u64, x[rs2].u32);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::ROR()
+{
+    x[rd] = rol64(x[rs1].u64, -x[rs2].u32);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::RORI()
+{
+    x[rd] = rol64(x[rs1].u64, -immI());
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::ORC_B()
+{
+    // 0x80 in every byte which is not zero, widened to 0xFF
+    uint64_t value = x[rs1].u64;
+    uint64_t low = 0x7F7F7F7F7F7F7F7Full;
+    uint64_t high = ((value & low) + low) | value;
+    x[rd] = ((high & ~low) >> 7) * 0xFF;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::REV8()
+{
+    x[rd] = __builtin_bswap64(x[rs1].u64);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::CLZW()
+{
+    x[rd] = x[rs1].u32 ? __builtin_clz(x[rs1].u32) : 32;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::CTZW()
+{
+    x[rd] = x[rs1].u32 ? __builtin_ctz(x[rs1].u32) : 32;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::CPOPW()
+{
+    x[rd] = __builtin_popcount(x[rs1].u32);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::ROLW()
+{
+    x[rd] = (int32_t)rol32(x[rs1].u32, x[rs2].u32);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::RORW()
+{
+    x[rd] = (int32_t)rol32(x[rs1].u32, -x[rs2].u32);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::RORIW()
+{
+    x[rd] = (int32_t)rol32(x[rs1].u32, -immI());
+}
+//------------------------------------------------------------------------------
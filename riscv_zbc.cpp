@@ -0,0 +1,85 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include "riscv_cpu.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// RISC-V Bit-Manipulation ISA-extensions Version 1.0.0
+// Zbc: Carry-less multiplication
+//------------------------------------------------------------------------------
+// The 128-bit product comes from PCLMULQDQ when the host has it, otherwise
+// from a shift-and-xor loop. The choice is made once at static initialisation.
+//------------------------------------------------------------------------------
+struct carryless
+{
+    void (*multiply)(uint64_t a, uint64_t b, uint64_t& low, uint64_t& high);
+};
+//------------------------------------------------------------------------------
+static void portableMultiply(uint64_t a, uint64_t b, uint64_t& low, uint64_t& high)
+{
+    low = 0;
+    high = 0;
+    for (int i = 0; i < 64; ++i)
+    {
+        uint64_t mask = 0 - ((b >> i) & 1);
+        low ^= (a << i) & mask;
+        high ^= i ? (a >> (64 - i)) & mask : 0;
+    }
+}
+//------------------------------------------------------------------------------
+#if defined(__x86_64__)
+__attribute__((target("pclmul,sse2")))
+static void pclmulqdq(uint64_t a, uint64_t b, uint64_t& low, uint64_t& high)
+{
+    __m128i product = _mm_clmulepi64_si128(_mm_cvtsi64_si128(a), _mm_cvtsi64_si128(b), 0x00);
+    low = _mm_cvtsi128_si64(product);
+    high = _mm_cvtsi128_si64(_mm_unpackhi_epi64(product, product));
+}
+#endif
+//------------------------------------------------------------------------------
+static const carryless& host()
+{
+    static const carryless portable = { portableMultiply };
+#if defined(__x86_64__)
+    static const carryless pclmul = { pclmulqdq };
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("pclmul"))
+        return pclmul;
+#endif
+    return portable;
+}
+//------------------------------------------------------------------------------
+static const carryless& clmul = host();
+//------------------------------------------------------------------------------
+void riscv_cpu::CLMUL()
+{
+    uint64_t low;
+    uint64_t high;
+    clmul.multiply(x[rs1].u64, x[rs2].u64, low, high);
+    x[rd] = low;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::CLMULH()
+{
+    uint64_t low;
+    uint64_t high;
+    clmul.multiply(x[rs1].u64, x[rs2].u64, low, high);
+    x[rd] = high;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::CLMULR()
+{
+    uint64_t low;
+    uint64_t high;
+    clmul.multiply(x[rs1].u64, x[rs2].u64, low, high);
+    x[rd] = (high << 1) | (low >> 63);
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,53 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include "riscv_cpu.h"
+
+//------------------------------------------------------------------------------
+// RISC-V Bit-Manipulation ISA-extensions Version 1.0.0
+// Zbs: Single-bit instructions
+//------------------------------------------------------------------------------
+void riscv_cpu::BCLR()
+{
+    x[rd] = x[rs1].u64 & ~(uint64_t(1) << (x[rs2].u & 63));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::BCLRI()
+{
+    x[rd] = x[rs1].u64 & ~(uint64_t(1) << (immI() & 63));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::BEXT()
+{
+    x[rd] = (x[rs1].u64 >> (x[rs2].u & 63)) & 1;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::BEXTI()
+{
+    x[rd] = (x[rs1].u64 >> (immI() & 63)) & 1;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::BINV()
+{
+    x[rd] = x[rs1].u64 ^ (uint64_t(1) << (x[rs2].u & 63));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::BINVI()
+{
+    x[rd] = x[rs1].u64 ^ (uint64_t(1) << (immI() & 63));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::BSET()
+{
+    x[rd] = x[rs1].u64 | (uint64_t(1) << (x[rs2].u & 63));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::BSETI()
+{
+    x[rd] = x[rs1].u64 | (uint64_t(1) << (immI() & 63));
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,415 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <fenv.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include "riscv_cpu.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#if RISCV_HAVE_HALF
+//------------------------------------------------------------------------------
+// "Zfh" and "Zfhmin" Standard Extensions for Half-Precision Floating-Point
+//------------------------------------------------------------------------------
+// Halves are NaN-boxed in the f registers. Operands are widened to float,
+// which is exact, and the result is narrowed once. Float has more than twice
+// the precision of half plus two bits, so the double rounding of add, sub,
+// mul, div and sqrt is harmless. The fused multiply-add goes through double
+// for the same reason. Widening and narrowing use F16C when the host has it.
+//------------------------------------------------------------------------------
+struct binary16
+{
+    float (*widen)(uint16_t half);
+    uint16_t (*narrow)(float value);
+};
+//------------------------------------------------------------------------------
+static bool quiet(float value)
+{
+    uint32_t binary;
+    memcpy(&binary, &value, sizeof(binary));
+    return (binary >> 22) & 1;
+}
+//------------------------------------------------------------------------------
+static bool quiet(double value)
+{
+    uint64_t binary;
+    memcpy(&binary, &value, sizeof(binary));
+    return (binary >> 51) & 1;
+}
+//------------------------------------------------------------------------------
+static float portableWiden(uint16_t half)
+{
+    uint32_t sign = uint32_t(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    if (exponent == 0x1F)
+    {
+        if (mantissa && (mantissa & 0x200) == 0)
+            feraiseexcept(FE_INVALID);
+        uint32_t binary = sign | 0x7F800000 | (mantissa << 13) | (mantissa ? 0x400000 : 0);
+        float value;
+        memcpy(&value, &binary, sizeof(value));
+        return value;
+    }
+    float value = ldexpf(float(exponent ? mantissa | 0x400 : mantissa), (exponent ? exponent : 1) - 25);
+    return sign ? -value : value;
+}
+//------------------------------------------------------------------------------
+template <typename T>
+static uint16_t portableNarrow(T value)
+{
+    uint16_t sign = signbit(value) ? 0x8000 : 0;
+    if (isnan(value))
+    {
+        if (quiet(value) == false)
+            feraiseexcept(FE_INVALID);
+        return sign | 0x7E00;
+    }
+    if (isinf(value) || value == 0)
+        return sign | (isinf(value) ? 0x7C00 : 0);
+
+    // Adding a constant whose ulp is the half ulp rounds in the current mode
+    int exponent = ilogb(value);
+    if (exponent < -14)
+        exponent = -14;
+    if (exponent > 15)
+        exponent = 15;
+    int digits = (sizeof(T) == sizeof(float)) ? FLT_MANT_DIG : DBL_MANT_DIG;
+    T bias = copysign(ldexp(T(1), exponent + digits - 11), value);
+    volatile T sum = value + bias;
+    T rounded = fabs(sum - bias);
+
+    if (rounded > T(65504))
+    {
+        feraiseexcept(FE_OVERFLOW | FE_INEXACT);
+        int mode = fegetround();
+        bool infinite = (mode == FE_TONEAREST) || (mode == FE_UPWARD && sign == 0) || (mode == FE_DOWNWARD && sign);
+        return sign | (infinite ? 0x7C00 : 0x7BFF);
+    }
+    if (rounded != fabs(value) && fabs(value) < ldexp(T(1), -14))
+    {
+        // Tininess is detected after rounding to an unbounded exponent
+        T unbounded = copysign(ldexp(T(1), ilogb(value) + digits - 11), value);
+        volatile T tiny = value + unbounded;
+        if (fabs(tiny - unbounded) < ldexp(T(1), -14))
+            feraiseexcept(FE_UNDERFLOW);
+    }
+    if (rounded < ldexp(T(1), -14))
+        return sign | uint16_t(ldexp(rounded, 24));
+    exponent = ilogb(rounded);
+    return sign | uint16_t((exponent + 15) << 10) | uint16_t(ldexp(rounded, 10 - exponent) - 1024);
+}
+//------------------------------------------------------------------------------
+#if defined(__x86_64__)
+__attribute__((target("f16c")))
+static float vcvtph2ps(uint16_t half)
+{
+    return _cvtsh_ss(half);
+}
+//------------------------------------------------------------------------------
+__attribute__((target("f16c")))
+static uint16_t vcvtps2ph(float value)
+{
+    return _cvtss_sh(value, _MM_FROUND_CUR_DIRECTION);
+}
+#endif
+//------------------------------------------------------------------------------
+static const binary16& host()
+{
+    static const binary16 portable = { portableWiden, portableNarrow<float> };
+#if defined(__x86_64__)
+    static const binary16 f16c = { vcvtph2ps, vcvtps2ph };
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("f16c"))
+        return f16c;
+#endif
+    return portable;
+}
+//------------------------------------------------------------------------------
+static const binary16& half = host();
+//------------------------------------------------------------------------------
+typedef decltype(riscv_cpu::float32_t::u) flen_t;
+//------------------------------------------------------------------------------
+static uint16_t unbox(const riscv_cpu::register_t& reg)
+{
+    flen_t box = ~flen_t(0) << 16;
+    if ((reg.f.u & box) != box)
+        return 0x7E00;
+    return uint16_t(reg.f.u);
+}
+//------------------------------------------------------------------------------
+static void box(riscv_cpu::register_t& reg, uint16_t value)
+{
+    reg.f.u = (~flen_t(0) << 16) | value;
+}
+//------------------------------------------------------------------------------
+static float widen(const riscv_cpu::register_t& reg)
+{
+    return half.widen(unbox(reg));
+}
+//------------------------------------------------------------------------------
+static void narrow(riscv_cpu::register_t& reg, float value)
+{
+    uint16_t result = half.narrow(value);
+    box(reg, isnan(value) ? 0x7E00 : result);
+}
+//------------------------------------------------------------------------------
+static void narrow(riscv_cpu::register_t& reg, double value)
+{
+    uint16_t result = portableNarrow(value);
+    box(reg, isnan(value) ? 0x7E00 : result);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FLH()
+{
+    box(f[rd], *(uint16_t*)(x[rs1] + simmI()));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FSH()
+{
+    *(uint16_t*)(x[rs1] + simmS()) = f[rs2].u16;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FMADD_H()
+{
+    fsetround();
+    narrow(f[rd], fma(double(widen(f[rs1])), double(widen(f[rs2])), double(widen(f[rs3]))));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FMSUB_H()
+{
+    fsetround();
+    narrow(f[rd], fma(double(widen(f[rs1])), double(widen(f[rs2])), -double(widen(f[rs3]))));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FNMSUB_H()
+{
+    fsetround();
+    narrow(f[rd], fma(-double(widen(f[rs1])), double(widen(f[rs2])), double(widen(f[rs3]))));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FNMADD_H()
+{
+    fsetround();
+    narrow(f[rd], fma(-double(widen(f[rs1])), double(widen(f[rs2])), -double(widen(f[rs3]))));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FADD_H()
+{
+    fsetround();
+    narrow(f[rd], widen(f[rs1]) + widen(f[rs2]));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FSUB_H()
+{
+    fsetround();
+    narrow(f[rd], widen(f[rs1]) - widen(f[rs2]));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FMUL_H()
+{
+    fsetround();
+    narrow(f[rd], widen(f[rs1]) * widen(f[rs2]));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FDIV_H()
+{
+    fsetround();
+    narrow(f[rd], widen(f[rs1]) / widen(f[rs2]));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FSQRT_H()
+{
+    fsetround();
+    narrow(f[rd], sqrtf(widen(f[rs1])));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FSGNJ_H()
+{
+    box(f[rd], (unbox(f[rs1]) & 0x7FFF) | (unbox(f[rs2]) & 0x8000));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FSGNJN_H()
+{
+    box(f[rd], (unbox(f[rs1]) & 0x7FFF) | (~unbox(f[rs2]) & 0x8000));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FSGNJX_H()
+{
+    box(f[rd], unbox(f[rs1]) ^ (unbox(f[rs2]) & 0x8000));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FMIN_H()
+{
+    uint16_t a = unbox(f[rs1]);
+    uint16_t b = unbox(f[rs2]);
+    float value1 = half.widen(a);
+    float value2 = half.widen(b);
+    if (isnan(value1) && isnan(value2))
+        box(f[rd], 0x7E00);
+    else if (isnan(value1) || isnan(value2))
+        box(f[rd], isnan(value1) ? b : a);
+    else if (value1 == value2)
+        box(f[rd], a | b);
+    else
+        box(f[rd], value1 < value2 ? a : b);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FMAX_H()
+{
+    uint16_t a = unbox(f[rs1]);
+    uint16_t b = unbox(f[rs2]);
+    float value1 = half.widen(a);
+    float value2 = half.widen(b);
+    if (isnan(value1) && isnan(value2))
+        box(f[rd], 0x7E00);
+    else if (isnan(value1) || isnan(value2))
+        box(f[rd], isnan(value1) ? b : a);
+    else if (value1 == value2)
+        box(f[rd], a & b);
+    else
+        box(f[rd], value1 > value2 ? a : b);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FCVT_S_H()
+{
+    f[rd].f = widen(f[rs1]);
+    if (isnan(f[rd].f))
+    {
+        f[rd].f = NAN;
+        return;
+    }
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FCVT_H_S()
+{
+    fsetround();
+    narrow(f[rd], float(f[rs1].f));
+}
+//------------------------------------------------------------------------------
+#if RISCV_HAVE_DOUBLE
+void riscv_cpu::FCVT_D_H()
+{
+    f[rd].d = widen(f[rs1]);
+    if (isnan(f[rd].d))
+    {
+        f[rd].d = NAN;
+        return;
+    }
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FCVT_H_D()
+{
+    fsetround();
+    narrow(f[rd], double(f[rs1].d));
+}
+//------------------------------------------------------------------------------
+#endif
+void riscv_cpu::FEQ_H()
+{
+    x[rd].u = (widen(f[rs1]) == widen(f[rs2]));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FLT_H()
+{
+    float value1 = widen(f[rs1]);
+    float value2 = widen(f[rs2]);
+    x[rd].u = (value1 < value2);
+    fcsr.nv |= (isnan(value1) || isnan(value2));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FLE_H()
+{
+    float value1 = widen(f[rs1]);
+    float value2 = widen(f[rs2]);
+    x[rd].u = (value1 <= value2);
+    fcsr.nv |= (isnan(value1) || isnan(value2));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FCLASS_H()
+{
+    uint16_t binary = unbox(f[rs1]);
+    bool sign = (binary & 0x8000) != 0;
+    int exponent = (binary >> 10) & 0x1F;
+    int mantissa = binary & 0x3FF;
+    int fclass;
+    if (exponent == 0x1F)
+        fclass = mantissa ? ((mantissa & 0x200) ? 9 : 8) : (sign ? 0 : 7);
+    else if (exponent == 0)
+        fclass = mantissa ? (sign ? 2 : 5) : (sign ? 3 : 4);
+    else
+        fclass = sign ? 1 : 6;
+    x[rd].u = (1 << fclass);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FCVT_W_H()
+{
+    if (rounding() > 0b100)
+        return HINT();
+    x[rd].s = int32_t(fcvt(widen(f[rs1]), 32));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FCVT_WU_H()
+{
+    if (rounding() > 0b100)
+        return HINT();
+    x[rd].s = int32_t(fcvtu(widen(f[rs1]), 32));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FCVT_H_W()
+{
+    fsetround();
+    narrow(f[rd], float(x[rs1].s32));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FCVT_H_WU()
+{
+    fsetround();
+    narrow(f[rd], float(x[rs1].u32));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FMV_X_H()
+{
+    x[rd].s = int16_t(f[rs1].u16);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FMV_H_X()
+{
+    box(f[rd], x[rs1].u16);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FCVT_L_H()
+{
+    if (rounding() > 0b100)
+        return HINT();
+    x[rd].s = fcvt(widen(f[rs1]), 64);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FCVT_LU_H()
+{
+    if (rounding() > 0b100)
+        return HINT();
+    x[rd].u = fcvtu(widen(f[rs1]), 64);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FCVT_H_L()
+{
+    fsetround();
+    narrow(f[rd], float(x[rs1].s64));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::FCVT_H_LU()
+{
+    fsetround();
+    narrow(f[rd], float(x[rs1].u64));
+}
+//------------------------------------------------------------------------------
+#endif
@@ -8,136 +8,140 @@
 #include "riscv_cpu.h"
 
 //------------------------------------------------------------------------------
-void riscv_cpu::CSRRW()
+bool riscv_cpu::csrread(int csr, uintptr_t& value)
 {
-    switch (immI())
+    switch (csr)
     {
     case 0x001:
-        x[rd] = fcsr.fflags;
-        if (rs1 == 0)
-            break;
-        fcsr.fflags = x[rs1].u32;
-        break;
+        ftestexcept();
+        value = fcsr.fflags;
+        return true;
     case 0x002:
-        x[rd] = fcsr.frm;
-        if (rs1 == 0)
-            break;
-        fcsr.frm = x[rs1].u32;
-        break;
+        value = fcsr.frm;
+        return true;
     case 0x003:
-        x[rd] = fcsr.u32;
-        if (rs1 == 0)
-            break;
-        fcsr.fflags = x[rs1].fflags;
-        fcsr.frm = x[rs1].frm;
-        break;
+        ftestexcept();
+        value = fcsr.u32;
+        return true;
+#if RISCV_HAVE_VECTOR
+    case 0x008:
+        // Vector instructions always run to completion, so vstart stays zero
+        value = 0;
+        return true;
+    case 0x009:
+        value = vxsat;
+        return true;
+    case 0x00A:
+        value = vxrm;
+        return true;
+    case 0x00F:
+        value = vxrm << 1 | vxsat;
+        return true;
+    case 0xC20:
+        value = vl;
+        return true;
+    case 0xC21:
+        value = vtype;
+        return true;
+    case 0xC22:
+        value = VLENB;
+        return true;
+#endif
     }
+    return false;
 }
 //------------------------------------------------------------------------------
-void riscv_cpu::CSRRS()
+void riscv_cpu::csrwrite(int csr, uintptr_t value)
 {
-    switch (immI())
+    switch (csr)
     {
     case 0x001:
-        x[rd] = fcsr.fflags;
-        if (rs1 == 0)
-            break;
-        fcsr.fflags |= x[rs1].u32;
+        fcsr.fflags = value;
         break;
     case 0x002:
-        x[rd] = fcsr.frm;
-        if (rs1 == 0)
-            break;
-        fcsr.frm |= x[rs1].u32;
+        fcsr.frm = value;
         break;
     case 0x003:
-        x[rd] = fcsr.u32;
-        if (rs1 == 0)
-            break;
-        fcsr.u32 |= x[rs1].u32;
+        fcsr.fflags = value;
+        fcsr.frm = value >> 5;
+        break;
+#if RISCV_HAVE_VECTOR
+    case 0x009:
+        vxsat = value & 1;
         break;
+    case 0x00A:
+        vxrm = value & 3;
+        break;
+    case 0x00F:
+        vxsat = value & 1;
+        vxrm = (value >> 1) & 3;
+        break;
+#endif
     }
 }
 //------------------------------------------------------------------------------
+void riscv_cpu::CSRRW()
+{
+    uintptr_t source = x[rs1].u;
+    uintptr_t value;
+    if (csrread(immI(), value) == false)
+        return;
+    x[rd] = value;
+    csrwrite(immI(), source);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::CSRRS()
+{
+    uintptr_t source = x[rs1].u;
+    uintptr_t value;
+    if (csrread(immI(), value) == false)
+        return;
+    x[rd] = value;
+    if (rs1 == 0)
+        return;
+    csrwrite(immI(), value | source);
+}
+//------------------------------------------------------------------------------
 void riscv_cpu::CSRRC()
 {
-    switch (immI())
-    {
-    case 0x001:
-        x[rd] = fcsr.fflags;
-        if (rs1 == 0)
-            break;
-        fcsr.fflags &= ~(x[rs1].u32);
-        break;
-    case 0x002:
-        x[rd] = fcsr.frm;
-        if (rs1 == 0)
-            break;
-        fcsr.frm &= ~(x[rs1].u32);
-        break;
-    case 0x003:
-        x[rd] = fcsr.u32;
-        if (rs1 == 0)
-            break;
-        fcsr.u32 &= ~(x[rs1].u32);
-        break;
-    }
+    uintptr_t source = x[rs1].u;
+    uintptr_t value;
+    if (csrread(immI(), value) == false)
+        return;
+    x[rd] = value;
+    if (rs1 == 0)
+        return;
+    csrwrite(immI(), value & ~source);
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::CSRRWI()
 {
-    switch (immI())
-    {
-    case 0x001:
-        x[rd] = fcsr.fflags;
-        fcsr.fflags = rs1;
-        break;
-    case 0x002:
-        x[rd] = fcsr.frm;
-        fcsr.frm = rs1;
-        break;
-    case 0x003:
-        x[rd] = fcsr.u32;
-        fcsr.u32 = rs1;
-        break;
-    }
+    uintptr_t value;
+    if (csrread(immI(), value) == false)
+        return;
+    x[rd] = value;
+    csrwrite(immI(), rs1);
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::CSRRSI()
 {
-    switch (immI())
-    {
-    case 0x001:
-        x[rd] = fcsr.fflags;
-        fcsr.fflags |= rs1;
-        break;
-    case 0x002:
-        x[rd] = fcsr.frm;
-        fcsr.frm |= rs1;
-        break;
-    case 0x003:
-        x[rd] = fcsr.u32;
-        fcsr.u32 |= rs1;
-        break;
-    }
+    uintptr_t value;
+    if (csrread(immI(), value) == false)
+        return;
+    x[rd] = value;
+    if (rs1 == 0)
+        return;
+    csrwrite(immI(), value | rs1);
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::CSRRCI()
 {
-    switch (immI())
-    {
-    case 0x001:
-        x[rd] = fcsr.fflags;
-        fcsr.fflags &= ~(rs1);
-        break;
-    case 0x002:
-        x[rd] = fcsr.frm;
-        fcsr.frm &= ~(rs1);
-        break;
-    case 0x003:
-        x[rd] = fcsr.u32;
-        fcsr.u32 &= ~(rs1);
-        break;
-    }
+    uintptr_t value;
+    if (csrread(immI(), value) == false)
+        return;
+    x[rd] = value;
+    if (rs1 == 0)
+        return;
+    csrwrite(immI(), value & ~uintptr_t(rs1));
 }
 //------------------------------------------------------------------------------
@@ -0,0 +1,289 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include "riscv_cpu.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// RISC-V Cryptography Extensions Volume I: Scalar & Entropy Source
+// Zkne, Zknd: NIST Suite AES Encryption and Decryption (RV64)
+// Zknh: NIST Suite Hash Function Instructions
+//------------------------------------------------------------------------------
+// rs1 holds columns 0 and 1 and rs2 columns 2 and 3 of the AES state, in the
+// byte order AES-NI uses, so a round with a zero key computes the whole state
+// and the low half is the result. Without AES-NI the rounds go through the
+// S-box tables. The SHA functions are rotates and shifts only, SHA-NI works
+// on whole rounds and has nothing finer to offer.
+//------------------------------------------------------------------------------
+static const uint8_t forward[256] =
+{
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+static const uint8_t inverse[256] =
+{
+    0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+    0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+    0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+    0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+    0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+    0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+    0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+    0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+    0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+    0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+    0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+    0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+    0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+    0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+    0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+    0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d,
+};
+//------------------------------------------------------------------------------
+struct aes
+{
+    uint64_t (*encrypt)(uint64_t rs1, uint64_t rs2, bool mix);
+    uint64_t (*decrypt)(uint64_t rs1, uint64_t rs2, bool mix);
+    uint64_t (*inverseMix)(uint64_t rs1);
+    uint32_t (*subWord)(uint32_t word);
+};
+//------------------------------------------------------------------------------
+static uint8_t multiply(uint8_t a, uint8_t b)
+{
+    uint8_t product = 0;
+    for (; b; b >>= 1)
+    {
+        if (b & 1)
+            product ^= a;
+        a = uint8_t((a << 1) ^ ((a >> 7) * 0x1B));
+    }
+    return product;
+}
+//------------------------------------------------------------------------------
+static uint32_t mixColumn(uint32_t column, const uint8_t (&matrix)[4])
+{
+    uint8_t a[4] = { uint8_t(column), uint8_t(column >> 8), uint8_t(column >> 16), uint8_t(column >> 24) };
+    uint32_t result = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        uint8_t b = 0;
+        for (int j = 0; j < 4; ++j)
+            b ^= multiply(a[j], matrix[(j - i) & 3]);
+        result |= uint32_t(b) << (i * 8);
+    }
+    return result;
+}
+//------------------------------------------------------------------------------
+static uint64_t mixColumns(uint64_t value, bool inverse)
+{
+    static const uint8_t forwardMatrix[4] = { 2, 3, 1, 1 };
+    static const uint8_t inverseMatrix[4] = { 14, 11, 13, 9 };
+    const uint8_t (&matrix)[4] = inverse ? inverseMatrix : forwardMatrix;
+    return mixColumn(uint32_t(value), matrix) | uint64_t(mixColumn(uint32_t(value >> 32), matrix)) << 32;
+}
+//------------------------------------------------------------------------------
+static uint64_t shiftSubMix(uint64_t rs1, uint64_t rs2, bool mix, bool decrypt)
+{
+    // Each output byte comes from rs1 (0-7) or rs2 (8-15) through ShiftRows
+    static const uint8_t forwardRows[8] = { 0, 5, 10, 15, 4, 9, 14, 3 };
+    static const uint8_t inverseRows[8] = { 0, 13, 10, 7, 4, 1, 14, 11 };
+    const uint8_t* rows = decrypt ? inverseRows : forwardRows;
+    const uint8_t* box = decrypt ? inverse : forward;
+    uint64_t result = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        uint64_t source = rows[i] < 8 ? rs1 : rs2;
+        result |= uint64_t(box[uint8_t(source >> ((rows[i] & 7) * 8))]) << (i * 8);
+    }
+    return mix ? mixColumns(result, decrypt) : result;
+}
+//------------------------------------------------------------------------------
+static uint64_t portableEncrypt(uint64_t rs1, uint64_t rs2, bool mix)
+{
+    return shiftSubMix(rs1, rs2, mix, false);
+}
+//------------------------------------------------------------------------------
+static uint64_t portableDecrypt(uint64_t rs1, uint64_t rs2, bool mix)
+{
+    return shiftSubMix(rs1, rs2, mix, true);
+}
+//------------------------------------------------------------------------------
+static uint64_t portableInverseMix(uint64_t rs1)
+{
+    return mixColumns(rs1, true);
+}
+//------------------------------------------------------------------------------
+static uint32_t portableSubWord(uint32_t word)
+{
+    return forward[word & 0xFF] | forward[(word >> 8) & 0xFF] << 8 | forward[(word >> 16) & 0xFF] << 16 | uint32_t(forward[word >> 24]) << 24;
+}
+//------------------------------------------------------------------------------
+#if defined(__x86_64__)
+__attribute__((target("aes,sse2")))
+static uint64_t aesniEncrypt(uint64_t rs1, uint64_t rs2, bool mix)
+{
+    __m128i state = _mm_set_epi64x(int64_t(rs2), int64_t(rs1));
+    state = mix ? _mm_aesenc_si128(state, _mm_setzero_si128()) : _mm_aesenclast_si128(state, _mm_setzero_si128());
+    return _mm_cvtsi128_si64(state);
+}
+//------------------------------------------------------------------------------
+__attribute__((target("aes,sse2")))
+static uint64_t aesniDecrypt(uint64_t rs1, uint64_t rs2, bool mix)
+{
+    __m128i state = _mm_set_epi64x(int64_t(rs2), int64_t(rs1));
+    state = mix ? _mm_aesdec_si128(state, _mm_setzero_si128()) : _mm_aesdeclast_si128(state, _mm_setzero_si128());
+    return _mm_cvtsi128_si64(state);
+}
+//------------------------------------------------------------------------------
+__attribute__((target("aes,sse2")))
+static uint64_t aesniInverseMix(uint64_t rs1)
+{
+    return _mm_cvtsi128_si64(_mm_aesimc_si128(_mm_cvtsi64_si128(int64_t(rs1))));
+}
+//------------------------------------------------------------------------------
+__attribute__((target("aes,sse2")))
+static uint32_t aesniSubWord(uint32_t word)
+{
+    // ShiftRows leaves four equal columns where they are
+    return _mm_cvtsi128_si32(_mm_aesenclast_si128(_mm_set1_epi32(int32_t(word)), _mm_setzero_si128()));
+}
+#endif
+//------------------------------------------------------------------------------
+static const aes& host()
+{
+    static const aes portable = { portableEncrypt, portableDecrypt, portableInverseMix, portableSubWord };
+#if defined(__x86_64__)
+    static const aes aesni = { aesniEncrypt, aesniDecrypt, aesniInverseMix, aesniSubWord };
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("aes"))
+        return aesni;
+#endif
+    return portable;
+}
+//------------------------------------------------------------------------------
+static const aes& cipher = host();
+//------------------------------------------------------------------------------
+static inline uint32_t ror32(uint32_t value, unsigned int shift)
+{
+    return (value >> shift) | (value << (32 - shift));
+}
+//------------------------------------------------------------------------------
+static inline uint64_t ror64(uint64_t value, unsigned int shift)
+{
+    return (value >> shift) | (value << (64 - shift));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::AES64ES()
+{
+    x[rd] = cipher.encrypt(x[rs1].u64, x[rs2].u64, false);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::AES64ESM()
+{
+    x[rd] = cipher.encrypt(x[rs1].u64, x[rs2].u64, true);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::AES64DS()
+{
+    x[rd] = cipher.decrypt(x[rs1].u64, x[rs2].u64, false);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::AES64DSM()
+{
+    x[rd] = cipher.decrypt(x[rs1].u64, x[rs2].u64, true);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::AES64IM()
+{
+    x[rd] = cipher.inverseMix(x[rs1].u64);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::AES64KS1I()
+{
+    static const uint8_t rcon[11] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36, 0x00 };
+    unsigned int rnum = immI() & 0xF;
+    if (rnum > 0xA)
+        return HINT();
+    uint32_t word = x[rs1].u64 >> 32;
+    if (rnum != 0xA)
+        word = ror32(word, 8);
+    word = cipher.subWord(word) ^ rcon[rnum];
+    x[rd] = uint64_t(word) << 32 | word;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::AES64KS2()
+{
+    uint32_t w0 = uint32_t(x[rs1].u64 >> 32) ^ x[rs2].u32;
+    uint32_t w1 = w0 ^ uint32_t(x[rs2].u64 >> 32);
+    x[rd] = uint64_t(w1) << 32 | w0;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SHA256SIG0()
+{
+    uint32_t value = x[rs1].u32;
+    x[rd] = int32_t(ror32(value, 7) ^ ror32(value, 18) ^ (value >> 3));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SHA256SIG1()
+{
+    uint32_t value = x[rs1].u32;
+    x[rd] = int32_t(ror32(value, 17) ^ ror32(value, 19) ^ (value >> 10));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SHA256SUM0()
+{
+    uint32_t value = x[rs1].u32;
+    x[rd] = int32_t(ror32(value, 2) ^ ror32(value, 13) ^ ror32(value, 22));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SHA256SUM1()
+{
+    uint32_t value = x[rs1].u32;
+    x[rd] = int32_t(ror32(value, 6) ^ ror32(value, 11) ^ ror32(value, 25));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SHA512SIG0()
+{
+    uint64_t value = x[rs1].u64;
+    x[rd] = ror64(value, 1) ^ ror64(value, 8) ^ (value >> 7);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SHA512SIG1()
+{
+    uint64_t value = x[rs1].u64;
+    x[rd] = ror64(value, 19) ^ ror64(value, 61) ^ (value >> 6);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SHA512SUM0()
+{
+    uint64_t value = x[rs1].u64;
+    x[rd] = ror64(value, 28) ^ ror64(value, 34) ^ ror64(value, 39);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SHA512SUM1()
+{
+    uint64_t value = x[rs1].u64;
+    x[rd] = ror64(value, 14) ^ ror64(value, 18) ^ ror64(value, 41);
+}
+//------------------------------------------------------------------------------
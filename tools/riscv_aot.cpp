@@ -0,0 +1,404 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include "../libelf/elf.h"
+#include "../libelf/elf_view.h"
+#include "../riscv_aot.h"
+#include "../riscv_cfg.h"
+#include "../riscv_disassembler.h"
+#include "../riscv_instruction.h"
+#include "../riscv_loader.h"
+
+//------------------------------------------------------------------------------
+// Ahead-of-time translator
+//------------------------------------------------------------------------------
+// Usage: riscv_aot <elf> <output.cpp>
+//        c++ -std=c++17 -O2 -shared -fPIC -I<repo> output.cpp -o output.so
+// Blocks start at the leaders recovered by riscv_cfg and after every
+// instruction which ends a block. RV64IM integer, load, store and control
+// transfer instructions are translated, compressed ones through their
+// expansion. A block stops in front of anything else and leaves it to the
+// interpreter.
+//------------------------------------------------------------------------------
+struct segment
+{
+    uintptr_t vaddr;
+    const uint8_t* data;
+    size_t size;
+    uint8_t* leader;
+};
+//------------------------------------------------------------------------------
+static segment segments[16];
+static size_t segmentCount;
+//------------------------------------------------------------------------------
+static void mark(uintptr_t pc)
+{
+    for (size_t i = 0; i < segmentCount; ++i)
+    {
+        segment& segment = segments[i];
+        if (pc >= segment.vaddr && pc < segment.vaddr + segment.size && (pc & 1) == 0)
+            segment.leader[(pc - segment.vaddr) / 2] = 1;
+    }
+}
+//------------------------------------------------------------------------------
+static size_t fetch(const segment& segment, size_t offset, riscv_instruction& i)
+{
+    // Length of the instruction at offset, compressed ones are expanded
+    i.format = 0;
+    if (offset + 2 > segment.size)
+        return 0;
+    memcpy(&i.format, segment.data + offset, segment.size - offset < 4 ? 2 : 4);
+    if ((i.format & 0b11) != 0b11)
+    {
+        i.format = riscv_instruction::expand(i.format);
+        return 2;
+    }
+    return offset + 4 <= segment.size ? 4 : 0;
+}
+//------------------------------------------------------------------------------
+// Translation
+//------------------------------------------------------------------------------
+enum
+{
+    NEXT,           // continue with the next instruction
+    END,            // the instruction ends the block
+    UNSUPPORTED,    // leave the instruction to the interpreter
+};
+//------------------------------------------------------------------------------
+static int translate(FILE* file, const riscv_instruction& i, uintptr_t pc, size_t length)
+{
+    int rd = i.rd;
+    int rs1 = i.rs1;
+    int rs2 = i.rs2;
+    uintptr_t next = pc + length;
+
+    const char* type = nullptr;
+    char value[128] = "";
+    switch (i.opcode)
+    {
+    case 0b0110111:     // LUI
+        snprintf(value, sizeof(value), "%d", i.simmU());
+        type = "s";
+        break;
+    case 0b0010111:     // AUIPC
+        snprintf(value, sizeof(value), "bias + 0x%llxull", (unsigned long long)(pc + i.simmU()));
+        type = "u";
+        break;
+    case 0b1101111:     // JAL
+        if (rd)
+            fprintf(file, "    x[%d].u = bias + 0x%llxull;\n", rd, (unsigned long long)next);
+        fprintf(file, "    cpu.pc = bias + 0x%llxull;\n", (unsigned long long)(pc + i.simmJ()));
+        return END;
+    case 0b1100111:     // JALR
+        if (i.funct3 != 0)
+            return UNSUPPORTED;
+        fprintf(file, "    uintptr_t target = x[%d].u + %d;\n", rs1, i.simmI());
+        if (rd)
+            fprintf(file, "    x[%d].u = bias + 0x%llxull;\n", rd, (unsigned long long)next);
+        fprintf(file, "    cpu.pc = target;\n");
+        return END;
+    case 0b1100011:     // BRANCH
+    {
+        static const char* const condition[8] = { "x[%d].u == x[%d].u", "x[%d].u != x[%d].u", nullptr, nullptr,
+                                                  "x[%d].s < x[%d].s", "x[%d].s >= x[%d].s", "x[%d].u < x[%d].u", "x[%d].u >= x[%d].u" };
+        if (condition[i.funct3] == nullptr)
+            return UNSUPPORTED;
+        fprintf(file, "    cpu.pc = bias + (");
+        fprintf(file, condition[i.funct3], rs1, rs2);
+        fprintf(file, " ? 0x%llxull : 0x%llxull);\n", (unsigned long long)(pc + i.simmB()), (unsigned long long)next);
+        return END;
+    }
+    case 0b0000011:     // LOAD
+    {
+        static const char* const load[8] = { "int8_t", "int16_t", "int32_t", "int64_t", "uint8_t", "uint16_t", "uint32_t", nullptr };
+        if (load[i.funct3] == nullptr)
+            return UNSUPPORTED;
+        if (rd == 0)
+            return UNSUPPORTED;
+        snprintf(value, sizeof(value), "*(%s*)(x[%d].u + %d)", load[i.funct3], rs1, i.simmI());
+        type = (i.funct3 & 0b100) ? "u" : "s";
+        break;
+    }
+    case 0b0100011:     // STORE
+    {
+        static const char* const store[8] = { "u8", "u16", "u32", "u64" };
+        if (i.funct3 > 3)
+            return UNSUPPORTED;
+        fprintf(file, "    *(uint%d_t*)(x[%d].u + %d) = x[%d].%s;\n", 8 << i.funct3, rs1, i.simmS(), rs2, store[i.funct3]);
+        return NEXT;
+    }
+    case 0b0010011:     // OP-IMM
+    {
+        int imm = i.simmI();
+        int shamt = imm & 63;
+        switch (i.funct3)
+        {
+        case 0b000: snprintf(value, sizeof(value), "x[%d].u + %d", rs1, imm);                       break;
+        case 0b010: snprintf(value, sizeof(value), "x[%d].s < %d", rs1, imm);                       break;
+        case 0b011: snprintf(value, sizeof(value), "x[%d].u < (uintptr_t)%d", rs1, imm);            break;
+        case 0b100: snprintf(value, sizeof(value), "x[%d].u ^ (uintptr_t)%d", rs1, imm);            break;
+        case 0b110: snprintf(value, sizeof(value), "x[%d].u | (uintptr_t)%d", rs1, imm);            break;
+        case 0b111: snprintf(value, sizeof(value), "x[%d].u & (uintptr_t)%d", rs1, imm);            break;
+        case 0b001:
+            if (imm >> 6)
+                return UNSUPPORTED;
+            snprintf(value, sizeof(value), "x[%d].u << %d", rs1, shamt);
+            break;
+        case 0b101:
+            if ((imm >> 6) == 0)
+                snprintf(value, sizeof(value), "x[%d].u >> %d", rs1, shamt);
+            else if ((imm >> 6) == 0x10)
+                snprintf(value, sizeof(value), "(uintptr_t)(x[%d].s >> %d)", rs1, shamt);
+            else
+                return UNSUPPORTED;
+            break;
+        }
+        type = "u";
+        break;
+    }
+    case 0b0011011:     // OP-IMM-32
+    {
+        int shamt = rs2;
+        switch (i.funct3)
+        {
+        case 0b000: snprintf(value, sizeof(value), "(int32_t)(x[%d].u32 + %d)", rs1, i.simmI());   break;
+        case 0b001:
+            if (i.funct7 != 0)
+                return UNSUPPORTED;
+            snprintf(value, sizeof(value), "(int32_t)(x[%d].u32 << %d)", rs1, shamt);
+            break;
+        case 0b101:
+            if (i.funct7 == 0)
+                snprintf(value, sizeof(value), "(int32_t)(x[%d].u32 >> %d)", rs1, shamt);
+            else if (i.funct7 == 0b0100000)
+                snprintf(value, sizeof(value), "x[%d].s32 >> %d", rs1, shamt);
+            else
+                return UNSUPPORTED;
+            break;
+        default:
+            return UNSUPPORTED;
+        }
+        type = "s";
+        break;
+    }
+    case 0b0110011:     // OP
+    {
+        static const char* const base[8] = { "x[%d].u + x[%d].u", "x[%d].u << (x[%d].u & 63)", "x[%d].s < x[%d].s", "x[%d].u < x[%d].u",
+                                             "x[%d].u ^ x[%d].u", "x[%d].u >> (x[%d].u & 63)", "x[%d].u | x[%d].u", "x[%d].u & x[%d].u" };
+        static const char* const muldiv[8] = { "x[%d].u * x[%d].u", "mulh(x[%d].s, x[%d].s)", "mulhsu(x[%d].s, x[%d].u)", "mulhu(x[%d].u, x[%d].u)",
+                                               "div(x[%d].s, x[%d].s)", "divu(x[%d].u, x[%d].u)", "rem(x[%d].s, x[%d].s)", "remu(x[%d].u, x[%d].u)" };
+        const char* format = nullptr;
+        if (i.funct7 == 0)
+            format = base[i.funct3];
+        else if (i.funct7 == 1)
+            format = muldiv[i.funct3];
+        else if (i.funct7 == 0b0100000 && i.funct3 == 0b000)
+            format = "x[%d].u - x[%d].u";
+        else if (i.funct7 == 0b0100000 && i.funct3 == 0b101)
+            format = "(uintptr_t)(x[%d].s >> (x[%d].u & 63))";
+        else
+            return UNSUPPORTED;
+        snprintf(value, sizeof(value), format, rs1, rs2);
+        type = "u";
+        break;
+    }
+    case 0b0111011:     // OP-32
+    {
+        static const char* const base[8] = { "(int32_t)(x[%d].u32 + x[%d].u32)", "(int32_t)(x[%d].u32 << (x[%d].u & 31))", nullptr, nullptr,
+                                             nullptr, "(int32_t)(x[%d].u32 >> (x[%d].u & 31))", nullptr, nullptr };
+        static const char* const muldiv[8] = { "(int32_t)(x[%d].u32 * x[%d].u32)", nullptr, nullptr, nullptr,
+                                               "divw(x[%d].s32, x[%d].s32)", "divuw(x[%d].u32, x[%d].u32)", "remw(x[%d].s32, x[%d].s32)", "remuw(x[%d].u32, x[%d].u32)" };
+        const char* format = nullptr;
+        if (i.funct7 == 0)
+            format = base[i.funct3];
+        else if (i.funct7 == 1)
+            format = muldiv[i.funct3];
+        else if (i.funct7 == 0b0100000 && i.funct3 == 0b000)
+            format = "(int32_t)(x[%d].u32 - x[%d].u32)";
+        else if (i.funct7 == 0b0100000 && i.funct3 == 0b101)
+            format = "x[%d].s32 >> (x[%d].u & 31)";
+        if (format == nullptr)
+            return UNSUPPORTED;
+        snprintf(value, sizeof(value), format, rs1, rs2);
+        type = "s";
+        break;
+    }
+    case 0b0001111:     // MISC-MEM
+        if (i.funct3 != 0)
+            return UNSUPPORTED;
+        return NEXT;
+    default:
+        return UNSUPPORTED;
+    }
+
+    if (rd)
+        fprintf(file, "    x[%d].%s = %s;\n", rd, type, value);
+    return NEXT;
+}
+//------------------------------------------------------------------------------
+static const char prelude[] =
+    "#include \"riscv_aot.h\"\n"
+    "#include \"riscv_cpu.h\"\n"
+    "\n"
+    "typedef riscv_cpu::register_t register_t;\n"
+    "static inline uintptr_t mulh(intptr_t a, intptr_t b) { return (uintptr_t)(((__int128)a * b) >> 64); }\n"
+    "static inline uintptr_t mulhsu(intptr_t a, uintptr_t b) { return (uintptr_t)(((__int128)a * (unsigned __int128)b) >> 64); }\n"
+    "static inline uintptr_t mulhu(uintptr_t a, uintptr_t b) { return (uintptr_t)(((unsigned __int128)a * b) >> 64); }\n"
+    "static inline uintptr_t div(intptr_t a, intptr_t b) { return b == 0 ? -1 : (a == INTPTR_MIN && b == -1) ? a : a / b; }\n"
+    "static inline uintptr_t divu(uintptr_t a, uintptr_t b) { return b == 0 ? UINTPTR_MAX : a / b; }\n"
+    "static inline uintptr_t rem(intptr_t a, intptr_t b) { return b == 0 ? a : (a == INTPTR_MIN && b == -1) ? 0 : a % b; }\n"
+    "static inline uintptr_t remu(uintptr_t a, uintptr_t b) { return b == 0 ? a : a % b; }\n"
+    "static inline intptr_t divw(int32_t a, int32_t b) { return b == 0 ? -1 : (a == INT32_MIN && b == -1) ? a : a / b; }\n"
+    "static inline intptr_t divuw(uint32_t a, uint32_t b) { return (int32_t)(b == 0 ? UINT32_MAX : a / b); }\n"
+    "static inline intptr_t remw(int32_t a, int32_t b) { return b == 0 ? a : (a == INT32_MIN && b == -1) ? 0 : a % b; }\n"
+    "static inline intptr_t remuw(uint32_t a, uint32_t b) { return (int32_t)(b == 0 ? a : a % b); }\n"
+    "\n";
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s <elf> <output.cpp>\n", argv[0]);
+        return 1;
+    }
+
+    size_t elfSize = 0;
+    char* elfData = riscv_loader::read(argv[1], elfSize);
+    elf_t elf;
+    if (elfData == nullptr || elf_newFile(elfData, elfSize, &elf) < 0 || elf.elfClass != ELFCLASS64)
+    {
+        fprintf(stderr, "%s: invalid ELF64 file\n", argv[1]);
+        return 1;
+    }
+
+    elf64_view view(&elf);
+    for (const Elf64_Phdr& phdr : view.programHeaders())
+    {
+        if (phdr.p_type != PT_LOAD || (phdr.p_flags & PF_X) == 0 || segmentCount >= 16)
+            continue;
+        segment& segment = segments[segmentCount++];
+        segment.vaddr = phdr.p_vaddr;
+        segment.data = (uint8_t*)view.file + phdr.p_offset;
+        segment.size = phdr.p_filesz & ~size_t(1);
+        segment.leader = new uint8_t[segment.size / 2 + 1]();
+        mark(segment.vaddr);
+    }
+
+    // Translation is only written to null while blocks are discovered
+    FILE* null = fopen("/dev/null", "w");
+    if (null == nullptr)
+        return 1;
+
+    // Leaders
+    riscv_cfg cfg;
+    if (cfg.build(&elf) == false)
+    {
+        fprintf(stderr, "%s: %s\n", argv[1], cfg.error);
+        return 1;
+    }
+    for (size_t i = 0; i < cfg.blockCount; ++i)
+    {
+        mark(cfg.blocks[i].begin);
+    }
+    for (size_t s = 0; s < segmentCount; ++s)
+    {
+        const segment& segment = segments[s];
+        for (size_t offset = 0; offset + 2 <= segment.size;)
+        {
+            riscv_instruction i;
+            size_t length = fetch(segment, offset, i);
+            if (length == 0)
+                break;
+            uintptr_t pc = segment.vaddr + offset;
+            if (translate(null, i, pc, length) != NEXT)
+                mark(pc + length);
+            offset += length;
+        }
+    }
+
+    FILE* file = fopen(argv[2], "w");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "%s: cannot be written\n", argv[2]);
+        return 1;
+    }
+    fprintf(file, "// Generated by riscv_aot from %s\n", argv[1]);
+    fputs(prelude, file);
+
+    // Blocks
+    size_t blockCount = 0;
+    for (size_t s = 0; s < segmentCount; ++s)
+    {
+        const segment& segment = segments[s];
+        for (size_t first = 0; first + 2 <= segment.size; first += 2)
+        {
+            if (segment.leader[first / 2] == 0)
+                continue;
+            // A block has to translate at least its first instruction
+            riscv_instruction i;
+            size_t length = fetch(segment, first, i);
+            if (length == 0 || translate(null, i, segment.vaddr + first, length) == UNSUPPORTED)
+                continue;
+            segment.leader[first / 2] = 2;
+            blockCount++;
+
+            fprintf(file, "static void block_%llx(riscv_cpu& cpu, [[maybe_unused]] uintptr_t bias)\n{\n", (unsigned long long)(segment.vaddr + first));
+            fprintf(file, "    [[maybe_unused]] register_t* x = cpu.x;\n");
+            size_t offset = first;
+            int result = NEXT;
+            size_t count = 0;
+            while (result == NEXT)
+            {
+                uintptr_t pc = segment.vaddr + offset;
+                length = fetch(segment, offset, i);
+                if (length == 0 || (count && segment.leader[offset / 2]))
+                {
+                    fprintf(file, "    cpu.pc = bias + 0x%llxull;\n", (unsigned long long)pc);
+                    break;
+                }
+                char text[64];
+                riscv_disassembler::disassemble(text, sizeof(text), pc, i.format);
+                if (translate(null, i, pc, length) == UNSUPPORTED)
+                {
+                    fprintf(file, "    cpu.pc = bias + 0x%llxull;    // %s\n", (unsigned long long)pc, text);
+                    break;
+                }
+                fprintf(file, "    // %s\n", text);
+                result = translate(file, i, pc, length);
+                offset += length;
+                count++;
+            }
+            fprintf(file, "}\n");
+        }
+    }
+
+    fprintf(file, "\nextern \"C\" const uint32_t riscv_aot_version = %d;\n", riscv_aot::VERSION);
+    fprintf(file, "extern \"C\" const uint64_t riscv_aot_hash = 0x%llxull;\n", (unsigned long long)riscv_aot::hash(&elf));
+    fprintf(file, "extern \"C\" const size_t riscv_aot_count = %zu;\n", blockCount);
+    fprintf(file, "extern \"C\" const riscv_aot::entry_t riscv_aot_table[] =\n{\n");
+    for (size_t s = 0; s < segmentCount; ++s)
+    {
+        const segment& segment = segments[s];
+        for (size_t first = 0; first + 2 <= segment.size; first += 2)
+        {
+            if (segment.leader[first / 2] == 2)
+                fprintf(file, "    { 0x%llx, block_%llx },\n", (unsigned long long)(segment.vaddr + first), (unsigned long long)(segment.vaddr + first));
+        }
+        delete[] segment.leader;
+    }
+    fprintf(file, "};\n");
+    fclose(file);
+    fclose(null);
+
+    printf("%s: %zu blocks\n", argv[2], blockCount);
+    delete[] elfData;
+
+    return 0;
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,78 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include "../libelf/elf.h"
+#include "../libelf/elf_view.h"
+#include "../riscv_disassembler.h"
+#include "../riscv_loader.h"
+#include "../riscv_trace.h"
+
+//------------------------------------------------------------------------------
+static uint32_t read(void* context, uintptr_t pc)
+{
+    return elf_visit((elf_t*)context, [pc](const auto& view) -> uint32_t
+    {
+        for (const auto& phdr : view.programHeaders())
+        {
+            uintptr_t vaddr = phdr.p_vaddr;
+            size_t size = phdr.p_filesz;
+            if (pc < vaddr || pc + sizeof(uint16_t) > vaddr + size)
+                continue;
+            uint32_t format = 0;
+            size_t length = vaddr + size - pc;
+            memcpy(&format, view.file + phdr.p_offset + (pc - vaddr), length < sizeof(format) ? length : sizeof(format));
+            return format;
+        }
+        return 0;
+    });
+}
+//------------------------------------------------------------------------------
+static void step(void* context, uintptr_t pc, uint32_t format, uintptr_t address, uintptr_t next)
+{
+    char text[64];
+    riscv_disassembler::disassemble(text, sizeof(text), pc, format);
+    if ((format & 0b11) == 0b11)
+        printf("%016llx: %08x    %-40s", (unsigned long long)pc, format, text);
+    else
+        printf("%016llx: %04x        %-40s", (unsigned long long)pc, format & 0xFFFF, text);
+    if (address)
+        printf(" [%016llx]", (unsigned long long)address);
+    printf("\n");
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s <elf> <trace>\n", argv[0]);
+        return 1;
+    }
+
+    size_t elfSize = 0;
+    char* elfData = riscv_loader::read(argv[1], elfSize);
+    elf_t elf;
+    if (elfData == nullptr || elf_newFile(elfData, elfSize, &elf) < 0)
+    {
+        fprintf(stderr, "%s: invalid ELF file\n", argv[1]);
+        return 1;
+    }
+
+    size_t traceSize = 0;
+    char* traceData = riscv_loader::read(argv[2], traceSize);
+    if (traceData == nullptr || riscv_trace::decode(traceData, traceSize, read, step, &elf) == false)
+    {
+        fprintf(stderr, "%s: invalid trace file\n", argv[2]);
+        return 1;
+    }
+
+    delete[] traceData;
+    delete[] elfData;
+
+    return 0;
+}